@@ -0,0 +1,466 @@
+#include "di/cli/parser.h"
+#include "di/container/string/string_view.h"
+#include "di/container/vector/vector.h"
+#include "di/format/prelude.h"
+#include "di/sync/atomic.h"
+#include "di/sync/memory_order.h"
+#include "di/util/construct.h"
+#include "dius/main.h"
+#include "dius/print.h"
+#include "dius/sync_file.h"
+#include "ttx/escape_sequence_parser.h"
+#include "ttx/pane.h"
+#include "ttx/renderer.h"
+#include "ttx/size.h"
+#include "ttx/terminal.h"
+#include "ttx/utf8_stream_decoder.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+// Count every heap allocation made through operator new, so that each stage can report how many allocations it
+// performs. This intentionally ignores direct calls to malloc().
+static auto s_allocation_count = di::Atomic<u64>(0);
+static auto s_allocation_bytes = di::Atomic<u64>(0);
+
+static auto counted_allocate(usize size) -> void* {
+    s_allocation_count.fetch_add(1, di::MemoryOrder::Relaxed);
+    s_allocation_bytes.fetch_add(size, di::MemoryOrder::Relaxed);
+    return malloc(size == 0 ? 1 : size);
+}
+
+static auto counted_allocate(usize size, std::align_val_t alignment) -> void* {
+    s_allocation_count.fetch_add(1, di::MemoryOrder::Relaxed);
+    s_allocation_bytes.fetch_add(size, di::MemoryOrder::Relaxed);
+
+    // aligned_alloc() requires the size to be a multiple of the alignment.
+    auto align = usize(alignment);
+    return aligned_alloc(align, (size + align - 1) / align * align);
+}
+
+auto operator new(usize size) -> void* {
+    auto* result = counted_allocate(size);
+    if (!result) {
+        abort();
+    }
+    return result;
+}
+
+auto operator new[](usize size) -> void* {
+    return operator new(size);
+}
+
+auto operator new(usize size, std::nothrow_t const&) noexcept -> void* {
+    return counted_allocate(size);
+}
+
+auto operator new[](usize size, std::nothrow_t const&) noexcept -> void* {
+    return counted_allocate(size);
+}
+
+auto operator new(usize size, std::align_val_t alignment) -> void* {
+    auto* result = counted_allocate(size, alignment);
+    if (!result) {
+        abort();
+    }
+    return result;
+}
+
+auto operator new(usize size, std::align_val_t alignment, std::nothrow_t const&) noexcept -> void* {
+    return counted_allocate(size, alignment);
+}
+
+void operator delete(void* pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete(void* pointer, usize) noexcept {
+    free(pointer);
+}
+
+void operator delete[](void* pointer, usize) noexcept {
+    free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+    free(pointer);
+}
+
+void operator delete(void* pointer, usize, std::align_val_t) noexcept {
+    free(pointer);
+}
+
+namespace ttx::bench {
+struct Args {
+    di::Vector<di::TransparentStringView> captures;
+    u32 iterations { 3 };
+    u32 synthetic_mib { 8 };
+    u32 frames { 100 };
+    bool help { false };
+
+    constexpr static auto get_cli_parser() {
+        return di::cli_parser<Args>("ttx_bench"_sv, "Measure how quickly libttx processes terminal output"_sv)
+            .option<&Args::iterations>('i', "iterations"_tsv, "Number of times each corpus is processed per stage"_sv)
+            .option<&Args::synthetic_mib>('s', "synthetic-size"_tsv,
+                                          "Size of each synthetic corpus in MiB (0 disables them)"_sv)
+            .option<&Args::frames>('f', "frames"_tsv, "Number of frames rendered per corpus"_sv)
+            .argument<&Args::captures>("CAPTURES"_sv, "Captured output to replay (like lib/test/cases/*.input.ansi)"_sv)
+            .help();
+    }
+};
+
+// Output is fed to each stage in chunks matching the pane's read buffer.
+constexpr auto chunk_size = 16384_usize;
+
+// All corpora are processed with a fixed terminal size, so results are comparable across machines.
+constexpr auto bench_size = Size { 50, 200, 2000, 1000 };
+
+struct Corpus {
+    di::String name;
+    di::Vector<byte> data;
+    di::Optional<di::Path> path;
+};
+
+struct Sample {
+    u64 nanoseconds { 0 };
+    u64 bytes { 0 };
+    u64 allocations { 0 };
+    u64 allocated_bytes { 0 };
+    u64 peak_rss_kib { 0 };
+};
+
+// Set once the peak resident set size has been reset successfully, in which case each stage reports its own peak.
+static auto s_per_stage_peak_rss = false;
+
+// Reset the peak resident set size, so that the next stage's peak doesn't include the previous ones. Writing 5 to
+// clear_refs does this on linux (since 4.0). Otherwise, the peak can only grow over the life of the process.
+static auto reset_peak_rss() -> bool {
+#ifdef __linux__
+    auto fd = open("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    auto written = write(fd, "5", 1);
+    close(fd);
+    return written == 1;
+#else
+    return false;
+#endif
+}
+
+static auto process_peak_rss_kib() -> u64 {
+    auto usage = rusage {};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    // MacOS reports the maximum resident set size in bytes, while linux uses KiB.
+    return u64(usage.ru_maxrss) / 1024;
+#else
+    return u64(usage.ru_maxrss);
+#endif
+}
+
+static auto peak_rss_kib() -> u64 {
+#ifdef __linux__
+    // The resettable peak is reported as a line like "VmHWM:     1234 kB", which comes early in the file.
+    if (s_per_stage_peak_rss) {
+        auto fd = open("/proc/self/status", O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            char buffer[4096];
+            auto size = read(fd, buffer, sizeof(buffer) - 1);
+            close(fd);
+            if (size > 0) {
+                buffer[size] = '\0';
+                if (auto const* line = strstr(buffer, "VmHWM:")) {
+                    return u64(strtoull(line + 6, nullptr, 10));
+                }
+            }
+        }
+    }
+#endif
+    return process_peak_rss_kib();
+}
+
+template<typename F>
+static auto measure(u64 bytes, F&& function) -> Sample {
+    auto allocations = s_allocation_count.load(di::MemoryOrder::Relaxed);
+    auto allocated_bytes = s_allocation_bytes.load(di::MemoryOrder::Relaxed);
+    if (s_per_stage_peak_rss) {
+        (void) reset_peak_rss();
+    }
+    auto start = dius::SteadyClock::now();
+
+    function();
+
+    auto end = dius::SteadyClock::now();
+    return {
+        .nanoseconds = u64(di::duration_cast<di::Nanoseconds>(end - start).count()),
+        .bytes = bytes,
+        .allocations = s_allocation_count.load(di::MemoryOrder::Relaxed) - allocations,
+        .allocated_bytes = s_allocation_bytes.load(di::MemoryOrder::Relaxed) - allocated_bytes,
+        .peak_rss_kib = peak_rss_kib(),
+    };
+}
+
+static void report(di::StringView corpus, di::StringView stage, Sample const& sample) {
+    // Print fixed point values with 2 decimal places, to avoid relying on floating point formatting.
+    auto nanoseconds = di::max(sample.nanoseconds, u64(1));
+    auto mb_per_second = sample.bytes * 100000 / nanoseconds;
+
+    if (sample.bytes == 0) {
+        dius::println("{: <28}{: <14}{: >12}{: >12}{: >14}{: >14}{: >12}"_sv, corpus, stage, "-"_sv, "-"_sv,
+                      sample.allocations, sample.allocated_bytes / 1024, sample.peak_rss_kib);
+        return;
+    }
+
+    auto ns_per_byte = sample.nanoseconds * 100 / sample.bytes;
+    dius::println("{: <28}{: <14}{: >9}.{:02}{: >9}.{:02}{: >14}{: >14}{: >12}"_sv, corpus, stage,
+                  mb_per_second / 100, mb_per_second % 100, ns_per_byte / 100, ns_per_byte % 100, sample.allocations,
+                  sample.allocated_bytes / 1024, sample.peak_rss_kib);
+}
+
+static auto read_file(di::PathView path) -> di::Result<di::Vector<byte>> {
+    auto file = TRY(dius::open_sync(path, dius::OpenMode::Readonly));
+
+    auto buffer = di::Vector<byte> {};
+    buffer.resize(chunk_size);
+
+    auto result = di::Vector<byte> {};
+    for (;;) {
+        auto nread = TRY(file.read_some(buffer.span()));
+        if (nread == 0) {
+            break;
+        }
+        for (auto value : buffer | di::take(nread)) {
+            result.push_back(value);
+        }
+    }
+    return result;
+}
+
+static auto write_file(di::PathView path, di::Span<byte const> data) -> di::Result<> {
+    auto file = TRY(dius::open_sync(path, dius::OpenMode::WriteClobber));
+    return file.write_exactly(data);
+}
+
+// Repeat a pattern until the corpus reaches the requested size. The pattern is passed the line number, so that
+// the output isn't perfectly repetitive.
+template<typename F>
+static auto make_synthetic(di::StringView name, usize size, F&& line) -> Corpus {
+    auto text = di::String {};
+    for (auto i = 0_usize; text.size_bytes() < size; i++) {
+        text.append(line(i));
+    }
+
+    auto data = di::Vector<byte> {};
+    for (auto value : di::as_bytes(text.span())) {
+        data.push_back(value);
+    }
+    return { name.to_owned(), di::move(data), {} };
+}
+
+static auto make_synthetic_corpora(usize size) -> di::Vector<Corpus> {
+    auto result = di::Vector<Corpus> {};
+
+    // Plain build output, which is mostly printable ASCII.
+    result.push_back(make_synthetic("synthetic:ascii-log"_sv, size, [](usize i) {
+        return *di::present("[{}/65536] Building CXX object lib/CMakeFiles/ttx.dir/src/terminal/screen_{}.cpp.o\r\n"_sv,
+                            i, i % 97);
+    }));
+
+    // Colored output, like a compiler or ls --color, which stresses SGR parsing and attribute storage.
+    result.push_back(make_synthetic("synthetic:sgr-heavy"_sv, size, [](usize i) {
+        return *di::present("\033[1;38;2;{};{};{}mwarning\033[m: \033[38;5;{}munused\033[m \033[4mvariable\033[24m "
+                            "'\033[3;48;5;{}mvalue_{}\033[m' [-Wunused-variable]\r\n"_sv,
+                            i % 256, (i * 7) % 256, (i * 13) % 256, i % 256, (i * 3) % 256, i);
+    }));
+
+    // Non-ASCII text, including wide characters, emoji and combining marks.
+    result.push_back(make_synthetic("synthetic:unicode"_sv, size, [](usize i) {
+        return *di::present(u8"{} 漢字のテスト Ünïcödé résumé 👍🏽 🇺🇸 é ∀x∈ℝ: x² ≥ 0\r\n"_sv, i);
+    }));
+
+    // Full screen application redraws, which stress cursor movement, erasing and scroll regions.
+    result.push_back(make_synthetic("synthetic:cursor"_sv, size, [](usize i) {
+        auto row = i % bench_size.rows + 1;
+        auto col = (i * 17) % (bench_size.cols - 40) + 1;
+        return *di::present("\033[{};{}H\033[2K\033[7m {: >6} \033[27m status line {}\033[5;40r\033[40;1H\n\033[r"
+                            "\033[{};{}H\033[K\033[1P\033[2@\033[3X"_sv,
+                            row, 1, i, i, row, col);
+    }));
+
+    return result;
+}
+
+static auto bench_decode(Corpus const& corpus, u32 iterations) -> Sample {
+    auto total = 0_usize;
+    auto sample = measure(corpus.data.size() * iterations, [&] {
+        for (auto _ : di::range(iterations)) {
+            auto decoder = Utf8StreamDecoder {};
+            for (auto offset = 0_usize; offset < corpus.data.size(); offset += chunk_size) {
+                auto chunk = *corpus.data.span().subspan(offset, di::min(chunk_size, corpus.data.size() - offset));
+                decoder.decode_view(chunk, [&](di::StringView text) {
+                    total += text.size_bytes();
+                });
+            }
+        }
+    });
+
+    // Use the result, so that the decoding can't be optimized away.
+    DI_ASSERT(total > 0 || corpus.data.empty());
+    return sample;
+}
+
+static auto bench_parse(Corpus const& corpus, u32 iterations) -> Sample {
+    auto total = 0_usize;
+    auto sample = measure(corpus.data.size() * iterations, [&] {
+        for (auto _ : di::range(iterations)) {
+            auto decoder = Utf8StreamDecoder {};
+            auto parser = EscapeSequenceParser {};
+            for (auto offset = 0_usize; offset < corpus.data.size(); offset += chunk_size) {
+                auto chunk = *corpus.data.span().subspan(offset, di::min(chunk_size, corpus.data.size() - offset));
+                decoder.decode_view(chunk, [&](di::StringView text) {
+                    parser.parse(text, [&](auto&&) {
+                        total++;
+                    });
+                });
+            }
+        }
+    });
+
+    DI_ASSERT(total > 0 || corpus.data.empty());
+    return sample;
+}
+
+static auto bench_apply(Corpus const& corpus, u32 iterations) -> Sample {
+    return measure(corpus.data.size() * iterations, [&] {
+        for (auto _ : di::range(iterations)) {
+            auto decoder = Utf8StreamDecoder {};
+            auto parser = EscapeSequenceParser {};
+            auto terminal = Terminal(0, bench_size);
+            for (auto offset = 0_usize; offset < corpus.data.size(); offset += chunk_size) {
+                auto chunk = *corpus.data.span().subspan(offset, di::min(chunk_size, corpus.data.size() - offset));
+                decoder.decode_view(chunk, [&](di::StringView text) {
+                    parser.parse(text, [&](auto&& result) {
+                        terminal.on_parser_result(di::move(result));
+                    });
+                });
+                terminal.flush_line_feeds();
+                (void) terminal.outgoing_events();
+            }
+        }
+    });
+}
+
+static auto replay_corpus(Corpus const& corpus) -> di::Result<di::Box<Pane>> {
+    if (corpus.path) {
+        return Pane::create_from_replay(0, {}, *corpus.path, {}, bench_size, {});
+    }
+
+    // Synthetic corpora only exist in memory, so write them to a unique temporary file. The pane reads the whole
+    // file before returning, so the file is removed right afterwards.
+    char name[] = "/tmp/ttx-bench-corpus-XXXXXX";
+    auto fd = mkstemp(name);
+    if (fd < 0) {
+        return di::Unexpected(di::BasicError(errno));
+    }
+    close(fd);
+
+    auto path = di::Path(di::Span<char const>(name, strlen(name)) | di::to<di::TransparentString>());
+    auto result = write_file(path, corpus.data.span()).and_then([&] {
+        return Pane::create_from_replay(0, {}, path, {}, bench_size, {});
+    });
+    (void) unlink(name);
+    return result;
+}
+
+static auto bench_render(Corpus const& corpus, u32 frames, dius::SyncFile& output) -> di::Result<Sample> {
+    // Replay the corpus into a real pane, and then measure drawing it. Every other frame redraws the whole screen,
+    // while the rest measure the cost of a frame where nothing has changed.
+    auto pane = TRY(replay_corpus(corpus));
+    auto renderer = Renderer();
+    auto result = di::Result<> {};
+    auto sample = measure(0, [&] {
+        for (auto frame : di::range(frames)) {
+            if (frame % 2 == 0) {
+                pane->invalidate_all();
+            }
+            renderer.start(bench_size);
+            renderer.set_bound(0, 0, bench_size.cols, bench_size.rows);
+            auto cursor = pane->draw(renderer);
+            if (auto written = renderer.finish(output, cursor); !written) {
+                result = written;
+                return;
+            }
+        }
+    });
+    TRY(result);
+    return sample;
+}
+
+static auto main(Args& args) -> di::Result<void> {
+    auto corpora = make_synthetic_corpora(usize(args.synthetic_mib) * 1024 * 1024);
+    if (args.synthetic_mib == 0) {
+        corpora.clear();
+    }
+    for (auto capture : args.captures) {
+        auto path = di::PathView(capture).to_owned();
+        auto name = path.filename().transform([](di::TransparentStringView filename) {
+            return filename | di::transform(di::construct<c8>) | di::to<di::String>(di::encoding::assume_valid);
+        });
+        corpora.push_back({ name.value_or("capture"_s), TRY(read_file(path)), di::move(path) });
+    }
+
+    auto output = TRY(dius::open_sync("/dev/null"_pv, dius::OpenMode::ReadWrite));
+
+    // When the peak can't be reset, it's the peak of the whole process so far, which hides the usage of each stage
+    // behind the largest one before it. Label it as such, so it isn't mistaken for a per stage measurement.
+    s_per_stage_peak_rss = reset_peak_rss();
+    auto rss_label = s_per_stage_peak_rss ? "peak RSS KiB"_sv : "cum. RSS KiB"_sv;
+    if (!s_per_stage_peak_rss) {
+        dius::println("note: the peak RSS can't be reset, so it is the cumulative peak of the process"_sv);
+    }
+    dius::println("{: <28}{: <14}{: >12}{: >12}{: >14}{: >14}{: >12}"_sv, "corpus"_sv, "stage"_sv, "MB/s"_sv,
+                  "ns/byte"_sv, "allocations"_sv, "alloc KiB"_sv, rss_label);
+
+    // Each stage includes the work of the previous ones, since output can't be parsed without decoding it first.
+    auto total_bytes = u64(0);
+    auto total_nanoseconds = u64(0);
+    auto total_peak_rss_kib = u64(0);
+    for (auto const& corpus : corpora) {
+        auto decode = bench_decode(corpus, args.iterations);
+        report(corpus.name, "decode"_sv, decode);
+        auto parse = bench_parse(corpus, args.iterations);
+        report(corpus.name, "+parse"_sv, parse);
+
+        auto apply = bench_apply(corpus, args.iterations);
+        report(corpus.name, "+apply"_sv, apply);
+        total_bytes += apply.bytes;
+        total_nanoseconds += apply.nanoseconds;
+
+        auto render = TRY(bench_render(corpus, args.frames, output));
+        report(corpus.name, "render"_sv, render);
+        for (auto const& sample : { decode, parse, apply, render }) {
+            total_peak_rss_kib = di::max(total_peak_rss_kib, sample.peak_rss_kib);
+        }
+        dius::println("{: <28}{: <14}{: >12}"_sv, ""_sv, "ns/frame"_sv,
+                      render.nanoseconds / di::max(u64(args.frames), u64(1)));
+    }
+
+    report("total"_sv, "+apply"_sv,
+           { .nanoseconds = total_nanoseconds, .bytes = total_bytes, .peak_rss_kib = total_peak_rss_kib });
+    return {};
+}
+}
+
+DIUS_MAIN(ttx::bench::Args, ttx::bench)
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "di/container/string/string_view.h"
+#include "di/vocab/array/prelude.h"
+#include "di/vocab/optional/prelude.h"
+
+namespace ttx {
+template<typename Value>
+struct DispatchEntry {
+    u64 key { 0 };
+    Value value {};
+};
+
+// Use at least 4 slots per key, which makes finding a perfect hash quick.
+constexpr auto dispatch_slot_bits(usize count) -> usize {
+    auto bits = 0_usize;
+    while ((1_usize << bits) < count * 4) {
+        bits++;
+    }
+    return bits;
+}
+
+// A perfect hash table mapping a fixed set of integer keys to values, generated at compile time. Each key maps to a
+// distinct slot, so a lookup is a multiply, a shift, and a single key comparison.
+template<typename Value, usize count, usize slot_bits = dispatch_slot_bits(count)>
+class DispatchTable {
+public:
+    constexpr static auto slot_count = 1_usize << slot_bits;
+
+    consteval explicit DispatchTable(di::Array<DispatchEntry<Value>, count> const& entries) : m_entries(entries) {
+        static_assert(count < slot_count);
+
+        // Search for a multiplier which maps the keys to distinct slots. The candidates are generated using
+        // splitmix64, which produces well distributed odd multipliers. Failing to find one is a compile error.
+        auto state = u64(0x9E3779B97F4A7C15);
+        for (auto attempt = 0_usize; attempt < 100000; attempt++) {
+            state += 0x9E3779B97F4A7C15;
+            auto z = state;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+            m_multiplier = (z ^ (z >> 31)) | 1;
+
+            if (try_fill()) {
+                return;
+            }
+        }
+        DI_ASSERT(false);
+    }
+
+    constexpr auto find(u64 key) const -> Value const* {
+        auto index = m_slots[slot(key)];
+        if (index == empty_slot || m_entries[index].key != key) {
+            return nullptr;
+        }
+        return &m_entries[index].value;
+    }
+
+private:
+    constexpr static auto empty_slot = u8(0xFF);
+
+    static_assert(count < empty_slot);
+
+    constexpr auto slot(u64 key) const -> usize { return usize((key * m_multiplier) >> (64 - slot_bits)); }
+
+    consteval auto try_fill() -> bool {
+        for (auto& index : m_slots) {
+            index = empty_slot;
+        }
+        for (auto i = 0_usize; i < count; i++) {
+            auto& index = m_slots[slot(m_entries[i].key)];
+            if (index != empty_slot) {
+                return false;
+            }
+            index = u8(i);
+        }
+        return true;
+    }
+
+    di::Array<DispatchEntry<Value>, count> m_entries {};
+    di::Array<u8, slot_count> m_slots {};
+    u64 m_multiplier { 0 };
+};
+
+// Compute the dispatch key for a sequence identified by its intermediate characters and terminator. Intermediate
+// characters are always ASCII, so up to 4 of them are packed alongside the terminator. Sequences with more
+// intermediate characters than that are never recognized.
+constexpr auto dispatch_key(di::StringView intermediate, c32 terminator) -> di::Optional<u64> {
+    auto packed = u64(0);
+    auto size = 0_usize;
+    for (auto code_point : intermediate) {
+        if (++size > 4) {
+            return {};
+        }
+        packed = (packed << 8) | u64(code_point);
+    }
+    return (packed << 32) | u64(terminator);
+}
+
+// Compute the dispatch key for an OSC from its numeric parameter (the text before the first ';'), which must be a
+// decimal number without leading zeros.
+constexpr auto dispatch_key(di::StringView ps) -> di::Optional<u64> {
+    auto value = u64(0);
+    auto size = 0_usize;
+    for (auto code_point : ps) {
+        if (code_point < '0' || code_point > '9' || (size > 0 && value == 0) || ++size > 9) {
+            return {};
+        }
+        value = value * 10 + u64(code_point - '0');
+    }
+    if (size == 0) {
+        return {};
+    }
+    return value;
+}
+}
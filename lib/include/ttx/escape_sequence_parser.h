@@ -2,10 +2,11 @@
 
 #include "di/container/string/string.h"
 #include "di/container/string/string_view.h"
-#include "di/function/container/function.h"
+#include "di/function/container/function_ref.h"
 #include "di/reflect/prelude.h"
 #include "di/vocab/variant/prelude.h"
 #include "ttx/features.h"
+#include "ttx/inline_vector.h"
 #include "ttx/params.h"
 
 namespace ttx {
@@ -19,8 +20,62 @@ struct PrintableCharacter {
     }
 };
 
+// A run of consecutive printable code points. The text is a view into the input passed to the parser,
+// and so is only valid as long as that input is.
+struct PrintableRun {
+    di::StringView text;
+
+    auto operator==(PrintableRun const&) const -> bool = default;
+
+    constexpr friend auto tag_invoke(di::Tag<di::reflect>, di::InPlaceType<PrintableRun>) {
+        return di::make_fields<"PrintableRun">(di::field<"text", &PrintableRun::text>);
+    }
+};
+
+// The intermediate characters of an escape sequence, including private markers like '?'. These are always ASCII and
+// there are rarely more than a couple, so they are stored inline.
+class Intermediate {
+public:
+    constexpr static auto inline_capacity = 4_usize;
+
+    Intermediate() = default;
+
+    Intermediate(di::StringView view) {
+        for (auto code_point : view) {
+            push_back(code_point);
+        }
+    }
+    Intermediate(di::String const& string) : Intermediate(string.view()) {}
+
+    auto clone() const -> Intermediate {
+        auto result = Intermediate {};
+        result.m_bytes = m_bytes.clone();
+        return result;
+    }
+
+    void push_back(c32 code_point) {
+        DI_ASSERT(code_point < 0x80);
+        m_bytes.push_back(c8(code_point));
+    }
+    void clear() { m_bytes.clear(); }
+
+    auto empty() const -> bool { return m_bytes.empty(); }
+    auto view() const -> di::StringView {
+        auto const* data = m_bytes.data();
+        return di::StringView(di::encoding::assume_valid, data, data + m_bytes.size());
+    }
+
+    auto to_string() const -> di::String { return view() | di::to<di::String>(); }
+
+    auto operator==(Intermediate const&) const -> bool = default;
+    friend auto operator==(Intermediate const& a, di::StringView b) -> bool { return a.view() == b; }
+
+private:
+    InlineVector<c8, inline_capacity> m_bytes;
+};
+
 struct DCS {
-    di::String intermediate;
+    Intermediate intermediate;
     Params params;
     di::String data;
 
@@ -54,7 +109,7 @@ struct APC {
 };
 
 struct CSI {
-    di::String intermediate {};
+    Intermediate intermediate {};
     Params params {};
     c32 terminator = 0;
 
@@ -67,7 +122,7 @@ struct CSI {
 };
 
 struct Escape {
-    di::String intermediate;
+    Intermediate intermediate;
     c32 terminator = 0;
 
     auto operator==(Escape const&) const -> bool = default;
@@ -90,7 +145,7 @@ struct ControlCharacter {
     }
 };
 
-using ParserResult = di::Variant<PrintableCharacter, DCS, OSC, APC, CSI, Escape, ControlCharacter>;
+using ParserResult = di::Variant<PrintableCharacter, PrintableRun, DCS, OSC, APC, CSI, Escape, ControlCharacter>;
 
 class EscapeSequenceParser {
 public:
@@ -99,6 +154,17 @@ public:
         Input,
     };
 
+    // Parse application output, dispatching each result to the visitor as
+    // soon as it is recognized. The visitor is called with each alternative
+    // of ParserResult. Unlike parse_application_escape_sequences(), no results
+    // are stored, so any views in the results are only valid during the call.
+    template<typename Visitor>
+    void parse(di::StringView data, Visitor&& visitor) {
+        parse_application(data, [&](ParserResult&& result) {
+            di::visit(visitor, di::move(result));
+        });
+    }
+
     auto parse_application_escape_sequences(di::StringView data) -> di::Span<ParserResult>;
     auto parse_input_escape_sequences(di::StringView data, Feature features = Feature::None, bool flush = true)
         -> di::Span<ParserResult>;
@@ -127,18 +193,37 @@ private:
     M(ApcString, apc_string)                   \
     M(SosPmString, sos_pm_string)
 
-    enum class State {
+    enum class State : u8 {
 #define __ENUMERATE_STATE(N, n) N,
         __ENUMERATE_STATES(__ENUMERATE_STATE)
 #undef __ENUMERATE_STATE
     };
 
-#define __ENUMERATE_STATE(N, n) void n##_state(c32 code_point);
-    __ENUMERATE_STATES(__ENUMERATE_STATE)
-#undef __ENUMERATE_STATE
+    // The state machine is driven by tables indexed by state and character
+    // class, which are generated at compile time. These types are defined in
+    // the implementation file.
+    enum class CharClass : u8;
+    enum class Action : u8;
+    struct Transition;
+
+    enum class ExitAction : u8 {
+        None,
+        AddParam,
+        Unhook,
+        OscEnd,
+        ApcEnd,
+    };
+
+    constexpr static auto classify(c32 code_point) -> CharClass;
+    constexpr static auto make_transition_table(Mode mode);
+
+    using Sink = di::FunctionRef<void(ParserResult&&)>;
+
+    void parse_application(di::StringView data, Sink sink);
+    void emit(ParserResult&& result);
 
-    void ignore(c32 code_point);
     void print(c32 code_point);
+    void print_run(di::StringView text);
     void execute(c32 code_point);
     void clear();
     void collect(c32 code_point);
@@ -149,14 +234,14 @@ private:
     void put(c32 code_point);
     void unhook();
     void osc_start();
-    void osc_put(c32 code_point);
     void osc_end();
     void apc_start();
-    void apc_put(c32 code_point);
     void apc_end();
     void output_ss3(c32 code_point);
 
     void transition(State state);
+    void enter(State state);
+    void perform(Transition const& transition, c32 code_point);
 
     void on_input(c32 code_point);
 
@@ -164,9 +249,9 @@ private:
 
     State m_last_state { State::Ground };
     State m_next_state { State::Ground };
-    di::Function<void()> m_on_state_exit;
+    ExitAction m_on_state_exit { ExitAction::None };
 
-    di::String m_intermediate;
+    Intermediate m_intermediate;
     di::String m_current_param;
     di::String m_data;
     Params m_params;
@@ -175,5 +260,6 @@ private:
     c32 m_prev {};
     Mode m_mode { Mode::Application };
     di::Vector<ParserResult> m_result;
+    Sink* m_sink { nullptr };
 };
 }
@@ -44,6 +44,9 @@ struct Color {
     u8 g = 0;
     u8 b = 0;
 
+    /// Pack the color into 32 bits, which uniquely identifies it.
+    constexpr auto packed() const -> u32 { return u32(type) << 24 | u32(r) << 16 | u32(g) << 8 | u32(b); }
+
     auto operator==(Color const& other) const -> bool = default;
     auto operator<=>(Color const& other) const = default;
 
@@ -135,6 +138,15 @@ struct GraphicsRendition {
     auto as_csi_params(Feature features = Feature::None, di::Optional<GraphicsRendition const&> prev = {}) const
         -> di::Vector<Params>;
 
+    /// Hash used to deduplicate graphics renditions in an IdMap.
+    constexpr auto hash() const -> u64 {
+        auto colors = u64(fg.packed()) | u64(bg.packed()) << 32;
+        auto rest = u64(underline_color.packed()) | u64(font_weight) << 32 | u64(blink_mode) << 36 |
+                    u64(underline_mode) << 40 | u64(italic) << 44 | u64(overline) << 45 | u64(inverted) << 46 |
+                    u64(invisible) << 47 | u64(strike_through) << 48;
+        return colors ^ (rest * 0x9E3779B97F4A7C15);
+    }
+
     auto operator==(GraphicsRendition const& other) const -> bool = default;
     auto operator<=>(GraphicsRendition const& other) const = default;
 
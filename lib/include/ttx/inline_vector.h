@@ -0,0 +1,89 @@
+#pragma once
+
+#include "di/container/vector/vector.h"
+#include "di/util/exchange.h"
+#include "di/vocab/array/prelude.h"
+#include "di/vocab/span/prelude.h"
+
+namespace ttx {
+// A vector of trivially copyable values which stores up to inline_capacity
+// elements without allocating. Once the inline capacity is exceeded, all
+// elements are moved to the heap.
+//
+// This is used for escape sequence parameters and intermediates, which are
+// nearly always tiny but can be arbitrarily long for pathological input.
+template<typename T, usize inline_capacity>
+class InlineVector {
+public:
+    InlineVector() = default;
+
+    constexpr InlineVector(InlineVector&& other)
+        : m_inline(other.m_inline), m_spill(di::move(other.m_spill)), m_size(di::exchange(other.m_size, 0)) {}
+
+    constexpr auto operator=(InlineVector&& other) -> InlineVector& {
+        m_inline = other.m_inline;
+        m_spill = di::move(other.m_spill);
+        m_size = di::exchange(other.m_size, 0);
+        return *this;
+    }
+
+    constexpr auto clone() const -> InlineVector {
+        auto result = InlineVector {};
+        for (auto const& value : span()) {
+            result.push_back(value);
+        }
+        return result;
+    }
+
+    constexpr auto data() const -> T const* { return spilled() ? m_spill.data() : m_inline.data(); }
+    constexpr auto data() -> T* { return spilled() ? m_spill.data() : m_inline.data(); }
+
+    constexpr auto size() const -> usize { return m_size; }
+    constexpr auto empty() const -> bool { return m_size == 0; }
+
+    constexpr auto span() const -> di::Span<T const> { return di::Span<T const>(data(), m_size); }
+
+    constexpr auto operator[](usize index) const -> T const& {
+        DI_ASSERT(index < m_size);
+        return data()[index];
+    }
+
+    constexpr void push_back(T value) {
+        if (m_size < inline_capacity) {
+            m_inline[m_size++] = value;
+            return;
+        }
+
+        // Spill path: move the inline elements to the heap the first time the inline capacity is exceeded.
+        if (m_size == inline_capacity) {
+            m_spill.clear();
+            for (auto const& inline_value : m_inline) {
+                m_spill.push_back(inline_value);
+            }
+        }
+        m_spill.push_back(value);
+        m_size++;
+    }
+
+    constexpr void clear() { m_size = 0; }
+
+    constexpr auto operator==(InlineVector const& other) const -> bool {
+        if (size() != other.size()) {
+            return false;
+        }
+        for (auto i = 0_usize; i < size(); i++) {
+            if (!((*this)[i] == other[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    constexpr auto spilled() const -> bool { return m_size > inline_capacity; }
+
+    di::Array<T, inline_capacity> m_inline {};
+    di::Vector<T> m_spill;
+    usize m_size { 0 };
+};
+}
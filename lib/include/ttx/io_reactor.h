@@ -0,0 +1,110 @@
+#pragma once
+
+#include "di/container/queue/queue.h"
+#include "di/container/tree/tree_map.h"
+#include "di/container/vector/vector.h"
+#include "di/function/container/function.h"
+#include "di/sync/atomic.h"
+#include "di/sync/synchronized.h"
+#include "di/vocab/error/result.h"
+#include "di/vocab/optional/prelude.h"
+#include "di/vocab/pointer/box.h"
+#include "dius/condition_variable.h"
+#include "dius/thread.h"
+
+namespace ttx {
+/// @brief Event loop which services many file descriptors with a fixed number of threads.
+///
+/// A single poller thread waits for registered file descriptors to become readable, and hands
+/// their handlers to a pool of worker threads. A file descriptor is not polled again until
+/// its handler returns, so handlers for a single registration never run concurrently.
+///
+/// Each worker has its own queue of ready registrations. A registration is queued on the worker
+/// which last ran it, and idle workers steal from the others, so busy registrations are spread
+/// across all cores and a long running handler doesn't hold up the registrations queued behind it.
+/// The registrations themselves are kept in a single table, whose lock is only held for bookkeeping
+/// (never while a handler runs), since removing a registration must wait for its handler.
+///
+/// This is used to read the output of every pane, so that the number of threads stays constant
+/// as panes are added. It is currently only implemented on Linux (using epoll and pidfd).
+class IoReactor {
+public:
+    /// @brief Callback run on a worker thread when a file descriptor is readable.
+    ///
+    /// Returning false stops polling the file descriptor. The registration must still be removed.
+    using Handler = di::Function<bool()>;
+
+    /// @brief Get the process-wide reactor, creating it on first use.
+    ///
+    /// This returns nullptr if the reactor is unsupported on this platform, could not be
+    /// created or has failed, in which case callers should fall back to blocking I/O on
+    /// dedicated threads.
+    static auto shared() -> IoReactor*;
+
+    /// @brief Create a reactor from an epoll file descriptor and an eventfd, taking ownership of both.
+    ///
+    /// This is only needed to control the file descriptors, like when testing how polling errors are handled.
+    static auto create(i32 poll_fd, i32 wake_fd) -> di::Result<di::Box<IoReactor>>;
+
+    explicit IoReactor(i32 poll_fd, i32 wake_fd) : m_poll_fd(poll_fd), m_wake_fd(wake_fd) {}
+    ~IoReactor();
+
+    /// @brief Call handler whenever fd is readable.
+    auto add(i32 fd, Handler handler) -> di::Result<u64>;
+
+    /// @brief Call handler once the process identified by pid exits.
+    auto add_process(i32 pid, Handler handler) -> di::Result<u64>;
+
+    /// @brief Remove a registration, waiting for its handler to finish if it is currently running.
+    void remove(u64 id);
+
+    /// @brief Check if polling failed, in which case no more handlers will run
+    ///
+    /// The error is written to stderr. Adding registrations to a failed reactor also fails.
+    auto failed() const -> bool { return m_failed.load(di::MemoryOrder::Acquire); }
+
+private:
+    constexpr static auto min_worker_count = 2_usize;
+    constexpr static auto max_worker_count = 16_usize;
+
+    struct Worker {
+        di::Synchronized<di::Queue<u64>> queue;
+        dius::Thread thread;
+    };
+
+    struct Registration {
+        i32 fd { -1 };
+        usize worker { 0 };
+        bool owns_fd { false };
+        bool running { false };
+        bool removed { false };
+        bool detached { false };
+        Handler handler;
+    };
+
+    struct State {
+        di::TreeMap<u64, Registration> registrations;
+        u64 next_id { 1 };
+    };
+
+    static auto create() -> di::Result<di::Box<IoReactor>>;
+
+    auto add(i32 fd, bool owns_fd, Handler handler) -> di::Result<u64>;
+    void stop();
+    void poll_thread();
+    void worker_thread(usize index);
+    auto take_ready(usize index) -> di::Optional<u64>;
+
+    i32 m_poll_fd { -1 };
+    i32 m_wake_fd { -1 };
+    di::Atomic<bool> m_done { false };
+    di::Atomic<bool> m_failed { false };
+    di::Atomic<usize> m_pending { 0 };
+    di::Synchronized<State> m_state;
+    dius::ConditionVariable m_condition;
+
+    // These are declared last, so that the threads are joined before anything else is destroyed.
+    dius::Thread m_poll_thread;
+    di::Vector<di::Box<Worker>> m_workers;
+};
+}
@@ -12,11 +12,13 @@
 #include "dius/system/process.h"
 #include "dius/thread.h"
 #include "ttx/direction.h"
+#include "ttx/io_reactor.h"
 #include "ttx/key_event.h"
 #include "ttx/mouse.h"
 #include "ttx/mouse_click_tracker.h"
 #include "ttx/paste_event.h"
 #include "ttx/renderer.h"
+#include "ttx/scroll_back_governor.h"
 #include "ttx/size.h"
 #include "ttx/terminal.h"
 #include "ttx/terminal/escapes/osc_52.h"
@@ -60,6 +62,8 @@ struct CreatePaneArgs {
                  pipe_input.clone(),
                  cwd.clone(),
                  terminfo_dir.clone(),
+                 scroll_back_limit,
+                 scroll_back_spill_dir.clone(),
                  term,
                  pipe_output,
                  mock,
@@ -79,6 +83,8 @@ struct CreatePaneArgs {
     di::Optional<di::String> pipe_input {};
     di::Optional<di::Path> cwd {};
     di::Optional<di::Path> terminfo_dir {};
+    di::Optional<usize> scroll_back_limit {};        ///< Maximum number of cells in the scroll back.
+    di::Optional<di::Path> scroll_back_spill_dir {}; ///< Directory to write scroll back evicted from memory.
     di::TransparentStringView term { "xterm-ttx"_tsv };
     bool pipe_output { false };
     bool mock { false };
@@ -129,6 +135,17 @@ public:
     void scroll_to_bottom();
     void scroll_prev_command();
     void scroll_next_command();
+
+    /// @brief Search the scroll back for text, scrolling to the closest match
+    ///
+    /// An empty pattern clears the search. Matches are highlighted until the search is cleared.
+    ///
+    /// @return Whether a match was found (false if the regular expression is invalid)
+    auto search(di::StringView pattern, bool regex) -> bool;
+    void search_prev();
+    void search_next();
+    void clear_search();
+
     void copy_last_command(bool include_command);
     auto save_state(di::PathView path) -> di::Result<>;
     void send_clipboard(terminal::SelectionType selection_type, di::Vector<byte> data);
@@ -145,12 +162,31 @@ public:
     /// reports, which require shell integration to work.
     auto current_working_directory() const -> di::Optional<di::PathView> { return m_cwd.transform(&di::Path::view); }
 
+    /// @brief Get the time the pane was last drawn, used to discard scroll back from idle panes first
+    auto last_viewed() const -> i64 { return m_last_viewed.load(di::MemoryOrder::Relaxed); }
+
+    /// @brief Limit the memory used by the pane's scroll back (see terminal::ScrollBack::cells_for_mib())
+    ///
+    /// Lowering the limit immediately discards (or spills) the oldest rows.
+    void set_scroll_back_limit(usize max_cells);
+
+    /// @brief Discard the oldest group of rows in the scroll back
+    ///
+    /// @return The number of cells discarded (0 if the scroll back is empty)
+    auto discard_oldest_scroll_back() -> usize;
+
 private:
+    struct PtyReader;
+
+    auto read_pty_output(PtyReader& reader) -> bool;
+    void wait_for_process_exit();
+
     void handle_terminal_event(TerminalEvent&& event);
     void write_pty_string(di::StringView data);
     void write_pty_string(di::TransparentStringView data);
     void update_selection_after_scrolling();
 
+    void update_scroll_back_usage(Terminal& terminal);
     void update_cwd(terminal::OSC7&& path_with_hostname);
     void reset_viewport_scroll();
 
@@ -166,12 +202,24 @@ private:
     di::Optional<Size> m_desired_visible_size;
     dius::system::ProcessHandle m_process;
 
+    // Scroll back usage last reported to the governor. This is only accessed while holding the terminal lock.
+    ScrollBackGovernor* m_governor { nullptr };
+    u64 m_governor_id { 0 };
+    usize m_scroll_back_cells { 0 };
+    di::Atomic<i64> m_last_viewed { 0 };
+
     u32 m_vertical_scroll_offset { 0 };
     u32 m_horizontal_scroll_offset { 0 };
 
     di::Optional<di::Path> m_cwd;
     PaneHooks m_hooks;
 
+    // When the shared reactor is available, the pty and process are serviced by its worker threads
+    // instead of the dedicated threads below.
+    IoReactor* m_reactor { nullptr };
+    di::Optional<u64> m_pty_registration;
+    di::Optional<u64> m_process_registration;
+
     // These are declared last, for when dius::Thread calls join() in the destructor.
     dius::Thread m_process_thread;
     dius::Thread m_reader_thread;
@@ -5,6 +5,7 @@
 #include "di/container/string/string_view.h"
 #include "di/container/vector/vector.h"
 #include "di/util/initializer_list.h"
+#include "ttx/inline_vector.h"
 
 namespace ttx {
 // Paramaters are integer with the addition of nullability.
@@ -64,64 +65,94 @@ private:
 // Represents a series of numeric parameters for an escape
 // sequence. Parameters are separated by `;` characeters, and
 // subparameters are separated by `:` characters.
+//
+// All subparameters are stored contiguously, along with the
+// offset of each parameter's first subparameter. Both are
+// stored inline for typical sequences, so parsing and
+// dispatching a sequence doesn't allocate.
 class Params {
 public:
+    constexpr static auto inline_capacity = 16_usize;
+
     static auto from_string(di::StringView view) -> Params;
 
     Params() = default;
 
     constexpr Params(std::initializer_list<std::initializer_list<Param>> params) {
         for (auto const& subparams : params) {
-            m_parameters.emplace_back(subparams);
+            add_empty_param();
+            for (auto const& subparam : subparams) {
+                m_values.push_back(subparam);
+            }
         }
     }
 
-    constexpr auto clone() const -> Params { return Params(m_parameters.clone()); }
+    constexpr auto clone() const -> Params {
+        auto result = Params {};
+        result.m_values = m_values.clone();
+        result.m_offsets = m_offsets.clone();
+        return result;
+    }
 
     constexpr auto get(usize index = 0, u32 fallback = 0) const -> u32 {
-        return m_parameters.at(index).and_then(di::at(0)).value_or(Param(fallback)).value_or(fallback);
+        return get_subparam(index, 0, fallback);
     }
     constexpr auto get_subparam(usize index = 0, usize subindex = 1, u32 fallback = 0) const -> u32 {
-        return m_parameters.at(index).and_then(di::at(subindex)).value_or(Param(fallback)).value_or(fallback);
+        auto subparams = subparam_span(index);
+        if (subindex >= subparams.size()) {
+            return fallback;
+        }
+        return subparams[subindex].value_or(fallback);
     }
 
-    constexpr auto empty() const { return m_parameters.empty(); }
-    constexpr auto size() const { return m_parameters.size(); }
+    constexpr auto empty() const { return m_offsets.empty(); }
+    constexpr auto size() const { return m_offsets.size(); }
 
-    constexpr auto subparams(usize index = 0) const -> Subparams {
-        auto span = m_parameters.at(index)
-                        .transform([&](auto const& subparams) {
-                            return subparams.span();
-                        })
-                        .value_or(di::Span<Param const> {});
-        return Subparams(span);
-    }
+    constexpr auto subparams(usize index = 0) const -> Subparams { return Subparams(subparam_span(index)); }
 
-    constexpr void add_empty_param() { m_parameters.emplace_back(); }
-    constexpr void add_param(u32 value) { m_parameters.push_back({ value }); }
+    constexpr void add_empty_param() { m_offsets.push_back(u32(m_values.size())); }
+    constexpr void add_param(u32 value) {
+        add_empty_param();
+        m_values.push_back(value);
+    }
 
+    // Subparameters are always added to the last parameter, which
+    // owns the end of the value list.
     constexpr void add_subparam(u32 value) {
         if (empty()) {
             add_param(value);
         } else {
-            m_parameters.back().value().push_back(value);
+            m_values.push_back(value);
         }
     }
     constexpr void add_empty_subparam() {
         if (empty()) {
             add_empty_param();
         }
-        m_parameters.back().value().emplace_back();
+        m_values.push_back(Param());
+    }
+    constexpr void add_subparams(di::Vector<Param> subparams) {
+        add_empty_param();
+        for (auto const& subparam : subparams) {
+            m_values.push_back(subparam);
+        }
     }
-    constexpr void add_subparams(di::Vector<Param> subparams) { m_parameters.push_back(di::move(subparams)); }
 
     auto to_string() const -> di::String;
 
     auto operator==(Params const& other) const -> bool = default;
 
 private:
-    constexpr explicit Params(di::Vector<di::Vector<Param>> params) : m_parameters(di::move(params)) {}
+    constexpr auto subparam_span(usize index) const -> di::Span<Param const> {
+        if (index >= size()) {
+            return {};
+        }
+        auto start = usize(m_offsets[index]);
+        auto end = index + 1 < size() ? usize(m_offsets[index + 1]) : m_values.size();
+        return *m_values.span().subspan(start, end - start);
+    }
 
-    di::Vector<di::Vector<Param>> m_parameters;
+    InlineVector<Param, inline_capacity> m_values;
+    InlineVector<u32, inline_capacity> m_offsets;
 };
 }
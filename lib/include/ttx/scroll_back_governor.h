@@ -0,0 +1,63 @@
+#pragma once
+
+#include "di/container/tree/tree_map.h"
+#include "di/function/container/function.h"
+#include "di/math/numeric_limits.h"
+#include "di/sync/atomic.h"
+#include "di/sync/synchronized.h"
+
+namespace ttx {
+/// @brief Bounds the total number of cells stored in the scroll back of every pane
+///
+/// Each pane reports how many cells its scroll back uses after processing output. When the
+/// total exceeds the budget, the oldest rows are discarded, starting with the panes which were
+/// least recently viewed. Rows are discarded in whole row groups, so the budget is approximate.
+///
+/// Usage is tracked with atomics, so reporting never blocks. Enforcing the budget locks one
+/// pane's terminal at a time, so it must not be called while holding any terminal lock.
+class ScrollBackGovernor {
+public:
+    constexpr static auto unlimited = di::NumericLimits<usize>::max;
+
+    /// @brief Callbacks used to trim a tracked scroll back
+    struct Member {
+        di::Function<i64()> last_viewed;      ///< Time the scroll back was last drawn. Older ones are trimmed first.
+        di::Function<usize()> discard_oldest; ///< Discard the oldest rows, returning the cells released (0 if none).
+    };
+
+    /// @brief Get the process-wide governor
+    static auto shared() -> ScrollBackGovernor&;
+
+    auto max_cells() const -> usize { return m_max_cells.load(di::MemoryOrder::Relaxed); }
+    void set_max_cells(usize max_cells) { m_max_cells.store(max_cells, di::MemoryOrder::Relaxed); }
+
+    auto total_cells() const -> usize { return m_total_cells.load(di::MemoryOrder::Relaxed); }
+    auto over_budget() const -> bool { return total_cells() > max_cells(); }
+
+    /// @brief Start tracking a scroll back, which starts out empty
+    ///
+    /// @return The id used to remove the member
+    auto add(Member member) -> u64;
+
+    /// @brief Stop tracking a scroll back, which must no longer report usage
+    void remove(u64 id, usize cells);
+
+    /// @brief Record that a scroll back changed from old_cells to new_cells
+    void update_usage(usize old_cells, usize new_cells);
+
+    /// @brief Discard scroll back from the least recently viewed members until within budget
+    ///
+    /// The discard callbacks are expected to report their new usage with update_usage().
+    void enforce();
+
+private:
+    struct State {
+        di::TreeMap<u64, Member> members;
+        u64 next_id { 1 };
+    };
+
+    di::Atomic<usize> m_total_cells { 0 };
+    di::Atomic<usize> m_max_cells { unlimited };
+    di::Synchronized<State> m_state;
+};
+}
@@ -45,6 +45,16 @@ class Terminal {
         explicit ScreenState(Size const& size, terminal::Screen::ScrollBackEnabled scroll_back_enabled)
             : screen(size, scroll_back_enabled) {}
 
+        void reset(Size const& size) {
+            screen.reset(size);
+            saved_cursor = {};
+            cursor_style = CursorStyle::SteadyBar;
+            m_key_reporting_flags = KeyReportingFlags::None;
+            m_key_reporting_flags_stack.clear();
+            m_seamless_navigate_protocol_active = false;
+            m_seamless_navigate_protocol_hide_cursor_on_enter = false;
+        }
+
         terminal::Screen screen;
         di::Optional<terminal::SavedCursor> saved_cursor;
         CursorStyle cursor_style { CursorStyle::SteadyBar };
@@ -66,7 +76,20 @@ public:
     // having state identical to the current state.
     auto state_as_escape_sequences() const -> di::String;
 
-    void on_parser_results(di::Span<ParserResult> results);
+    // Handle individual parser results. These are public so that the terminal
+    // can consume the output of EscapeSequenceParser::parse() directly.
+    void on_parser_result(PrintableCharacter&& printable_character);
+    void on_parser_result(PrintableRun&& printable_run);
+    void on_parser_result(DCS&& dcs);
+    void on_parser_result(OSC&& osc);
+    void on_parser_result(APC&& apc);
+    void on_parser_result(CSI&& csi);
+    void on_parser_result(Escape&& escape);
+    void on_parser_result(ControlCharacter&& control);
+
+    // Apply any line feeds which are still queued. This must be called once
+    // a batch of parser results has been handled, before reading the screen.
+    void flush_line_feeds();
 
     auto active_screen() const -> ScreenState const&;
     auto active_screen() -> ScreenState& {
@@ -85,6 +108,14 @@ public:
     auto total_rows() const -> u32 { return row_count(); }
     auto visual_scroll_offset() const -> u64 { return active_screen().screen.visual_scroll_offset(); }
 
+    // Scroll back limits only apply to the primary screen, since the alternate screen has no scroll back.
+    void set_scroll_back_limit(usize max_cells) { m_primary_screen.screen.set_scroll_back_limit(max_cells); }
+    auto scroll_back_cells() const -> usize { return m_primary_screen.screen.scroll_back_cells(); }
+    auto discard_oldest_scroll_back() -> usize { return m_primary_screen.screen.discard_oldest_scroll_back(); }
+    void set_scroll_back_spill(di::Box<terminal::ScrollBackSpill> spill) {
+        m_primary_screen.screen.set_scroll_back_spill(di::move(spill));
+    }
+
     auto row_count() const -> u32 { return active_screen().screen.max_height(); }
     auto col_count() const -> u32 { return active_screen().screen.max_width(); }
     auto size() const -> Size { return active_screen().screen.size(); }
@@ -129,17 +160,11 @@ private:
     template<auto>
     friend auto make_mode_handler() -> ModeHandler;
 
-    void on_parser_result(PrintableCharacter&& printable_character);
-    void on_parser_result(DCS&& dcs);
-    void on_parser_result(OSC&& osc);
-    void on_parser_result(APC&& apc);
-    void on_parser_result(CSI&& csi);
-    void on_parser_result(Escape&& escape);
-    void on_parser_result(ControlCharacter&& control);
-
     void resize(Size const& size);
 
     void put_char(c32 c);
+    void queue_line_feed();
+    auto defer_text_run(di::StringView text) -> bool;
 
     // TODO: vertical and horizontal scrolling regions.
     auto min_row_inclusive() const -> u32 { return 0; }
@@ -227,6 +252,9 @@ private:
     ScreenState m_primary_screen;
     di::Box<ScreenState> m_alternate_screen;
 
+    // The alternate screen is kept after leaving it, so that entering it again doesn't need to allocate.
+    di::Box<ScreenState> m_cached_alternate_screen;
+
     Size m_available_size;
     bool m_80_col_mode { false };
     bool m_132_col_mode { false };
@@ -234,6 +262,18 @@ private:
     bool m_force_terminal_size { false };
     bool m_allow_force_terminal_size { false };
 
+    // Text written after a queued line feed, which lands in one of the rows added once the line feeds are applied.
+    struct DeferredText {
+        u32 line { 0 }; ///< Number of line feeds queued when the text was written.
+        u32 col { 0 };
+        usize offset { 0 }; ///< Byte offset into m_deferred_text_buffer.
+        usize size { 0 };
+    };
+
+    u32 m_queued_line_feeds { 0 };
+    di::Vector<DeferredText> m_deferred_text;
+    di::String m_deferred_text_buffer;
+
     di::Vector<u32> m_tab_stops;
     bool m_cursor_hidden { false };
     bool m_disable_drawing { false };
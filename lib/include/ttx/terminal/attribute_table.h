@@ -0,0 +1,99 @@
+#pragma once
+
+#include "di/container/string/prelude.h"
+#include "di/vocab/optional/prelude.h"
+#include "ttx/graphics_rendition.h"
+#include "ttx/terminal/hyperlink.h"
+#include "ttx/terminal/id_map.h"
+#include "ttx/terminal/multi_cell_info.h"
+
+namespace ttx::terminal {
+/// @brief Interned cell attributes shared by every row group of a screen
+///
+/// Cells reference their graphics rendition, hyperlink, and multi cell info
+/// indirectly using reference counted ids. Since every row group of a screen
+/// (both the active rows and the scroll back) shares a single table, ids stay
+/// valid when rows are moved between groups, and each distinct attribute is
+/// only stored once per screen. Because the scroll back can reference far
+/// more distinct attributes than there are ids, the screen evicts the oldest
+/// scroll back when an allocation fails.
+///
+/// Id 0 always refers to the default value, and multi cell id 1 always refers
+/// to the standard wide cell.
+class AttributeTable {
+public:
+    explicit AttributeTable() {
+        // Ensure that multi cell ID 1 is the standard wide cell. This allows for
+        // fast path optimizations.
+        ASSERT_EQ(1, m_multi_cell_info.allocate({ wide_multi_cell_info }));
+    }
+
+    auto graphics_rendition(u16 id) const -> GraphicsRendition const&;
+    auto hyperlink(u16 id) const -> Hyperlink const&;
+    auto maybe_hyperlink(u16 id) const -> di::Optional<Hyperlink const&>;
+    auto multi_cell_info(u16 id) const -> MultiCellInfo const&;
+
+    auto graphics_id(GraphicsRendition const& rendition) -> di::Optional<u16> {
+        if (rendition == GraphicsRendition {}) {
+            return 0;
+        }
+        return m_graphics_renditions.lookup_key(rendition);
+    }
+    auto use_graphics_id(u16 id) -> u16 {
+        if (!id) {
+            return 0;
+        }
+        return m_graphics_renditions.use_id(id);
+    }
+    auto allocate_graphics_id(GraphicsRendition const& rendition) -> di::Optional<u16> {
+        return m_graphics_renditions.allocate(rendition);
+    }
+    auto maybe_allocate_graphics_id(GraphicsRendition const& rendition) -> di::Optional<u16>;
+    void drop_graphics_id(u16& id);
+
+    auto hyperlink_id(di::String const& hyperlink_id) -> di::Optional<u16> {
+        return m_hyperlinks.lookup_key(hyperlink_id);
+    }
+    auto use_hyperlink_id(u16 id) -> u16 {
+        if (!id) {
+            return 0;
+        }
+        return m_hyperlinks.use_id(id);
+    }
+    auto allocate_hyperlink_id(Hyperlink&& hyperlink) -> di::Optional<u16> {
+        return m_hyperlinks.allocate(di::move(hyperlink));
+    }
+    auto maybe_allocate_hyperlink_id(Hyperlink const& hyperlink) -> di::Optional<u16>;
+    void drop_hyperlink_id(u16& id);
+
+    auto multi_cell_id(MultiCellInfo const& multi_cell_info) -> di::Optional<u16> {
+        if (multi_cell_info == narrow_multi_cell_info) {
+            return 0;
+        }
+        if (multi_cell_info == wide_multi_cell_info) {
+            return 1;
+        }
+        return m_multi_cell_info.lookup_key(multi_cell_info);
+    }
+    auto use_multi_cell_id(u16 id) -> u16 {
+        if (id <= 1) {
+            return id;
+        }
+        return m_multi_cell_info.use_id(id);
+    }
+    auto allocate_multi_cell_id(MultiCellInfo const& multi_cell_info) -> di::Optional<u16> {
+        return m_multi_cell_info.allocate(multi_cell_info);
+    }
+    auto maybe_allocate_multi_cell_id(MultiCellInfo const& multi_cell_info) -> di::Optional<u16>;
+    void drop_multi_cell_id(u16& id);
+
+private:
+    IdMap<GraphicsRendition> m_graphics_renditions;
+    IdMap<Hyperlink> m_hyperlinks;
+    IdMap<MultiCellInfo> m_multi_cell_info;
+
+    // This empty graphics rendition is used as an optimization so that we can
+    // return by reference in graphics_rendition() when the id == 0.
+    GraphicsRendition m_empty_graphics;
+};
+}
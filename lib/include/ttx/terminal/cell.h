@@ -2,12 +2,14 @@
 
 #include "di/math/numeric_limits.h"
 #include "di/types/integers.h"
+#include "di/vocab/array/prelude.h"
 #include "ttx/graphics_rendition.h"
 
 namespace ttx::terminal {
 /// @brief Represents a on-screen terminal cell
 struct Cell {
     constexpr static auto max_text_size = (di::NumericLimits<u16>::max >> 5);
+    constexpr static auto max_inline_text_size = 4zu; ///< Enough for any single code point.
 
     struct Ids {
         u16 graphics_rendition_id { 0 }; ///< 0 means default
@@ -24,12 +26,19 @@ struct Cell {
     u16 left_boundary_of_multicell : 1 { 0 }; ///< 1 indicates this cell is in the furthest left column of a multicell.
     u16 explicitly_sized : 1 { 0 };           ///< 1 indicates must be rendered using explicit sizing
     u16 complex_grapheme_cluster : 1 { 0 };   ///< 1 indicates this cell consists of multiple non-zero width code points
-    mutable u16 stale : 1 { false };          ///< 1 indicates the cell has ben rendered
+
+    /// Text which fits in max_inline_text_size bytes is stored directly in the cell. Otherwise, the text is stored in
+    /// the owning row's overflow text pool. Use the Row APIs to access the text.
+    union {
+        di::Array<c8, max_inline_text_size> inline_text {};
+        u32 overflow_text_index;
+    };
 
     auto is_multi_cell() const -> bool { return multi_cell_id != 0; }
     auto is_primary_in_multi_cell() const -> bool { return is_multi_cell() && left_boundary_of_multicell; }
     auto is_nonprimary_in_multi_cell() const -> bool { return is_multi_cell() && !is_primary_in_multi_cell(); }
     auto has_ids() const -> bool { return !background_only; }
+    auto has_inline_text() const -> bool { return text_size <= max_inline_text_size; }
 
     auto graphics_rendition_id() const -> u16 { return has_ids() ? ids.graphics_rendition_id : 0; }
     auto hyperlink_id() const -> u16 { return has_ids() ? ids.hyperlink_id : 0; }
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "di/container/ring/prelude.h"
+#include "di/container/vector/vector.h"
+#include "di/vocab/span/prelude.h"
+#include "ttx/terminal/attribute_table.h"
+#include "ttx/terminal/row.h"
+#include "ttx/terminal/row_pool.h"
+
+namespace ttx::terminal {
+/// @brief Compact encoding of a sequence of rows
+///
+/// This is used to store scroll back which isn't being viewed. Consecutive cells with the
+/// same attributes are stored as a single run, followed by the text of each cell in the run.
+/// A typical row of text therefore needs about 1 byte per cell instead of sizeof(Cell).
+///
+/// Attribute ids are stored as is, so the compressed rows keep the references their cells
+/// held in the attribute table. The references are handed back to the cells when the rows
+/// are decompressed.
+class CompressedRows {
+public:
+    /// @brief Encode rows, which are left unmodified
+    static auto compress(di::Ring<Row> const& rows) -> CompressedRows;
+
+    /// @brief Append the encoded rows to rows, using storage from pool when available
+    void decompress(di::Ring<Row>& rows, RowPool& pool) const;
+
+    /// @brief Encode the rows along with the attributes they reference
+    ///
+    /// Unlike the compressed rows, the result doesn't depend on the attribute table, so it can be stored
+    /// outside of memory. The references held by the compressed rows are not released.
+    auto serialize(AttributeTable const& attributes) const -> di::Vector<byte>;
+
+    /// @brief Decode rows encoded by serialize(), adding their attributes to the attribute table
+    static auto deserialize(di::Span<byte const> data, AttributeTable& attributes) -> CompressedRows;
+
+    /// @brief Release the attribute references held by the compressed rows
+    void drop_attributes(AttributeTable& attributes);
+
+    auto total_rows() const -> usize { return m_row_count; }
+    auto size_bytes() const -> usize { return m_data.size(); }
+
+    /// @brief Get the heap memory held by the compressed rows, including unused capacity
+    auto capacity_bytes() const -> usize { return m_data.capacity(); }
+
+private:
+    di::Vector<byte> m_data;
+    usize m_row_count { 0 };
+};
+}
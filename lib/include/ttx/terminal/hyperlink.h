@@ -12,6 +12,7 @@ namespace detail {
         using Key = di::String;
 
         constexpr static auto get_key(Hyperlink const& hyperlink) -> di::String const&;
+        constexpr static auto hash(di::String const& key) -> u64;
     };
 }
 
@@ -52,5 +53,14 @@ namespace detail {
     constexpr auto HyperlinkOps::get_key(Hyperlink const& hyperlink) -> di::String const& {
         return hyperlink.id;
     }
+
+    constexpr auto HyperlinkOps::hash(di::String const& key) -> u64 {
+        // FNV-1a over the code points of the id.
+        auto result = u64(0xCBF29CE484222325);
+        for (auto code_point : key) {
+            result = (result ^ u64(code_point)) * 0x100000001B3;
+        }
+        return result;
+    }
 }
 }
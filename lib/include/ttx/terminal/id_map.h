@@ -1,9 +1,12 @@
 #pragma once
 
 #include "di/assert/prelude.h"
-#include "di/bit/bitset/prelude.h"
-#include "di/container/tree/tree_map.h"
+#include "di/container/vector/vector.h"
+#include "di/math/numeric_limits.h"
 #include "di/types/prelude.h"
+#include "di/vocab/array/prelude.h"
+#include "di/vocab/optional/prelude.h"
+#include "di/vocab/pointer/box.h"
 
 namespace ttx::terminal {
 namespace detail {
@@ -13,6 +16,14 @@ namespace detail {
 
         // NOLINTNEXTLINE(bugprone-return-const-ref-from-parameter)
         constexpr static auto get_key(T const& t) -> T const& { return t; }
+
+        constexpr static auto hash(T const& t) -> u64 {
+            if constexpr (di::concepts::Integral<T>) {
+                return u64(t);
+            } else {
+                return t.hash();
+            }
+        }
     };
 
     template<typename T>
@@ -29,12 +40,17 @@ namespace detail {
 /// @brief A two-way map between a numberic id and a value.
 ///
 /// @tparam T The value type
-/// @tparam Ops An operation struct, which can be used to define a custom key.
+/// @tparam Ops An operation struct, which can be used to define a custom key and its hash.
 ///
 /// This class implements the two way mapping behavior which deduplicates
 /// graphics renditions and other cell specific state across cells. This implemenation
 /// uses manual reference counting, which is non-ideal for C++, but seems necessary
 /// for performance.
+///
+/// Values are stored in fixed size pages indexed by id, so references returned by
+/// lookup_id() remain valid until the id is dropped. Keys are found using an open
+/// addressing hash table of ids, and freed ids are kept on a free list, so both
+/// allocating and looking up an id take amortized constant time.
 template<typename T, typename Ops = detail::DefaultOps<T>>
 class IdMap {
 public:
@@ -46,96 +62,180 @@ public:
 private:
     struct RefCounted {
         template<typename... Args>
-        explicit RefCounted(Args&&... args) : value(di::forward<Args>(args)...) {}
+        explicit RefCounted(u64 hash, Args&&... args) : value(di::forward<Args>(args)...), hash(hash) {}
 
         T value {};
+        u64 hash { 0 };
         u32 ref_count { 1 };
     };
 
-public:
-    auto lookup_id(Id id) const -> T const& {
-        auto it = m_id_map.find(id);
-        ASSERT_NOT_EQ(it, m_id_map.end());
+    constexpr static auto page_size = 256zu;
 
-        return di::get<1>(*it).value;
-    }
+    using Page = di::Array<di::Optional<RefCounted>, page_size>;
+
+public:
+    auto lookup_id(Id id) const -> T const& { return entry(id).value; }
 
     auto lookup_key(Key const& key) const -> di::Optional<Id> {
-        auto it = m_id_lookup.find(key);
-        if (it == m_id_lookup.end()) {
+        auto slot = find_slot(key, hash_key(key));
+        if (!slot) {
             return {};
         }
-
-        return di::get<1>(*it);
+        return m_slots[*slot];
     }
 
     auto allocate(T const& value) -> di::Optional<Id>
     requires(di::concepts::CopyConstructible<T>)
     {
-        auto id = allocate_id();
-        if (!id) {
-            return {};
-        }
+        return do_allocate(value);
+    }
 
-        auto const& key = get_key(value);
-        ASSERT(!m_id_lookup.contains(key));
-        m_id_lookup[key] = *id;
-        m_id_map.insert_or_assign(*id, value);
+    auto allocate(T&& value) -> di::Optional<Id> { return do_allocate(di::move(value)); }
+
+    auto use_id(Id id) -> Id {
+        entry(id).ref_count++;
         return id;
     }
 
-    auto allocate(T&& value) -> di::Optional<Id> {
+    void drop_id(Id id) {
+        auto& rc = entry(id);
+        if (--rc.ref_count == 0) {
+            auto slot = find_slot(get_key(rc.value), rc.hash);
+            ASSERT(slot);
+            erase_slot(*slot);
+            slot_for(id) = di::nullopt;
+            m_free_ids.push_back(id);
+            m_size--;
+        }
+    }
+
+private:
+    constexpr static auto min_slot_count = 16zu;
+
+    static auto get_key(T const& value) -> Key const& { return Ops::get_key(value); }
+
+    // Finalize the caller's hash (which may just be the packed fields of the key) with the splitmix64 mixer, so
+    // that every bit of the key affects the slot index.
+    static auto hash_key(Key const& key) -> u64 {
+        auto z = u64(Ops::hash(key));
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+        return z ^ (z >> 31);
+    }
+
+    template<typename U>
+    auto do_allocate(U&& value) -> di::Optional<Id> {
+        auto const& key = get_key(value);
+        auto hash = hash_key(key);
+        ASSERT(!find_slot(key, hash));
+
         auto id = allocate_id();
         if (!id) {
             return {};
         }
 
-        auto const& key = get_key(value);
-        ASSERT(!m_id_lookup.contains(key));
-        m_id_lookup[key] = *id;
-        m_id_map.insert_or_assign(*id, di::move(value));
+        // Keep the load factor at or below 1/2, which keeps probe sequences short.
+        if ((m_size + 1) * 2 > m_slots.size()) {
+            rehash(m_slots.empty() ? min_slot_count : m_slots.size() * 2);
+        }
+
+        slot_for(*id).emplace(hash, di::forward<U>(value));
+        insert_slot(*id, hash);
+        m_size++;
         return id;
     }
 
-    auto use_id(Id id) -> Id {
-        auto it = m_id_map.find(id);
-        ASSERT_NOT_EQ(it, m_id_map.end());
+    auto allocate_id() -> di::Optional<Id> {
+        if (auto id = m_free_ids.pop_back()) {
+            return id;
+        }
 
-        di::get<1>(*it).ref_count++;
+        // Id 0 is never allocated, so ids are handed out starting from 1.
+        if (m_next_id > max_id) {
+            return {};
+        }
+        auto id = Id(m_next_id++);
+        if ((id - 1) / page_size == m_pages.size()) {
+            m_pages.push_back(di::make_box<Page>());
+        }
         return id;
     }
 
-    void drop_id(Id id) {
-        auto it = m_id_map.find(id);
-        ASSERT_NOT_EQ(it, m_id_map.end());
+    auto slot_for(Id id) const -> di::Optional<RefCounted> const& {
+        ASSERT_NOT_EQ(id, 0);
+        ASSERT_LT((id - 1) / page_size, m_pages.size());
+        return (*m_pages[(id - 1) / page_size])[(id - 1) % page_size];
+    }
+    auto slot_for(Id id) -> di::Optional<RefCounted>& {
+        ASSERT_NOT_EQ(id, 0);
+        ASSERT_LT((id - 1) / page_size, m_pages.size());
+        return (*m_pages[(id - 1) / page_size])[(id - 1) % page_size];
+    }
 
-        auto& rc = di::get<1>(*it);
-        if (--rc.ref_count == 0) {
-            m_id_lookup.erase(get_key(rc.value));
-            m_ids_used[id - 1] = false;
-            m_id_map.erase(id);
-        }
+    auto entry(Id id) const -> RefCounted const& {
+        auto const& result = slot_for(id);
+        ASSERT(result.has_value());
+        return *result;
+    }
+    auto entry(Id id) -> RefCounted& {
+        auto& result = slot_for(id);
+        ASSERT(result.has_value());
+        return *result;
     }
 
-private:
-    auto get_key(T const& value) -> Key const& { return Ops::get_key(value); }
+    auto find_slot(Key const& key, u64 hash) const -> di::Optional<usize> {
+        if (m_slots.empty()) {
+            return {};
+        }
 
-    auto allocate_id() -> di::Optional<Id> {
-        // TODO: use an optimized method from di.
-
-        // This for loop intentionally uses unsigned overflow, and starts from
-        // id 1 to pervent ever allocating id 0.
-        for (auto id = Id(1); id != 0; ++id) {
-            if (!m_ids_used[id - 1]) {
-                m_ids_used[id - 1] = true;
-                return id;
+        auto mask = m_slots.size() - 1;
+        for (auto index = hash & mask; m_slots[index] != 0; index = (index + 1) & mask) {
+            auto const& candidate = entry(m_slots[index]);
+            if (candidate.hash == hash && get_key(candidate.value) == key) {
+                return index;
             }
         }
         return {};
     }
 
-    di::TreeMap<Id, RefCounted> m_id_map;
-    di::TreeMap<Key, Id> m_id_lookup;
-    di::BitSet<max_id> m_ids_used;
+    void insert_slot(Id id, u64 hash) {
+        auto mask = m_slots.size() - 1;
+        auto index = hash & mask;
+        while (m_slots[index] != 0) {
+            index = (index + 1) & mask;
+        }
+        m_slots[index] = id;
+    }
+
+    // Remove a slot using backward shift deletion, which avoids tombstones. Each following entry in the probe
+    // sequence is moved into the hole unless the hole lies before its ideal slot.
+    void erase_slot(usize index) {
+        auto mask = m_slots.size() - 1;
+        for (auto next = (index + 1) & mask; m_slots[next] != 0; next = (next + 1) & mask) {
+            auto ideal = entry(m_slots[next]).hash & mask;
+            if (((next - ideal) & mask) >= ((next - index) & mask)) {
+                m_slots[index] = m_slots[next];
+                index = next;
+            }
+        }
+        m_slots[index] = 0;
+    }
+
+    void rehash(usize slot_count) {
+        auto old_slots = di::move(m_slots);
+        m_slots = {};
+        m_slots.resize(slot_count);
+        for (auto id : old_slots) {
+            if (id != 0) {
+                insert_slot(id, entry(id).hash);
+            }
+        }
+    }
+
+    di::Vector<di::Box<Page>> m_pages;
+    di::Vector<Id> m_slots;
+    di::Vector<Id> m_free_ids;
+    usize m_size { 0 };
+    u32 m_next_id { 1 };
 };
 }
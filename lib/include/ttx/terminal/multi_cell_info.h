@@ -15,6 +15,13 @@ struct MultiCellInfo {
 
     constexpr auto compute_width() const -> u8 { return scale * width; }
 
+    /// Hash used to deduplicate multi cell info in an IdMap.
+    constexpr auto hash() const -> u64 {
+        return u64(scale) | u64(width) << 8 | u64(fractional_scale_numerator) << 16 |
+               u64(fractional_scale_denominator) << 24 | u64(vertical_alignment) << 32 |
+               u64(horizontal_alignment) << 40;
+    }
+
     auto operator==(MultiCellInfo const&) const -> bool = default;
     auto operator<=>(MultiCellInfo const&) const = default;
 
@@ -6,10 +6,85 @@
 
 namespace ttx::terminal {
 /// @brief Represents a on-screen terminal row of cells
+///
+/// Each cell's text is accessed in constant time. Short text is stored inline in the cell, while longer text (like
+/// complex grapheme clusters) is stored in a per-row pool, which avoids rewriting the row when a cell changes.
+///
+/// Rows which were cleared as a whole are flagged as blank, so that clearing them again doesn't need to touch every
+/// cell.
+///
+/// For damage tracking, each row stores the range of columns which have changed since the row was last rendered.
 struct Row {
-    di::Vector<Cell> cells;       ///< Fixed size vector of terminal cells for this row.
-    di::String text;              ///< Text associated with the row.
-    bool overflow { false };      ///< Use for rewrapping on resize. Set if the cursor overflowed when at this row.
-    mutable bool stale { false }; ///< Dirty bit for damage tracking. 1 indicates the cell isn't dirty.
+    di::Vector<Cell> cells;                                ///< Fixed size vector of terminal cells for this row.
+    di::Vector<di::String> overflow_text;                  ///< Storage for cell text which doesn't fit inline.
+    di::Vector<u32> free_overflow_text;                    ///< Indices of unused entries in overflow_text.
+    bool overflow { false };                               ///< Set if the cursor overflowed at this row (for reflow).
+    bool blank { false };                                  ///< Set if every cell is known to be a cleared cell.
+    Color blank_background {};                             ///< Background color of the cleared cells (if blank).
+    mutable u32 dirty_start { 0 };                         ///< First column which needs to be rendered.
+    mutable u32 dirty_end { di::NumericLimits<u32>::max }; ///< End of the columns which need to be rendered.
+
+    /// @brief Check if every cell is a cleared cell with the specified background color
+    ///
+    /// This is a conservative hint: it is reset whenever a cell is written, and only set when a whole row is cleared
+    /// or created. It allows clearing an already blank row in constant time.
+    auto is_blank(Color background) const -> bool {
+        if (!blank) {
+            return false;
+        }
+        if (background.type == Color::Type::Default) {
+            return blank_background.type == Color::Type::Default;
+        }
+        return blank_background == background;
+    }
+
+    /// @brief Record that every cell is a cleared cell with the specified background color
+    void set_blank(Color background) {
+        blank = true;
+        blank_background = background;
+    }
+
+    /// @brief Check if any columns need to be rendered
+    auto dirty() const -> bool { return dirty_start < dirty_end; }
+
+    /// @brief Extend the range of columns which need to be rendered to include [start, end)
+    void mark_dirty(u32 start, u32 end) const {
+        if (start >= end) {
+            return;
+        }
+        if (!dirty()) {
+            dirty_start = start;
+            dirty_end = end;
+            return;
+        }
+        dirty_start = start < dirty_start ? start : dirty_start;
+        dirty_end = end > dirty_end ? end : dirty_end;
+    }
+    void mark_dirty(u32 col) const { mark_dirty(col, col + 1); }
+    void mark_all_dirty() const { mark_dirty(0, di::NumericLimits<u32>::max); }
+
+    /// @brief Mark the row as fully rendered
+    void clear_dirty() const {
+        dirty_start = 0;
+        dirty_end = 0;
+    }
+
+    /// @brief Get the text of a cell in this row
+    auto cell_text(Cell const& cell) const -> di::StringView;
+
+    /// @brief Replace the text of a cell in this row
+    void set_cell_text(Cell& cell, di::StringView text);
+
+    /// @brief Append a code point to the text of a cell in this row
+    void append_cell_text(Cell& cell, c32 code_point);
+
+    /// @brief Remove the text of a cell in this row
+    void clear_cell_text(Cell& cell);
+
+    /// @brief Remove the text of every cell in this row
+    void clear_text();
+
+    /// @brief Get the heap memory held by the row, including unused capacity
+    auto storage_bytes() const -> usize;
 };
 }
@@ -3,8 +3,8 @@
 #include "di/container/ring/prelude.h"
 #include "di/container/view/cache_last.h"
 #include "ttx/graphics_rendition.h"
+#include "ttx/terminal/attribute_table.h"
 #include "ttx/terminal/hyperlink.h"
-#include "ttx/terminal/id_map.h"
 #include "ttx/terminal/multi_cell_info.h"
 #include "ttx/terminal/reflow_result.h"
 #include "ttx/terminal/row.h"
@@ -14,20 +14,17 @@ namespace ttx::terminal {
 ///
 /// An invidual screen will have 1 active row group
 /// and potentially several additional row groups which
-/// store the scroll back history. Within a row group,
-/// attributes like the graphics rendition and hyperlink
-/// information are deduplicated using an IdMap.
+/// store the scroll back history. Attributes like the
+/// graphics rendition and hyperlink information are
+/// deduplicated using an AttributeTable, which is shared
+/// by every row group of the screen.
 ///
 /// Internally, rows are stored in a ring buffer to speed
 /// up certain operations during resizing (specifically
 /// inserting rows at the start of the group).
 class RowGroup {
 public:
-    explicit RowGroup() {
-        // Ensure that multi cell ID 1 is the standard wide cell. This allows for
-        // fast path optimizations.
-        ASSERT_EQ(1, m_multi_cell_info.allocate({ wide_multi_cell_info }));
-    }
+    explicit RowGroup(AttributeTable& attributes) : m_attributes(&attributes) {}
 
     auto rows() -> di::Ring<Row>& { return m_rows; }
     auto rows() const -> di::Ring<Row> const& { return m_rows; }
@@ -35,6 +32,9 @@ public:
     auto empty() const -> bool { return m_rows.empty(); }
     auto total_rows() const { return m_rows.size(); }
 
+    auto attributes() -> AttributeTable& { return *m_attributes; }
+    auto attributes() const -> AttributeTable const& { return *m_attributes; }
+
     /// @brief Adjust each row in the group according to the new target width
     ///
     /// This function is likely to change the number of rows in the group. The return
@@ -42,113 +42,87 @@ public:
     /// they are invalidated by this operation.
     auto reflow(u64 absolute_row_start, u32 target_width) -> ReflowResult;
 
-    void drop_graphics_id(u16& id);
-    void drop_hyperlink_id(u16& id);
-    void drop_multi_cell_id(u16& id);
+    void drop_graphics_id(u16& id) { m_attributes->drop_graphics_id(id); }
+    void drop_hyperlink_id(u16& id) { m_attributes->drop_hyperlink_id(id); }
+    void drop_multi_cell_id(u16& id) { m_attributes->drop_multi_cell_id(id); }
 
-    auto graphics_rendition(u16 id) const -> GraphicsRendition const&;
-    auto hyperlink(u16 id) const -> Hyperlink const&;
-    auto maybe_hyperlink(u16 id) const -> di::Optional<Hyperlink const&>;
-    auto multi_cell_info(u16 id) const -> MultiCellInfo const&;
+    auto graphics_rendition(u16 id) const -> GraphicsRendition const& { return m_attributes->graphics_rendition(id); }
+    auto hyperlink(u16 id) const -> Hyperlink const& { return m_attributes->hyperlink(id); }
+    auto maybe_hyperlink(u16 id) const -> di::Optional<Hyperlink const&> { return m_attributes->maybe_hyperlink(id); }
+    auto multi_cell_info(u16 id) const -> MultiCellInfo const& { return m_attributes->multi_cell_info(id); }
 
     auto graphics_id(GraphicsRendition const& rendition) -> di::Optional<u16> {
-        if (rendition == GraphicsRendition {}) {
-            return 0;
-        }
-        return m_graphics_renditions.lookup_key(rendition);
-    }
-    auto use_graphics_id(u16 id) -> u16 {
-        if (!id) {
-            return 0;
-        }
-        return m_graphics_renditions.use_id(id);
+        return m_attributes->graphics_id(rendition);
     }
+    auto use_graphics_id(u16 id) -> u16 { return m_attributes->use_graphics_id(id); }
     auto allocate_graphics_id(GraphicsRendition const& rendition) -> di::Optional<u16> {
-        return m_graphics_renditions.allocate(rendition);
+        return m_attributes->allocate_graphics_id(rendition);
+    }
+    auto maybe_allocate_graphics_id(GraphicsRendition const& rendition) -> di::Optional<u16> {
+        return m_attributes->maybe_allocate_graphics_id(rendition);
     }
-    auto maybe_allocate_graphics_id(GraphicsRendition const& rendition) -> di::Optional<u16>;
 
     auto hyperlink_id(di::String const& hyperlink_id) -> di::Optional<u16> {
-        return m_hyperlinks.lookup_key(hyperlink_id);
-    }
-    auto use_hyperlink_id(u16 id) -> u16 {
-        if (!id) {
-            return 0;
-        }
-        return m_hyperlinks.use_id(id);
+        return m_attributes->hyperlink_id(hyperlink_id);
     }
+    auto use_hyperlink_id(u16 id) -> u16 { return m_attributes->use_hyperlink_id(id); }
     auto allocate_hyperlink_id(Hyperlink&& hyperlink) -> di::Optional<u16> {
-        return m_hyperlinks.allocate(di::move(hyperlink));
+        return m_attributes->allocate_hyperlink_id(di::move(hyperlink));
+    }
+    auto maybe_allocate_hyperlink_id(Hyperlink const& hyperlink) -> di::Optional<u16> {
+        return m_attributes->maybe_allocate_hyperlink_id(hyperlink);
     }
-    auto maybe_allocate_hyperlink_id(Hyperlink const& hyperlink) -> di::Optional<u16>;
 
     auto multi_cell_id(MultiCellInfo const& multi_cell_info) -> di::Optional<u16> {
-        if (multi_cell_info == narrow_multi_cell_info) {
-            return 0;
-        }
-        if (multi_cell_info == wide_multi_cell_info) {
-            return 1;
-        }
-        return m_multi_cell_info.lookup_key(multi_cell_info);
-    }
-    auto use_multi_cell_id(u16 id) -> u16 {
-        if (id <= 1) {
-            return id;
-        }
-        return m_multi_cell_info.use_id(id);
+        return m_attributes->multi_cell_id(multi_cell_info);
     }
+    auto use_multi_cell_id(u16 id) -> u16 { return m_attributes->use_multi_cell_id(id); }
     auto allocate_multi_cell_id(MultiCellInfo const& multi_cell_info) -> di::Optional<u16> {
-        return m_multi_cell_info.allocate(multi_cell_info);
+        return m_attributes->allocate_multi_cell_id(multi_cell_info);
+    }
+    auto maybe_allocate_multi_cell_id(MultiCellInfo const& multi_cell_info) -> di::Optional<u16> {
+        return m_attributes->maybe_allocate_multi_cell_id(multi_cell_info);
     }
-    auto maybe_allocate_multi_cell_id(MultiCellInfo const& multi_cell_info) -> di::Optional<u16>;
 
+    /// @brief Move rows from another row group into this one
+    ///
+    /// Both groups must share the same attribute table, so cells are moved without
+    /// re-interning their attributes.
     auto transfer_from(RowGroup& from, usize from_index, usize to_index, usize row_count,
                        di::Optional<u32> desired_cols = {}) -> usize;
     auto strip_trailing_empty_cells(usize row_index) -> usize;
 
-    /// This function does not remove the text associated with the cell, as the caller typically has enough
-    /// context to do this more efficiently (because they are erasing multiple cells).
+    /// This function does not remove the text associated with the cell, as that is owned by the cell's row.
     void drop_cell(Cell& cell);
 
-    auto iterate_row(u32 row) const {
+    /// @brief Release the attributes of every cell in the group
+    ///
+    /// This must be called before discarding a group which still has rows, since the
+    /// attribute table outlives the group.
+    void drop_all_cells();
+
+    auto iterate_row(u32 row, u32 start_col = 0, u32 end_col = di::NumericLimits<u32>::max) const {
         ASSERT_LT(row, total_rows());
 
         auto const& row_object = rows()[row];
+        auto const cols = u32(row_object.cells.size());
+        end_col = end_col < cols ? end_col : cols;
+        start_col = start_col < end_col ? start_col : end_col;
 
         // Fetch the indirect data fields for every cell in the row (text, graphics, and hyperlink). This uses
-        // cache_last() so that the transform() can can maintain a mutable text offset counter safely, which
-        // ensures fetching the text associated with a cell is O(1). cache_last() also ensures we do the map lookups
-        // only once for each cell.
-        return row_object.cells |
-               di::transform([this, &row_object, text_offset = 0zu, col = 0u](Cell const& cell) mutable {
-                   auto text = [&] {
-                       if (cell.text_size == 0) {
-                           return di::StringView {};
-                       }
-
-                       auto text_start = row_object.text.iterator_at_offset(text_offset);
-                       text_offset += cell.text_size;
-                       auto text_end = row_object.text.iterator_at_offset(text_offset);
-                       ASSERT(text_start);
-                       ASSERT(text_end);
-                       return row_object.text.substr(text_start.value(), text_end.value());
-                   }();
-
-                   return di::make_tuple(
-                       col++, di::ref(cell), text, di::ref(graphics_rendition(cell.graphics_rendition_id())),
-                       maybe_hyperlink(cell.hyperlink_id()), di::ref(multi_cell_info(cell.multi_cell_id)));
+        // cache_last() to ensure we do the map lookups only once for each cell.
+        return *row_object.cells.subspan(start_col, end_col - start_col) |
+               di::transform([this, &row_object, col = start_col](Cell const& cell) mutable {
+                   return di::make_tuple(col++, di::ref(cell), row_object.cell_text(cell),
+                                         di::ref(graphics_rendition(cell.graphics_rendition_id())),
+                                         maybe_hyperlink(cell.hyperlink_id()),
+                                         di::ref(multi_cell_info(cell.multi_cell_id)));
                }) |
                di::cache_last;
     }
 
 private:
     di::Ring<Row> m_rows;
-    IdMap<GraphicsRendition> m_graphics_renditions;
-    IdMap<Hyperlink> m_hyperlinks;
-    IdMap<MultiCellInfo> m_multi_cell_info;
-
-    // This empty graphics rendition is used as an optimization so that we can
-    // return by reference in graphics_rendition() when the id == 0.
-    GraphicsRendition m_empty_graphics;
+    AttributeTable* m_attributes { nullptr };
 };
 }
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "di/container/vector/vector.h"
+#include "ttx/terminal/cell.h"
+#include "ttx/terminal/row.h"
+
+namespace ttx::terminal {
+/// @brief Recycles the storage of rows discarded from the scroll back
+///
+/// When the scroll back is full, every row scrolled off the screen causes an
+/// older row to eventually be discarded. Instead of freeing the discarded row's
+/// cells, they are kept here and reused for the next row inserted at the bottom
+/// of the screen, so that steady state scrolling doesn't allocate.
+class RowPool {
+public:
+    /// Maximum number of rows kept for reuse. Anything beyond this is freed.
+    constexpr static auto max_rows = 1024zu;
+
+    /// @brief Get a row containing cols copies of blank, reusing old storage when available.
+    auto acquire(u32 cols, Cell const& blank) -> Row;
+
+    /// @brief Make a row's storage available for reuse
+    ///
+    /// The row's cells must not reference any attributes, as they are not released.
+    void release(Row&& row);
+
+    auto size() const -> usize { return m_rows.size(); }
+
+private:
+    di::Vector<Row> m_rows;
+};
+}
@@ -2,10 +2,13 @@
 #include "di/bit/bitset/prelude.h"
 #include "di/container/string/string_view.h"
 #include "di/container/view/cache_last.h"
+#include "di/function/container/function_ref.h"
 #include "di/reflect/prelude.h"
+#include "di/vocab/pointer/box.h"
 #include "scroll_region.h"
 #include "ttx/graphics_rendition.h"
 #include "ttx/size.h"
+#include "ttx/terminal/attribute_table.h"
 #include "ttx/terminal/cell.h"
 #include "ttx/terminal/cursor.h"
 #include "ttx/terminal/escapes/osc_133.h"
@@ -16,6 +19,7 @@
 #include "ttx/terminal/row.h"
 #include "ttx/terminal/row_group.h"
 #include "ttx/terminal/scroll_back.h"
+#include "ttx/terminal/search.h"
 #include "ttx/terminal/selection.h"
 
 namespace ttx::terminal {
@@ -72,6 +76,11 @@ public:
 
     explicit Screen(Size const& size, ScrollBackEnabled scroll_back_enabled);
 
+    /// @brief Return the screen to its initial state, as if it was newly constructed with the specified size
+    ///
+    /// Unlike constructing a new screen, this reuses the existing rows and attribute storage.
+    void reset(Size const& size);
+
     auto resize(Size const& size) -> ReflowResult;
     void set_scroll_region(ScrollRegion const& region);
 
@@ -116,8 +125,23 @@ public:
     void clear_row_before_cursor();
     void erase_characters(u32 n);
 
-    void scroll_down();
+    /// @brief Scroll the scroll region down by count rows, as if by count line feeds at the bottom row
+    ///
+    /// The cursor must be on the last row of the scroll region, and stays there. Scrolling multiple rows at once
+    /// moves them into the scroll back with a single transfer.
+    void scroll_down(u32 count = 1);
     void put_code_point(c32 code_point, AutoWrapMode auto_wrap_mode);
+
+    /// @brief Put a run of printable text onto the screen
+    ///
+    /// This is equivalent to calling put_code_point() for each code point in the text, but
+    /// is significantly faster for ASCII text, which can be written to multiple cells at once.
+    void put_text_run(di::StringView text, AutoWrapMode auto_wrap_mode);
+
+    /// @brief Put a code point onto the screen count times
+    ///
+    /// This is equivalent to calling put_code_point() count times, but uses the bulk text run path for ASCII.
+    void put_repeated_code_point(c32 code_point, u32 count, AutoWrapMode auto_wrap_mode);
     void put_osc66(OSC66 const& sized_text, AutoWrapMode auto_wrap_mode);
 
     void put_semantic_prompt(OSC133&& osc133);
@@ -139,6 +163,20 @@ public:
 
     void clear_scroll_back();
 
+    /// @brief Limit the number of cells stored in the scroll back (see ScrollBack::set_max_cells())
+    void set_scroll_back_limit(usize max_cells);
+    auto scroll_back_limit() const -> usize { return m_scroll_back.max_cells(); }
+    auto scroll_back_cells() const -> usize { return m_scroll_back.total_cells(); }
+
+    /// @brief Write scroll back evicted from memory to disk instead of discarding it
+    void set_scroll_back_spill(di::Box<ScrollBackSpill> spill) { m_scroll_back.set_spill(di::move(spill)); }
+    auto scroll_back_spill_errors() const -> usize { return m_scroll_back.spill_errors(); }
+
+    /// @brief Discard the oldest group of rows in the scroll back
+    ///
+    /// @return The number of cells discarded (0 if the scroll back is empty)
+    auto discard_oldest_scroll_back() -> usize;
+
     auto visual_scroll_offset() const -> u64 {
         ASSERT_GT_EQ(m_visual_scroll_offset, absolute_row_start());
         ASSERT_LT_EQ(m_visual_scroll_offset, absolute_row_screen_start());
@@ -168,8 +206,34 @@ public:
     auto selected_text() const -> di::String;
     auto selected_text(Selection selection) const -> di::String;
 
+    /// @brief Start searching the screen and scroll back for pattern
+    ///
+    /// The search starts from the bottom of the visible rows and goes backward (towards older output). The view
+    /// is scrolled to show the match, if there is one.
+    ///
+    /// @return Whether a match was found
+    auto set_search(SearchPattern pattern) -> bool;
+    void clear_search();
+    auto search_active() const -> bool { return m_search_pattern.has_value(); }
+    auto search_match() const -> di::Optional<Selection> { return m_search_match; }
+
+    /// @brief Move to the previous (older) match of the current search
+    auto search_prev() -> bool;
+
+    /// @brief Move to the next (newer) match of the current search
+    auto search_next() -> bool;
+
+    /// @brief Get every match of the current search in a row
+    auto search_matches_in_row(u64 row) const -> di::Vector<Selection>;
+
+    auto in_search_match(AbsolutePosition const& point) const -> bool;
+
     auto text_in_last_command(bool include_command) const -> di::String;
 
+    /// @brief Find the row group containing an absolute row
+    ///
+    /// Rows in the scroll back may live in compressed groups, so the returned reference is only valid
+    /// until rows from other groups are accessed (see ScrollBack::find_row()).
     auto find_row(u64 row) const -> di::Tuple<u32, RowGroup const&>;
     auto iterate_row(u64 row) const {
         auto [r, group] = find_row(row);
@@ -194,6 +258,9 @@ private:
     void put_wide_cell(di::StringView text, MultiCellInfo const& multi_cell_info, AutoWrapMode auto_wrap_mode,
                        bool explicitly_sized, bool complex_grapheme_cluster);
 
+    // Put printable ASCII text, which is known to be a series of grapheme cluster boundaries, into consecutive cells.
+    void put_ascii_cells(di::StringView text, AutoWrapMode auto_wrap_mode);
+
     // Row/column helper functions for dealing with origin mode.
     auto translate_row(u32 row) const -> u32;
     auto translate_col(u32 col) const -> u32;
@@ -212,12 +279,40 @@ private:
     auto clamp_selection_point(AbsolutePosition const& point) const
         -> di::Tuple<AbsolutePosition, RowGroup const&, u32>;
 
+    // Find the closest search match which starts strictly before or after a position. Row groups in the scroll
+    // back are skipped when their search index shows they can't contain a match.
+    auto find_search_match_before(AbsolutePosition const& point) const -> di::Optional<Selection>;
+    auto find_search_match_after(AbsolutePosition const& point) const -> di::Optional<Selection>;
+
+    // Write scroll back groups which the search read from disk back out, so that searching doesn't keep the
+    // whole history in memory.
+    void release_searched_scroll_back();
+
+    // Scroll so that the current search match is visible, centering it if it's off screen.
+    void scroll_to_search_match();
+
+    // Drop the search match if it no longer refers to actual cells, after removing rows from scroll back.
+    void clamp_search_match();
+
     // Apply reflow result to all stored coordinates (does not affect the cursor).
     void apply_reflow_result(ReflowResult const& reflow_result);
 
     // Invalidate a region of rows and cells, as specified by the selection region.
     void invalidate_region(Selection const& region);
 
+    // Keep the visual scroll offset, selection, and semantic prompts in bounds after
+    // rows were discarded from the scroll back.
+    void clamp_to_scroll_back_start();
+
+    // Allocate an attribute id, evicting the oldest scroll back until the allocation succeeds. Since the
+    // attribute table is shared with the scroll back, its ids can otherwise run out when the history
+    // references many distinct attributes.
+    auto allocate_attribute_id(di::FunctionRef<di::Optional<u16>()> allocate) -> di::Optional<u16>;
+
+    // Clear the first count rows and move them to the bottom of the screen. This requires the
+    // scroll region to span the entire screen, and only advances the head of the row ring.
+    void recycle_rows_to_bottom(u32 count);
+
     auto begin_row_iterator() { return rows().begin() + m_scroll_region.start_row; }
     auto end_row_iterator() { return rows().begin() + m_scroll_region.end_row; }
 
@@ -228,11 +323,14 @@ private:
     // bce (background character erase) capability.
     auto blank_cell() -> Cell;
 
-    // Clear a cell respecting the correct background color. This is equivalent to
-    // dropping the cell followed by assigning the background color.
-    void clear_cell(Cell& cell);
+    // Clear the cells [start, end) of a row respecting the correct background color. This
+    // is equivalent to dropping each cell and its text followed by assigning the background
+    // color. The cells which actually change are marked dirty as a single span.
+    void clear_cells(Row& row, usize start, usize end);
 
-    // Screen state.
+    // Screen state. The attribute table is boxed so that the row groups' references to it remain valid
+    // when the screen is moved, and it is declared first so that it outlives them.
+    di::Box<AttributeTable> m_attributes;
     RowGroup m_active_rows;
     bool m_whole_screen_dirty { true };
 
@@ -245,6 +343,10 @@ private:
     // Visual selection
     di::Optional<Selection> m_selection;
 
+    // Search state
+    di::Optional<SearchPattern> m_search_pattern;
+    di::Optional<Selection> m_search_match;
+
     // Mutable state for writing cells.
     Cursor m_cursor;
     OriginMode m_origin_mode { OriginMode::Disabled };
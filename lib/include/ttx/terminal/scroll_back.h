@@ -1,8 +1,12 @@
 #pragma once
 
 #include "di/container/ring/prelude.h"
+#include "ttx/terminal/compressed_rows.h"
 #include "ttx/terminal/reflow_result.h"
 #include "ttx/terminal/row_group.h"
+#include "ttx/terminal/row_pool.h"
+#include "ttx/terminal/scroll_back_spill.h"
+#include "ttx/terminal/search.h"
 
 namespace ttx::terminal {
 /// @brief Represents the terminal scroll back
@@ -19,24 +23,89 @@ namespace ttx::terminal {
 /// target a particular number of cells, and represent a collection
 /// of visual terminal lines. The memory limit for the scroll back
 /// buffer is specified by the total number of cells allowed, which
-/// is used to determine the number of chunks.
+/// is used to determine the number of chunks. This limit is configurable
+/// per scroll back.
+///
+/// Every group shares the screen's attribute table, so rows are
+/// moved in and out of the scroll back without re-interning their
+/// attributes.
+///
+/// Groups other than the last one are stored compressed, except for
+/// recently accessed groups. Enough groups to display a whole screen
+/// are kept decompressed, so drawing doesn't repeatedly compress and
+/// decompress the same groups. Compressed groups are transparently
+/// decompressed when their rows are accessed. The memory limit applies
+/// to the compressed size, which allows keeping much more history.
+///
+/// When a spill is configured, groups evicted from memory are written
+/// to disk instead of being discarded, and read back when accessed.
+/// This makes the history effectively unbounded, while the memory
+/// limit still applies to the groups kept in memory. Spilled groups
+/// only keep their search index and bookkeeping, which still count
+/// towards the limit.
+///
+/// Each group indexes the text of its rows as they're added, so that
+/// searches can skip groups which can't contain a match without
+/// decompressing (or reading back) their rows. The index is shrunk
+/// to fit the group's text when the group is compressed.
 class ScrollBack {
     constexpr static auto target_cells_per_group = usize(di::NumericLimits<u16>::max / 2);
 
     constexpr static auto max_cells_per_group = usize(di::NumericLimits<u16>::max);
 
-    // TODO: make this configurable.
-    constexpr static auto max_cells = usize(target_cells_per_group * 100);
+    static_assert(TrigramFilter::max_bit_count >= 4 * target_cells_per_group,
+                  "The search index must have enough bits to stay selective for a full group");
 
-    constexpr static auto max_groups = di::divide_round_up(max_cells, target_cells_per_group);
+    /// Minimum number of groups (excluding the last one) kept decompressed after being accessed. More are kept
+    /// when a screenful of rows can span more groups than this (see set_visible_size()).
+    constexpr static auto min_decompressed_groups = 3_usize;
 
     struct Group {
         RowGroup group;
         usize cell_count { 0 };
+        usize row_bytes { 0 }; ///< Heap memory held by the decompressed rows (see Row::storage_bytes()).
+        u64 absolute_row_start { 0 }; ///< Absolute row of the group's first row, used to binary search for rows.
         di::Optional<u32> last_reflowed_to;
+        di::Optional<CompressedRows> compressed;            ///< Set while the group's rows are stored compressed.
+        di::Optional<ScrollBackSpill::Record> spill_record; ///< Copy of the rows on disk, unless they've changed.
+        usize spilled_rows { 0 };                           ///< Number of rows, while they're only stored on disk.
+        bool spilled { false };                             ///< Set while the group's rows are only stored on disk.
+        TrigramFilter filter;                               ///< Search index over the text of the group's rows.
+
+        auto decompressed() const -> bool { return !compressed && !spilled; }
+
+        auto total_rows() const -> usize {
+            if (spilled) {
+                return spilled_rows;
+            }
+            return compressed ? compressed.value().total_rows() : group.total_rows();
+        }
+
+        /// Number of cells whose memory is equivalent to what the group currently uses. This includes unused
+        /// capacity, since trailing blank cells are stripped from rows without freeing their storage, as well as
+        /// the group itself (and its search index), which stays in memory even when its rows are spilled.
+        auto footprint_cells() const -> usize {
+            auto bytes = sizeof(Group) + group.rows().capacity() * sizeof(Row) + row_bytes + filter.size_bytes();
+            if (compressed) {
+                bytes += compressed.value().capacity_bytes();
+            }
+            return di::divide_round_up(bytes, sizeof(Cell));
+        }
     };
 
 public:
+    /// Default limit on the number of cells stored in the scroll back.
+    constexpr static auto default_max_cells = usize(target_cells_per_group * 100);
+
+    /// @brief Convert a memory limit in MiB to the units of total_cells()
+    ///
+    /// Usage is measured from the memory each group actually holds (compressed data, row storage, overflow text,
+    /// search index and bookkeeping) in units of sizeof(Cell), so the converted limit bounds real memory rather
+    /// than the number of cells stored.
+    constexpr static auto cells_for_mib(usize mib) -> usize { return mib * 1024 * 1024 / sizeof(Cell); }
+
+    explicit ScrollBack(AttributeTable& attributes) : m_attributes(&attributes) {}
+
     auto absolute_row_start() const -> u64 { return m_absolute_row_start; }
     auto absolute_row_end() const -> u64 { return m_absolute_row_start + total_rows(); }
     auto total_rows() const -> usize { return m_total_rows; }
@@ -44,6 +113,47 @@ public:
     /// @brief Clear the scroll back history
     void clear();
 
+    /// @brief Get the approximate memory used by the scroll back, measured in cells
+    ///
+    /// Compressed row groups count as the number of cells which would fit in their storage. This is
+    /// kept up to date as groups change, so it's cheap enough to check after every write.
+    auto total_cells() const -> usize { return m_total_cells; }
+
+    auto max_cells() const -> usize { return m_max_cells; }
+
+    /// @brief Limit the number of cells stored in the scroll back
+    ///
+    /// The limit is enforced by discarding whole row groups, so it is approximate. At least
+    /// one row group is always kept. Lowering the limit immediately discards the oldest groups.
+    void set_max_cells(usize max_cells);
+
+    /// @brief Discard the oldest row group
+    ///
+    /// When spilling to disk, the oldest group still in memory is written to disk instead, and
+    /// nothing is discarded once every group but the last one has been spilled. If the group
+    /// can't be written, it is discarded along with every group before it.
+    ///
+    /// @return The number of cells released from memory
+    auto discard_oldest_group() -> usize;
+
+    /// @brief Write row groups evicted from memory to disk instead of discarding them
+    void set_spill(di::Box<ScrollBackSpill> spill) { m_spill = di::move(spill); }
+
+    /// @brief Write groups back to disk until the memory limit is met again
+    ///
+    /// Accessing spilled rows reads their groups back into memory, where they'd otherwise stay until
+    /// the next group is added. This should be called after accessing many rows at once, like when
+    /// searching. Groups which weren't modified since being read don't need to be rewritten.
+    ///
+    /// @return Whether any rows were discarded, which happens if a group can't be written
+    auto respill() -> bool;
+
+    /// @brief Get the number of times the spill failed to write or read a group
+    ///
+    /// Groups which can't be written are discarded, and groups which can't be read back are
+    /// replaced with blank rows.
+    auto spill_errors() const -> usize { return m_spill_errors; }
+
     /// @brief Add rows to the scroll back buffer
     ///
     /// @param from Row group to take from
@@ -97,8 +207,38 @@ public:
     /// case all reflow results are merged together.
     auto reflow_visual_rows(u64 absolute_row_start, usize row_count, u32 desired_cols) -> di::Optional<ReflowResult>;
 
+    /// @brief Keep enough groups decompressed to display a screen of the given size
+    void set_visible_size(u32 rows, u32 cols);
+
+    /// @brief Find the row group containing an absolute row
+    ///
+    /// @return The row's index within the group, and the group
+    ///
+    /// This decompresses (or reads back) the group if needed, which may compress the least recently
+    /// used group. So the returned reference is only valid until rows from other groups are accessed,
+    /// though accessing rows within a single screenful never invalidates it.
     auto find_row(u64 row) const -> di::Tuple<u32, RowGroup const&>;
 
+    /// @brief Drop the in memory copy of the group containing row, if it was read back from disk
+    ///
+    /// Reading every row (like when saving the screen's state) would otherwise keep the whole history
+    /// in memory. Only groups which are unmodified since being read are released, so nothing is written
+    /// and no rows are ever discarded. This invalidates references returned by find_row().
+    void release_loaded_group(u64 row) const;
+
+    /// @brief Consult the search index of the row group containing a row
+    ///
+    /// @param row The absolute row to look up
+    /// @param pattern The pattern being searched for
+    ///
+    /// @return The absolute row range [start, end) of the group, and whether any of its rows might match the pattern
+    ///
+    /// This doesn't access the group's rows, so it's cheap even if the group is compressed or spilled to disk.
+    auto search_hint(u64 row, SearchPattern const& pattern) const -> di::Tuple<u64, u64, bool>;
+
+    /// @brief Pool containing the storage of rows discarded from the scroll back
+    auto row_pool() -> RowPool& { return m_row_pool; }
+
 private:
     auto get_target_cells_per_group(bool last_row_overflow) const {
         // We use a larger threshold when the last row in the group has overflow set.
@@ -107,12 +247,36 @@ private:
         return last_row_overflow ? max_cells_per_group : target_cells_per_group;
     }
 
-    auto find_row_group(u64 row) -> di::Tuple<u32, u64, Group&>;
+    auto find_group_index(u64 row) const -> usize;
+    auto find_row_group(u64 row) -> di::Tuple<u32, usize, Group&>;
+    void update_group_starts(usize index);
+    void index_rows(Group& group, usize row_index);
+    void update_row_bytes(Group& group);
+    void release_spill_record(Group& group);
     auto is_last_group_full() const -> bool;
     auto add_group() -> Group&;
+    void recycle_rows(Group& group);
+    auto use_group(usize index) -> Group&;
+    void forget_hot_group(usize index);
+    void compress_group(Group& group);
+    void decompress_group(Group& group);
+    void compress_cold_groups();
+    auto spill_group(usize index) -> bool;
+    auto spill_oldest_group() -> usize;
+    auto discard_front_group() -> usize;
+    void load_spilled_group(Group& group);
 
     di::Ring<Group> m_groups;
+    AttributeTable* m_attributes { nullptr };
+    RowPool m_row_pool;
+    di::Box<ScrollBackSpill> m_spill;
+    usize m_spill_errors { 0 };
+    usize m_max_cells { default_max_cells };
+    usize m_max_decompressed_groups { min_decompressed_groups };
     usize m_total_rows { 0 };
+    usize m_total_cells { 0 }; ///< Sum of the footprint of every group, adjusted whenever a group changes.
     u64 m_absolute_row_start { 0 };
+    di::Ring<u64> m_hot_groups; ///< Decompressed groups other than the last one, least recently used first.
+    u64 m_first_group_id { 0 }; ///< Groups are numbered consecutively, so a group's index is its id minus this.
 };
 }
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "di/container/path/prelude.h"
+#include "di/container/vector/vector.h"
+#include "di/util/exchange.h"
+#include "di/vocab/error/result.h"
+#include "di/vocab/pointer/box.h"
+#include "di/vocab/span/prelude.h"
+
+namespace ttx::terminal {
+/// @brief Append-only disk storage for scroll back row groups evicted from memory
+///
+/// Row groups are appended to segment files in a directory (normally $XDG_STATE_HOME/ttx/scroll-back),
+/// and memory mapped back when they're accessed again. The segment files are unlinked as soon as they're
+/// created, so they never outlive the process. Records are released once their group is modified or
+/// discarded, and a segment's space is reclaimed as soon as none of its records are needed. Since the
+/// oldest groups are discarded first, segments are generally freed in the order they were written.
+class ScrollBackSpill {
+public:
+    /// Segments are limited to this size, so that no single file grows without bound.
+    constexpr static auto max_segment_size = usize(64) * 1024 * 1024;
+
+    /// @brief Location of data written to the spill
+    struct Record {
+        usize segment { 0 };
+        u64 offset { 0 };
+        usize size { 0 };
+    };
+
+    /// @brief Read only memory mapping of a record, which is unmapped when destroyed
+    class Mapping {
+    public:
+        explicit Mapping(void* base, usize length, usize offset, usize size)
+            : m_base(base), m_length(length), m_offset(offset), m_size(size) {}
+
+        Mapping(Mapping&& other)
+            : m_base(di::exchange(other.m_base, nullptr))
+            , m_length(di::exchange(other.m_length, 0))
+            , m_offset(other.m_offset)
+            , m_size(other.m_size) {}
+
+        ~Mapping();
+
+        auto span() const -> di::Span<byte const> { return { static_cast<byte const*>(m_base) + m_offset, m_size }; }
+
+    private:
+        void* m_base { nullptr };
+        usize m_length { 0 };
+        usize m_offset { 0 };
+        usize m_size { 0 };
+    };
+
+    /// @brief Create a spill which stores segment files in directory, creating the directory if needed
+    static auto create(di::Path directory) -> di::Result<di::Box<ScrollBackSpill>>;
+
+    explicit ScrollBackSpill(di::Path directory) : m_directory(di::move(directory)) {}
+    ~ScrollBackSpill();
+
+    /// @brief Append data to the current segment, starting a new segment if it's full
+    auto write(di::Span<byte const> data) -> di::Result<Record>;
+
+    /// @brief Map previously written data into memory
+    auto read(Record const& record) const -> di::Result<Mapping>;
+
+    /// @brief Mark a record as no longer needed, which invalidates it
+    ///
+    /// Once every record in a segment is released, older segments are closed (freeing their space) while
+    /// the current segment is truncated and reused.
+    void release(Record const& record);
+
+    /// @brief Close every segment, which invalidates all records
+    void clear();
+
+    /// @brief Get the number of bytes written to the segments which haven't been reclaimed
+    auto total_bytes() const -> u64;
+
+private:
+    struct Segment {
+        i32 fd { -1 }; ///< Closed (-1) once the segment has been reclaimed.
+        u64 size { 0 };
+        u64 live_bytes { 0 }; ///< Size of the records which haven't been released.
+    };
+
+    auto create_segment() -> di::Result<Segment>;
+
+    di::Path m_directory;
+    di::Vector<Segment> m_segments;
+};
+}
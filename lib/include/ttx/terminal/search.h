@@ -0,0 +1,124 @@
+#pragma once
+
+#include "di/container/string/string_view.h"
+#include "di/container/vector/vector.h"
+#include "di/vocab/array/prelude.h"
+#include "di/vocab/optional/prelude.h"
+#include "di/vocab/span/prelude.h"
+#include "di/vocab/tuple/prelude.h"
+#include "ttx/terminal/row.h"
+
+namespace ttx::terminal {
+/// @brief The searchable text of a row
+///
+/// Each cell contributes its code points (or a space if it's empty), and multi cells only contribute text once.
+/// The column of every code point is recorded, so that matches can be mapped back to the row's cells.
+struct SearchText {
+    di::Vector<c32> code_points;
+    di::Vector<u32> cols; ///< Column of each code point.
+
+    static auto from_row(Row const& row) -> SearchText;
+};
+
+/// @brief A compiled search query, which is either literal text or a regular expression
+///
+/// The regular expression syntax is a small subset of POSIX extended regular expressions: literals, `.`, bracket
+/// expressions (with ranges and negation), the `\d`, `\w`, and `\s` classes (and their negations), the `*`, `+`, and
+/// `?` quantifiers, `^` and `$` anchors, and top-level alternation with `|`. Groups are not supported.
+///
+/// Like POSIX, the leftmost match is found, preferring the longest one. Matches never span multiple rows, and empty
+/// matches are ignored.
+class SearchPattern {
+public:
+    /// @brief Create a pattern which matches text exactly (fails if text is empty)
+    static auto literal(di::StringView text) -> di::Optional<SearchPattern>;
+
+    /// @brief Compile a regular expression (fails if the expression is invalid or empty)
+    static auto regex(di::StringView text) -> di::Optional<SearchPattern>;
+
+    /// @brief Find the first match in text which starts at or after start
+    ///
+    /// @return The range of code points [start, end) of the match
+    auto find(di::Span<c32 const> text, usize start = 0) const -> di::Optional<di::Tuple<usize, usize>>;
+
+    /// @brief Runs of code points which matches must contain (used to consult the search index)
+    ///
+    /// There is a list of runs for each alternative, and a match of an alternative contains all of its runs. For
+    /// literal patterns, the only run is the literal text. For regular expressions, the runs are the sequences of
+    /// nodes which match a single code point exactly once.
+    auto required_text() const -> di::Span<di::Vector<di::Vector<c32>> const> { return m_required_text.span(); }
+
+    auto is_regex() const -> bool { return !m_alternatives.empty(); }
+
+private:
+    struct Range {
+        c32 first { 0 };
+        c32 last { 0 };
+    };
+
+    struct Node {
+        di::Vector<Range> ranges;
+        bool negated { false };
+        u32 min { 1 };
+        u32 max { 1 };
+
+        auto matches(c32 code_point) const -> bool;
+    };
+
+    struct Alternative {
+        di::Vector<Node> nodes;
+        usize first_state { 0 }; ///< Index of the alternative's first state in the matching automaton.
+        bool anchored_start { false };
+        bool anchored_end { false };
+    };
+
+    auto find_regex(di::Span<c32 const> text, usize start) const -> di::Optional<di::Tuple<usize, usize>>;
+
+    di::Vector<c32> m_literal;
+    di::Vector<Alternative> m_alternatives;
+    di::Vector<di::Vector<di::Vector<c32>>> m_required_text;
+    usize m_state_count { 0 };
+};
+
+/// @brief Index over the text of a group of rows, used to skip rows which can't contain a match
+///
+/// Every sequence of 3 code points (trigram) in the rows is recorded in a bloom filter, which sets 2 bits per
+/// trigram. While rows are added, the filter has about 4 bits for each cell of a full scroll back group, so it stays
+/// selective even when every trigram in the group is distinct. Once the rows are complete, shrink_to_fit() folds the
+/// filter down to a size proportional to the text actually recorded, which is usually much smaller.
+/// A pattern can only match if all of the trigrams of its required text are present, so the filter gives a
+/// conservative answer without looking at the rows. This lets a search skip compressed (or spilled) row groups without
+/// decompressing them. The filter must be rebuilt when rows are modified, but removing rows is fine as the answer
+/// stays conservative.
+class TrigramFilter {
+public:
+    constexpr static auto max_bit_count = usize(131072);
+    constexpr static auto min_bit_count = usize(512);
+
+    /// @brief Record the trigrams of a row
+    void add(Row const& row);
+
+    void clear();
+
+    /// @brief Fold the filter to the smallest size which keeps it selective
+    ///
+    /// This should be called once no more rows will be added. Adding rows afterwards is still correct, but
+    /// the filter fills up faster and so gives more false positives.
+    void shrink_to_fit();
+
+    /// @brief Check if the rows might contain a match for pattern
+    auto might_contain(SearchPattern const& pattern) const -> bool;
+
+    /// @brief Number of bits in the filter, which is 0 until a trigram is recorded
+    auto bit_count() const -> usize { return m_bits.size() * 64; }
+
+    /// @brief Heap memory used by the filter
+    auto size_bytes() const -> usize { return m_bits.capacity() * sizeof(u64); }
+
+private:
+    auto bits(c32 a, c32 b, c32 c) const -> di::Array<usize, 2>;
+    auto contains_trigrams(di::Span<c32 const> text) const -> bool;
+
+    di::Vector<u64> m_bits; ///< Always a power of 2 words, so bits are selected by masking the hash.
+};
+}
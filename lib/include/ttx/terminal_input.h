@@ -27,6 +27,7 @@ public:
 
 private:
     void handle(PrintableCharacter const& printable_character);
+    void handle(PrintableRun const& printable_run);
     void handle(DCS const& dcs);
     void handle(OSC const& osc);
     void handle(APC const& apc);
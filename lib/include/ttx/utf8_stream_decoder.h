@@ -1,6 +1,7 @@
 #pragma once
 
 #include "di/container/string/string.h"
+#include "di/function/container/function_ref.h"
 #include "di/types/prelude.h"
 #include "di/vocab/span/prelude.h"
 
@@ -15,6 +16,17 @@ public:
     // Invalid UTF-8 sequences are replaced with replacement characters.
     auto decode(di::Span<byte const> input) -> di::String;
 
+    // Decode the incoming byte stream as UTF-8, without copying when possible.
+    //
+    // The decoded text is passed to output in order, in one or two pieces.
+    // When the input is valid UTF-8 (ignoring an incomplete sequence at the
+    // end, which is buffered), it is passed directly. A sequence started by
+    // the previous call is completed first by copying only its remaining
+    // bytes, and the rest of the input is still passed directly. Input with
+    // invalid bytes is decoded into an internal side buffer which is reused
+    // between calls. The pieces are only valid during the callback.
+    void decode_view(di::Span<byte const> input, di::FunctionRef<void(di::StringView)> output);
+
     // Flush any pending data. If there is any pending data, a single
     // replacement character will be output.
     auto flush() -> di::String;
@@ -23,13 +35,16 @@ private:
     constexpr static auto default_lower_bound = u8(0x80);
     constexpr static auto default_upper_bound = u8(0xBF);
 
+    void decode_into(di::String& output, byte const* data, usize size);
     void decode_byte(di::String& output, byte input);
     void decode_first_byte(di::String& output, byte input);
     void output_code_point(di::String& output, c32 code_point);
+    void reset_state();
 
     u8 m_pending_code_units { 0 };
     u32 m_pending_code_point { 0 };
     u8 m_lower_bound { default_lower_bound };
     u8 m_upper_bound { default_upper_bound };
+    di::String m_side_buffer;
 };
 }
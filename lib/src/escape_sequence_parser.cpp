@@ -1,498 +1,232 @@
 #include "ttx/escape_sequence_parser.h"
 
+#include "di/container/view/range.h"
 #include "di/parser/prelude.h"
+#include "di/util/exchange.h"
 #include "di/util/scope_exit.h"
+#include "di/vocab/array/prelude.h"
 #include "ttx/features.h"
 
-#define STATE(state) void EscapeSequenceParser::state##_state([[maybe_unused]] c32 code_point)
-
-#define ON_ENTRY_NOOP(state)         \
-    do {                             \
-        m_last_state = State::state; \
-    } while (0)
-
-#define ON_ENTRY(state)                                   \
-    auto __did_transition = State::state != m_last_state; \
-    m_last_state = State::state;                          \
-    if (__did_transition)
-
 namespace ttx {
 static inline auto is_printable(c32 code_point) -> bool {
     return (code_point >= 0x20 && code_point <= 0x7F) || (code_point >= 0xA0);
 }
 
-static inline auto is_executable(c32 code_point) -> bool {
-    return code_point <= 0x17 || code_point == 0x19 || (code_point >= 0x1C && code_point <= 0x1F);
-}
-
-static inline auto is_csi_terminator(c32 code_point) -> bool {
-    return code_point >= 0x40 && code_point <= 0x7E;
-}
-
-static inline auto is_param(c32 code_point) -> bool {
-    // NOTE: this is modified from the reference to include ':' in addition to ';'.
-    return (code_point >= 0x30 && code_point <= 0x39) || (code_point == 0x3B) || (code_point == 0x3A);
-}
-
-static inline auto is_intermediate(c32 code_point) -> bool {
-    return code_point >= 0x20 && code_point <= 0x2F;
-}
-
-static inline auto is_string_terminator(c32 code_point, c32 prev) -> bool {
-    // NOTE: this is xterm specific.
-    return code_point == '\a' || (prev == '\x1b' && code_point == '\\');
-}
-
-static inline auto is_dcs_terminator(c32 code_point) -> bool {
-    return code_point >= 0x40 && code_point <= 0x7E;
-}
-
-static inline auto is_escape_terminator(c32 code_point) -> bool {
-    return (code_point >= 0x30 && code_point <= 0x4F) || (code_point >= 0x51 && code_point <= 0x57) ||
-           (code_point == 0x59) || (code_point == 0x5A) || (code_point == 0x5C) ||
-           (code_point >= 0x60 && code_point <= 0x7E);
-}
-
-STATE(ground) {
-    ON_ENTRY_NOOP(Ground);
-
-    if (is_executable(code_point)) {
-        execute(code_point);
-        return;
-    }
-
-    if (is_printable(code_point)) {
-        print(code_point);
-        return;
-    }
-}
-
-STATE(escape) {
-    ON_ENTRY(Escape) {
-        clear();
-    }
-
-    if (is_executable(code_point)) {
-        execute(code_point);
-        return;
-    }
-
-    if (code_point == 0x5B) {
-        transition(State::CsiEntry);
-        return;
-    }
-
-    if (m_mode == Mode::Input && code_point == 0x4F) {
-        transition(State::Ss3);
-        return;
-    }
-
-    if (code_point == 0x50) {
-        transition(State::DcsEntry);
-        return;
-    }
-
-    if (code_point == 0x5D) {
-        transition(State::OscString);
-        return;
-    }
-
-    // For the purposes of parsing input, any other code point should be treated
-    // as if we were in the ground state. This allows us to recognize alt+key when
-    // using the legacy mode.
-    if (m_mode == Mode::Input) {
-        execute(code_point);
-        return;
-    }
-
-    if (is_escape_terminator(code_point)) {
-        esc_dispatch(code_point);
-        transition(State::Ground);
-        return;
-    }
-
-    if (is_intermediate(code_point)) {
-        collect(code_point);
-        transition(State::EscapeIntermediate);
-        return;
-    }
-
-    if (code_point == 0x5F) {
-        transition(State::ApcString);
-        return;
-    }
-
-    if (code_point == 0x58 || code_point == 0x5E) {
-        transition(State::SosPmString);
-        return;
-    }
-
-    if (code_point == 0x7F) {
-        ignore(code_point);
-        return;
-    }
-}
-
-STATE(escape_intermediate) {
-    ON_ENTRY_NOOP(EscapeIntermediate);
-
-    if (is_executable(code_point)) {
-        execute(code_point);
-        return;
-    }
-
-    if (is_intermediate(code_point)) {
-        collect(code_point);
-        return;
-    }
-
-    if (code_point >= 0x30 && code_point <= 0x7E) {
-        esc_dispatch(code_point);
-        transition(State::Ground);
-        return;
-    }
-
-    if (code_point == 0x7F) {
-        ignore(code_point);
-        return;
-    }
-}
-
-STATE(csi_entry) {
-    ON_ENTRY(CsiEntry) {
-        clear();
-    }
-
-    if (is_executable(code_point)) {
-        execute(code_point);
-        return;
-    }
-
-    if (is_csi_terminator(code_point)) {
-        csi_dispatch(code_point);
-        transition(State::Ground);
-        return;
-    }
-
-    if (is_intermediate(code_point)) {
-        collect(code_point);
-        transition(State::CsiIntermediate);
-        return;
-    }
-
-    if (is_param(code_point)) {
-        param(code_point);
-        transition(State::CsiParam);
-        return;
-    }
-
-    if (code_point >= 0x3C && code_point <= 0x3F) {
-        collect(code_point);
-        transition(State::CsiParam);
-        return;
-    }
-
-    if (code_point == 0x7F) {
-        ignore(code_point);
-        return;
-    }
-}
-
-STATE(csi_intermediate) {
-    ON_ENTRY_NOOP(CsiIntermediate);
-
-    if (is_executable(code_point)) {
-        execute(code_point);
-        return;
-    }
-
-    if (is_intermediate(code_point)) {
-        collect(code_point);
-        return;
-    }
-
-    if (is_csi_terminator(code_point)) {
-        csi_dispatch(code_point);
-        transition(State::Ground);
-        return;
-    }
-
-    if (code_point >= 0x30 && code_point <= 0x3F) {
-        transition(State::CsiIgnore);
-        return;
-    }
-
-    if (code_point == 0x7F) {
-        ignore(code_point);
-        return;
-    }
-}
-
-STATE(csi_param) {
-    ON_ENTRY(CsiParam) {
-        m_on_state_exit = [this] {
-            if (!m_current_param.empty()) {
-                add_param(di::parse<u32>(m_current_param).optional_value());
-            }
-        };
-    }
-
-    if (is_executable(code_point)) {
-        execute(code_point);
-        return;
-    }
-
-    if (is_intermediate(code_point)) {
-        collect(code_point);
-        transition(State::CsiIntermediate);
-        return;
-    }
-
-    if (is_csi_terminator(code_point)) {
-        transition(State::Ground);
-        csi_dispatch(code_point);
-        return;
-    }
-
-    if (is_param(code_point)) {
-        param(code_point);
-        return;
-    }
-
-    if (code_point >= 0x3C && code_point <= 0x3F) {
-        transition(State::CsiIgnore);
-        return;
-    }
-
-    if (code_point == 0x7F) {
-        ignore(code_point);
-        return;
-    }
-}
-
-STATE(csi_ignore) {
-    ON_ENTRY_NOOP(CsiIgnore);
-
-    if (is_executable(code_point)) {
-        execute(code_point);
-        return;
-    }
-
-    if (is_csi_terminator(code_point)) {
-        transition(State::Ground);
-        return;
-    }
-
-    if ((code_point >= 0x20 && code_point <= 0x3F) || (code_point == 0x7F)) {
-        ignore(code_point);
-        return;
-    }
-}
-
-STATE(dcs_entry) {
-    ON_ENTRY(DcsEntry) {
-        clear();
-    }
-
-    if (is_executable(code_point)) {
-        ignore(code_point);
-        return;
-    }
-
-    if (is_intermediate(code_point)) {
-        collect(code_point);
-        transition(State::DcsIntermediate);
-        return;
-    }
-
-    if (is_param(code_point)) {
-        param(code_point);
-        transition(State::DcsParam);
-        return;
-    }
-
-    if (code_point >= 0x3C && code_point <= 0x3F) {
-        collect(code_point);
-        transition(State::DcsParam);
-        return;
-    }
-
-    if (is_dcs_terminator(code_point)) {
-        transition(State::DcsPassthrough);
-        return;
-    }
-
-    if (code_point == 0x7F) {
-        ignore(code_point);
-        return;
-    }
-}
-
-STATE(dcs_param) {
-    ON_ENTRY(DcsParam) {
-        m_on_state_exit = [this] {
-            if (!m_current_param.empty()) {
-                add_param(di::parse<u32>(m_current_param).optional_value());
-            }
-        };
-    }
-
-    if (is_executable(code_point)) {
-        ignore(code_point);
-        return;
-    }
-
-    if (is_param(code_point)) {
-        param(code_point);
-        return;
-    }
-
-    if ((code_point >= 0x3C && code_point <= 0x3F)) {
-        transition(State::DcsIgnore);
-        return;
-    }
-
-    if (is_intermediate(code_point)) {
-        collect(code_point);
-        transition(State::DcsIntermediate);
-        return;
-    }
-
-    if (is_dcs_terminator(code_point)) {
-        transition(State::DcsPassthrough);
-        return;
-    }
-
-    if (code_point == 0x7F) {
-        ignore(code_point);
-        return;
-    }
-}
-
-STATE(dcs_intermediate) {
-    ON_ENTRY_NOOP(DcsIntermediate);
-
-    if (is_executable(code_point)) {
-        ignore(code_point);
-        return;
-    }
-
-    if (code_point >= 0x30 && code_point <= 0x3F) {
-        transition(State::DcsIgnore);
-        return;
-    }
-
-    if (is_intermediate(code_point)) {
-        collect(code_point);
-        return;
-    }
-
-    if (is_dcs_terminator(code_point)) {
-        m_intermediate.push_back(code_point);
-        transition(State::DcsPassthrough);
-        return;
-    }
-
-    if (code_point == 0x7F) {
-        ignore(code_point);
-        return;
-    }
-}
-
-STATE(dcs_passthrough) {
-    ON_ENTRY(DcsPassthrough) {
-        hook();
-    }
+// Character classes used to index the transition tables. Characters which are
+// treated identically by every state share a class, so the tables stay small.
+enum class EscapeSequenceParser::CharClass : u8 {
+    Execute,       // C0 controls, excluding the ones below
+    Bel,           // BEL, which also terminates strings
+    Esc,           // ESC
+    Intermediate,  // 0x20-0x2F
+    Param,         // 0-9, : and ;
+    PrivateMarker, // < = > ?
+    Final,         // 0x40-0x7E, excluding the ones below
+    CsiStart,      // [
+    Ss3Start,      // O
+    DcsStart,      // P
+    OscStart,      // ]
+    SosPmStart,    // X and ^
+    ApcStart,      // _
+    Backslash,     // \ (terminates strings after ESC)
+    Del,           // DEL
+    C1,            // 0x80-0x9F
+    High,          // 0xA0 and above
+};
+
+enum class EscapeSequenceParser::Action : u8 {
+    None,
+    Print,
+    Execute,
+    Collect,
+    Param,
+    EscDispatch,
+    CsiDispatch,
+    Put,
+    OutputSs3,
+    StringTerminator,
+    StringTerminatorOrPut,
+    StringTerminatorOrIgnore,
+};
+
+struct EscapeSequenceParser::Transition {
+    Action action { Action::None };
+    State next_state { State::Ground };
+    bool has_transition { false };
+};
+
+constexpr auto EscapeSequenceParser::classify(c32 code_point) -> CharClass {
+    switch (code_point) {
+        case 0x07:
+            return CharClass::Bel;
+        case 0x1B:
+            return CharClass::Esc;
+        case '[':
+            return CharClass::CsiStart;
+        case 'O':
+            return CharClass::Ss3Start;
+        case 'P':
+            return CharClass::DcsStart;
+        case ']':
+            return CharClass::OscStart;
+        case 'X':
+        case '^':
+            return CharClass::SosPmStart;
+        case '_':
+            return CharClass::ApcStart;
+        case '\\':
+            return CharClass::Backslash;
+        case 0x7F:
+            return CharClass::Del;
+        default:
+            break;
+    }
+
+    // NOTE: CAN (0x18) and SUB (0x1A) are classified as Execute, but are
+    // handled before consulting the transition table.
+    if (code_point < 0x20) {
+        return CharClass::Execute;
+    }
+    if (code_point < 0x30) {
+        return CharClass::Intermediate;
+    }
+    if (code_point < 0x3C) {
+        return CharClass::Param;
+    }
+    if (code_point < 0x40) {
+        return CharClass::PrivateMarker;
+    }
+    if (code_point < 0x80) {
+        return CharClass::Final;
+    }
+    if (code_point < 0xA0) {
+        return CharClass::C1;
+    }
+    return CharClass::High;
+}
+
+// Generate the transition table for the VT500-Series parser described at
+// https://vt100.net/emu/dec_ansi_parser. Each entry is the action to perform
+// for a character class in a given state, along with the state to transition
+// to, if any. Entry actions are handled separately by enter().
+constexpr auto EscapeSequenceParser::make_transition_table(Mode mode) {
+    using enum CharClass;
+
+    constexpr auto state_count = usize(State::SosPmString) + 1;
+    constexpr auto char_class_count = usize(High) + 1;
+
+    auto table = di::Array<di::Array<Transition, char_class_count>, state_count> {};
+    auto on = [&](State state, std::initializer_list<CharClass> char_classes, Action action, State next_state) {
+        for (auto char_class : char_classes) {
+            table[usize(state)][usize(char_class)] = Transition { action, next_state, next_state != state };
+        }
+    };
+    auto on_all = [&](State state, Action action, State next_state) {
+        for (auto char_class : di::range(char_class_count)) {
+            table[usize(state)][char_class] = Transition { action, next_state, next_state != state };
+        }
+    };
 
-    if (is_string_terminator(code_point, m_prev)) {
-        m_saw_legacy_string_terminator = code_point == '\a';
-        transition(State::Ground);
-        return;
+    auto const executable = { Execute, Bel };
+    auto const finals = { Final, CsiStart, Ss3Start, DcsStart, OscStart, SosPmStart, ApcStart, Backslash };
+
+    on(State::Ground, executable, Action::Execute, State::Ground);
+    on(State::Ground, { Intermediate, Param, PrivateMarker, Del, High }, Action::Print, State::Ground);
+    on(State::Ground, finals, Action::Print, State::Ground);
+
+    on(State::Escape, executable, Action::Execute, State::Escape);
+    on(State::Escape, { CsiStart }, Action::None, State::CsiEntry);
+    on(State::Escape, { DcsStart }, Action::None, State::DcsEntry);
+    on(State::Escape, { OscStart }, Action::None, State::OscString);
+    if (mode == Mode::Input) {
+        // For the purposes of parsing input, any other code point should be treated
+        // as if we were in the ground state. This allows us to recognize alt+key when
+        // using the legacy mode.
+        on(State::Escape, { Ss3Start }, Action::None, State::Ss3);
+        on(State::Escape,
+           { Intermediate, Param, PrivateMarker, Final, SosPmStart, ApcStart, Backslash, Del, C1, High },
+           Action::Execute, State::Escape);
+    } else {
+        on(State::Escape, { Param, PrivateMarker, Final, Ss3Start, Backslash }, Action::EscDispatch, State::Ground);
+        on(State::Escape, { Intermediate }, Action::Collect, State::EscapeIntermediate);
+        on(State::Escape, { ApcStart }, Action::None, State::ApcString);
+        on(State::Escape, { SosPmStart }, Action::None, State::SosPmString);
     }
 
-    if (code_point == 0x7F) {
-        ignore(code_point);
-        return;
-    }
+    on(State::EscapeIntermediate, executable, Action::Execute, State::EscapeIntermediate);
+    on(State::EscapeIntermediate, { Intermediate }, Action::Collect, State::EscapeIntermediate);
+    on(State::EscapeIntermediate, { Param, PrivateMarker }, Action::EscDispatch, State::Ground);
+    on(State::EscapeIntermediate, finals, Action::EscDispatch, State::Ground);
 
-    put(code_point);
-}
+    on(State::CsiEntry, executable, Action::Execute, State::CsiEntry);
+    on(State::CsiEntry, finals, Action::CsiDispatch, State::Ground);
+    on(State::CsiEntry, { Intermediate }, Action::Collect, State::CsiIntermediate);
+    on(State::CsiEntry, { Param }, Action::Param, State::CsiParam);
+    on(State::CsiEntry, { PrivateMarker }, Action::Collect, State::CsiParam);
 
-STATE(dcs_ignore) {
-    ON_ENTRY_NOOP(DcsIgnore);
+    on(State::CsiParam, executable, Action::Execute, State::CsiParam);
+    on(State::CsiParam, { Intermediate }, Action::Collect, State::CsiIntermediate);
+    on(State::CsiParam, finals, Action::CsiDispatch, State::Ground);
+    on(State::CsiParam, { Param }, Action::Param, State::CsiParam);
+    on(State::CsiParam, { PrivateMarker }, Action::None, State::CsiIgnore);
 
-    if (is_string_terminator(code_point, m_prev)) {
-        m_saw_legacy_string_terminator = code_point == '\a';
-        transition(State::Ground);
-        return;
-    }
+    on(State::CsiIntermediate, executable, Action::Execute, State::CsiIntermediate);
+    on(State::CsiIntermediate, { Intermediate }, Action::Collect, State::CsiIntermediate);
+    on(State::CsiIntermediate, finals, Action::CsiDispatch, State::Ground);
+    on(State::CsiIntermediate, { Param, PrivateMarker }, Action::None, State::CsiIgnore);
 
-    ignore(code_point);
-}
+    on(State::CsiIgnore, executable, Action::Execute, State::CsiIgnore);
+    on(State::CsiIgnore, finals, Action::None, State::Ground);
 
-STATE(osc_string) {
-    ON_ENTRY(OscString) {
-        osc_start();
-    }
+    on_all(State::Ss3, Action::OutputSs3, State::Ground);
 
-    if (is_string_terminator(code_point, m_prev)) {
-        m_saw_legacy_string_terminator = code_point == '\a';
-        transition(State::Ground);
-        return;
-    }
+    on(State::DcsEntry, { Intermediate }, Action::Collect, State::DcsIntermediate);
+    on(State::DcsEntry, { Param }, Action::Param, State::DcsParam);
+    on(State::DcsEntry, { PrivateMarker }, Action::Collect, State::DcsParam);
+    on(State::DcsEntry, finals, Action::None, State::DcsPassthrough);
 
-    if (is_executable(code_point)) {
-        ignore(code_point);
-        return;
-    }
+    on(State::DcsParam, { Param }, Action::Param, State::DcsParam);
+    on(State::DcsParam, { PrivateMarker }, Action::None, State::DcsIgnore);
+    on(State::DcsParam, { Intermediate }, Action::Collect, State::DcsIntermediate);
+    on(State::DcsParam, finals, Action::None, State::DcsPassthrough);
 
-    if (is_printable(code_point)) {
-        osc_put(code_point);
-        return;
-    }
-}
+    on(State::DcsIntermediate, { Param, PrivateMarker }, Action::None, State::DcsIgnore);
+    on(State::DcsIntermediate, { Intermediate }, Action::Collect, State::DcsIntermediate);
+    on(State::DcsIntermediate, finals, Action::Collect, State::DcsPassthrough);
 
-STATE(apc_string) {
-    ON_ENTRY(ApcString) {
-        apc_start();
-    }
+    on_all(State::DcsPassthrough, Action::Put, State::DcsPassthrough);
+    on(State::DcsPassthrough, { Del }, Action::None, State::DcsPassthrough);
+    on(State::DcsPassthrough, { Bel }, Action::StringTerminator, State::Ground);
+    on(State::DcsPassthrough, { Backslash }, Action::StringTerminatorOrPut, State::DcsPassthrough);
 
-    if (is_string_terminator(code_point, m_prev)) {
-        m_saw_legacy_string_terminator = code_point == '\a';
-        transition(State::Ground);
-        return;
-    }
+    on(State::DcsIgnore, { Bel }, Action::StringTerminator, State::Ground);
+    on(State::DcsIgnore, { Backslash }, Action::StringTerminatorOrIgnore, State::DcsIgnore);
 
-    apc_put(code_point);
-}
+    on(State::OscString, { Intermediate, Param, PrivateMarker, Del, High }, Action::Put, State::OscString);
+    on(State::OscString, finals, Action::Put, State::OscString);
+    on(State::OscString, { Bel }, Action::StringTerminator, State::Ground);
+    on(State::OscString, { Backslash }, Action::StringTerminatorOrPut, State::OscString);
 
-STATE(sos_pm_string) {
-    ON_ENTRY_NOOP(SosPmString);
+    on_all(State::ApcString, Action::Put, State::ApcString);
+    on(State::ApcString, { Bel }, Action::StringTerminator, State::Ground);
+    on(State::ApcString, { Backslash }, Action::StringTerminatorOrPut, State::ApcString);
 
-    if (is_string_terminator(code_point, m_prev)) {
-        m_saw_legacy_string_terminator = code_point == '\a';
-        transition(State::Ground);
-        return;
-    }
+    on(State::SosPmString, { Bel }, Action::StringTerminator, State::Ground);
+    on(State::SosPmString, { Backslash }, Action::StringTerminatorOrIgnore, State::SosPmString);
 
-    ignore(code_point);
+    return table;
 }
 
-STATE(ss3) {
-    ON_ENTRY_NOOP(Ss3);
-
-    output_ss3(code_point);
-    transition(State::Ground);
+void EscapeSequenceParser::print(c32 code_point) {
+    emit(PrintableCharacter(code_point));
 }
 
-void EscapeSequenceParser::ignore(c32) {}
-
-void EscapeSequenceParser::print(c32 code_point) {
-    m_result.push_back(PrintableCharacter(code_point));
+void EscapeSequenceParser::print_run(di::StringView text) {
+    emit(PrintableRun(text));
 }
 
 void EscapeSequenceParser::execute(c32 code_point) {
-    m_result.push_back(ControlCharacter(code_point, m_next_state == State::Escape));
+    emit(ControlCharacter(code_point, m_next_state == State::Escape));
     if (m_mode == Mode::Input) {
         transition(State::Ground);
     }
@@ -536,17 +270,15 @@ void EscapeSequenceParser::esc_dispatch(c32 code_point) {
     if (code_point == '\\') {
         return;
     }
-    m_result.push_back(Escape(di::move(m_intermediate), code_point));
+    emit(Escape(di::move(m_intermediate), code_point));
 }
 
 void EscapeSequenceParser::csi_dispatch(c32 code_point) {
-    m_result.push_back(CSI(di::move(m_intermediate), di::move(m_params), code_point));
+    emit(CSI(di::move(m_intermediate), di::move(m_params), code_point));
 }
 
 void EscapeSequenceParser::hook() {
-    m_on_state_exit = [this] {
-        unhook();
-    };
+    m_on_state_exit = ExitAction::Unhook;
 }
 
 void EscapeSequenceParser::put(c32 code_point) {
@@ -557,47 +289,35 @@ void EscapeSequenceParser::unhook() {
     if (!m_saw_legacy_string_terminator) {
         m_data.pop_back(); // Remove trailing ESC from (ESC \)
     }
-    m_result.push_back(DCS(di::move(m_intermediate), di::move(m_params), di::move(m_data)));
+    emit(DCS(di::move(m_intermediate), di::move(m_params), di::move(m_data)));
 }
 
 void EscapeSequenceParser::osc_start() {
     m_saw_legacy_string_terminator = false;
-    m_on_state_exit = [this] {
-        osc_end();
-    };
-}
-
-void EscapeSequenceParser::osc_put(c32 code_point) {
-    m_data.push_back(code_point);
+    m_on_state_exit = ExitAction::OscEnd;
 }
 
 void EscapeSequenceParser::osc_end() {
     auto terminator = m_saw_legacy_string_terminator ? "\a"_sv : "\033\\"_sv;
-    m_result.push_back(OSC(di::move(m_data), terminator));
+    emit(OSC(di::move(m_data), terminator));
 }
 
 void EscapeSequenceParser::apc_start() {
     m_saw_legacy_string_terminator = false;
-    m_on_state_exit = [this] {
-        apc_end();
-    };
-}
-
-void EscapeSequenceParser::apc_put(c32 code_point) {
-    m_data.push_back(code_point);
+    m_on_state_exit = ExitAction::ApcEnd;
 }
 
 void EscapeSequenceParser::apc_end() {
     if (!m_saw_legacy_string_terminator) {
         m_data.pop_back(); // Remove trailing ESC from (ESC \)
     }
-    m_result.push_back(APC(di::move(m_data)));
+    emit(APC(di::move(m_data)));
 }
 
 void EscapeSequenceParser::output_ss3(c32 code_point) {
     // SS3 A gets mapped to CSI A, with no intermediate or parameters. This
     // makes parsing key presses easier as we only worry about CSI.
-    m_result.push_back(CSI({}, {}, code_point));
+    emit(CSI({}, {}, code_point));
 }
 
 void EscapeSequenceParser::add_param(di::Optional<u32> param) {
@@ -618,14 +338,115 @@ void EscapeSequenceParser::add_param(di::Optional<u32> param) {
 }
 
 void EscapeSequenceParser::transition(State state) {
-    if (m_on_state_exit) {
-        m_on_state_exit();
+    switch (di::exchange(m_on_state_exit, ExitAction::None)) {
+        case ExitAction::None:
+            break;
+        case ExitAction::AddParam:
+            if (!m_current_param.empty()) {
+                add_param(di::parse<u32>(m_current_param).optional_value());
+            }
+            break;
+        case ExitAction::Unhook:
+            unhook();
+            break;
+        case ExitAction::OscEnd:
+            osc_end();
+            break;
+        case ExitAction::ApcEnd:
+            apc_end();
+            break;
     }
-    m_on_state_exit = nullptr;
     m_next_state = state;
 }
 
+void EscapeSequenceParser::enter(State state) {
+    switch (state) {
+        case State::Escape:
+        case State::CsiEntry:
+        case State::DcsEntry:
+            clear();
+            return;
+        case State::CsiParam:
+        case State::DcsParam:
+            m_on_state_exit = ExitAction::AddParam;
+            return;
+        case State::DcsPassthrough:
+            hook();
+            return;
+        case State::OscString:
+            osc_start();
+            return;
+        case State::ApcString:
+            apc_start();
+            return;
+        default:
+            return;
+    }
+}
+
+void EscapeSequenceParser::perform(Transition const& transition, c32 code_point) {
+    switch (transition.action) {
+        case Action::None:
+            break;
+        case Action::Print:
+            print(code_point);
+            break;
+        case Action::Execute:
+            execute(code_point);
+            break;
+        case Action::Collect:
+            collect(code_point);
+            break;
+        case Action::Param:
+            param(code_point);
+            break;
+        case Action::EscDispatch:
+            esc_dispatch(code_point);
+            break;
+        case Action::CsiDispatch:
+            // Transition first, so that the exit action of the CSI param state adds the final parameter.
+            this->transition(transition.next_state);
+            csi_dispatch(code_point);
+            return;
+        case Action::Put:
+            put(code_point);
+            break;
+        case Action::OutputSs3:
+            output_ss3(code_point);
+            break;
+        case Action::StringTerminator:
+            m_saw_legacy_string_terminator = code_point == '\a';
+            break;
+        case Action::StringTerminatorOrPut:
+        case Action::StringTerminatorOrIgnore:
+            // A backslash only terminates the string when it follows an ESC (ESC \).
+            if (m_prev == '\x1b') {
+                m_saw_legacy_string_terminator = false;
+                this->transition(State::Ground);
+                return;
+            }
+            if (transition.action == Action::StringTerminatorOrPut) {
+                put(code_point);
+            }
+            break;
+    }
+
+    if (transition.has_transition) {
+        this->transition(transition.next_state);
+    }
+}
+
 void EscapeSequenceParser::on_input(c32 code_point) {
+    constexpr static auto char_classes = [] {
+        auto result = di::Array<CharClass, 128> {};
+        for (auto code_point : di::range(128_u32)) {
+            result[code_point] = classify(code_point);
+        }
+        return result;
+    }();
+    constexpr static auto application_table = make_transition_table(Mode::Application);
+    constexpr static auto input_table = make_transition_table(Mode::Input);
+
     auto _ = di::ScopeExit([&] {
         m_prev = code_point;
     });
@@ -650,23 +471,59 @@ void EscapeSequenceParser::on_input(c32 code_point) {
         return;
     }
 
-    switch (m_next_state) {
-#define __ENUMERATE_STATE(N, n)       \
-    case State::N:                    \
-        return n##_state(code_point);
-        __ENUMERATE_STATES(__ENUMERATE_STATE)
-#undef __ENUMERATE_STATE
+    // Entry actions run when the first code point is processed in a new state.
+    if (m_last_state != m_next_state) {
+        m_last_state = m_next_state;
+        enter(m_next_state);
     }
+
+    auto char_class = code_point < 0x80 ? char_classes[code_point] : classify(code_point);
+    auto const& table = m_mode == Mode::Application ? application_table : input_table;
+    perform(table[usize(m_next_state)][usize(char_class)], code_point);
 }
 
-auto EscapeSequenceParser::parse_application_escape_sequences(di::StringView data) -> di::Span<ParserResult> {
-    m_result.clear();
+void EscapeSequenceParser::emit(ParserResult&& result) {
+    if (m_sink) {
+        (*m_sink)(di::move(result));
+        return;
+    }
+    m_result.push_back(di::move(result));
+}
+
+void EscapeSequenceParser::parse_application(di::StringView data, Sink sink) {
+    m_sink = &sink;
+    auto _ = di::ScopeExit([&] {
+        m_sink = nullptr;
+    });
 
     m_mode = Mode::Application;
-    for (auto code_point : data) {
-        on_input(code_point);
+    for (auto it = data.begin(); it != data.end();) {
+        // Fast path: in the ground state, printable text is emitted as a single run which views the input
+        // directly. This avoids dispatching each code point individually, which dominates when an application
+        // outputs large amounts of plain text.
+        if (m_next_state == State::Ground && is_printable(*it)) {
+            auto run_end = di::next(it);
+            while (run_end != data.end() && is_printable(*run_end)) {
+                ++run_end;
+            }
+
+            m_last_state = State::Ground;
+            m_prev = *di::prev(run_end);
+            print_run(di::StringView(it, run_end));
+            it = run_end;
+            continue;
+        }
+
+        on_input(*it);
+        ++it;
     }
+}
 
+auto EscapeSequenceParser::parse_application_escape_sequences(di::StringView data) -> di::Span<ParserResult> {
+    m_result.clear();
+    parse_application(data, [&](ParserResult&& result) {
+        m_result.push_back(di::move(result));
+    });
     return m_result.span();
 }
 
@@ -688,7 +545,7 @@ auto EscapeSequenceParser::parse_input_escape_sequences(di::StringView data, Fea
         // supports the kitty key protocol.
         if (flush && m_next_state == State::Escape) {
             transition(State::Ground);
-            m_result.push_back(ControlCharacter('\x1b'));
+            emit(ControlCharacter('\x1b'));
         }
 
         // Special case: if we get the start of a DCS string (ESC P), and
@@ -699,7 +556,7 @@ auto EscapeSequenceParser::parse_input_escape_sequences(di::StringView data, Fea
                       m_next_state == State::DcsIntermediate || m_next_state == State::DcsPassthrough ||
                       m_next_state == State::DcsParam)) {
             transition(State::Ground);
-            m_result.push_back(ControlCharacter('P', true));
+            emit(ControlCharacter('P', true));
         }
 
         // Special case: if we get the start of a OSC string (ESC ]), and
@@ -708,7 +565,7 @@ auto EscapeSequenceParser::parse_input_escape_sequences(di::StringView data, Fea
         // by pressint alt+].
         if (flush && (m_next_state == State::OscString)) {
             transition(State::Ground);
-            m_result.push_back(ControlCharacter(']', true));
+            emit(ControlCharacter(']', true));
         }
     }
 
@@ -0,0 +1,319 @@
+#include "ttx/io_reactor.h"
+
+#include "di/sync/memory_order.h"
+#include "di/util/clamp.h"
+#include "dius/print.h"
+
+// dius has no wrappers for epoll, eventfd, pidfd or querying the number of cores, so the reactor uses them directly.
+// This file is the only place they're used, and every failure is reported with its errno.
+#ifdef __linux__
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace ttx {
+#ifdef __linux__
+// The wake file descriptor is registered with id 0, which is never handed out to callers.
+constexpr static auto wake_id = u64(0);
+
+// The registration whose handler is running on the current thread, if any.
+static thread_local auto s_current_id = u64(0);
+
+static auto errno_error() -> di::Unexpected<di::BasicError> {
+    return di::Unexpected(di::BasicError(errno));
+}
+
+static auto watch(i32 poll_fd, i32 operation, i32 fd, u64 id) -> di::Result<> {
+    // Registrations are one-shot, so that a file descriptor is not reported again until its handler
+    // has finished and the registration is re-armed.
+    auto event = epoll_event {};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.u64 = id;
+    if (epoll_ctl(poll_fd, operation, fd, &event) < 0) {
+        return errno_error();
+    }
+    return {};
+}
+
+// The number of cores available to run workers on, or none if it can't be determined.
+static auto online_cores() -> di::Optional<usize> {
+    auto cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores <= 0) {
+        return {};
+    }
+    return usize(cores);
+}
+
+auto IoReactor::shared() -> IoReactor* {
+    static auto reactor = create();
+    if (!reactor || reactor.value()->failed()) {
+        return nullptr;
+    }
+    return reactor.value().get();
+}
+
+auto IoReactor::create() -> di::Result<di::Box<IoReactor>> {
+    auto poll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (poll_fd < 0) {
+        return errno_error();
+    }
+    auto wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wake_fd < 0) {
+        auto error = errno_error();
+        close(poll_fd);
+        return error;
+    }
+    return create(poll_fd, wake_fd);
+}
+
+auto IoReactor::create(i32 poll_fd, i32 wake_fd) -> di::Result<di::Box<IoReactor>> {
+    // From here on, the reactor owns both file descriptors and will close them.
+    auto result = di::make_box<IoReactor>(poll_fd, wake_fd);
+
+    // The wake file descriptor is only used for shutting down, so it is never re-armed.
+    TRY(watch(poll_fd, EPOLL_CTL_ADD, wake_fd, wake_id));
+
+    // Use one worker per core, so that many busy panes can be processed in parallel.
+    auto worker_count = di::clamp(online_cores().value_or(min_worker_count), min_worker_count, max_worker_count);
+    for (auto _ : di::range(worker_count)) {
+        result->m_workers.push_back(di::make_box<Worker>());
+    }
+
+    result->m_poll_thread = TRY(dius::Thread::create([&self = *result.get()] {
+        self.poll_thread();
+    }));
+    for (auto i : di::range(worker_count)) {
+        result->m_workers[i]->thread = TRY(dius::Thread::create([&self = *result.get(), i] {
+            self.worker_thread(i);
+        }));
+    }
+    return result;
+}
+
+IoReactor::~IoReactor() {
+    m_state.with_lock([&](State&) {
+        m_done.store(true, di::MemoryOrder::Release);
+        m_condition.notify_all();
+    });
+
+    auto value = u64(1);
+    (void) write(m_wake_fd, &value, sizeof(value));
+
+    (void) m_poll_thread.join();
+    for (auto& worker : m_workers) {
+        (void) worker->thread.join();
+    }
+
+    close(m_wake_fd);
+    close(m_poll_fd);
+}
+
+auto IoReactor::add(i32 fd, Handler handler) -> di::Result<u64> {
+    return add(fd, false, di::move(handler));
+}
+
+auto IoReactor::add_process(i32 pid, Handler handler) -> di::Result<u64> {
+    // A pidfd becomes readable once the process exits, which lets process exit be handled like any other event.
+    auto pid_fd = i32(syscall(SYS_pidfd_open, pid, 0));
+    if (pid_fd < 0) {
+        return errno_error();
+    }
+    return add(pid_fd, true, di::move(handler));
+}
+
+auto IoReactor::add(i32 fd, bool owns_fd, Handler handler) -> di::Result<u64> {
+    return m_state.with_lock([&](State& state) -> di::Result<u64> {
+        // Nothing polls the file descriptor once the reactor has stopped, so the handler would never run.
+        if (m_done.load(di::MemoryOrder::Acquire)) {
+            if (owns_fd) {
+                close(fd);
+            }
+            return di::Unexpected(di::BasicError(ECANCELED));
+        }
+
+        auto id = state.next_id++;
+        state.registrations.insert_or_assign(id, Registration {
+                                                     .fd = fd,
+                                                     .owns_fd = owns_fd,
+                                                     .handler = di::move(handler),
+                                                 });
+        if (auto result = watch(m_poll_fd, EPOLL_CTL_ADD, fd, id); !result) {
+            state.registrations.erase(id);
+            if (owns_fd) {
+                close(fd);
+            }
+            return di::Unexpected(di::move(result).error());
+        }
+        return id;
+    });
+}
+
+void IoReactor::remove(u64 id) {
+    auto lock = di::UniqueLock(m_state.get_lock());
+
+    // SAFETY: we acquired the lock manually above.
+    auto& state = m_state.get_assuming_no_concurrent_accesses();
+    auto registration = state.registrations.find(id);
+    if (registration == state.registrations.end()) {
+        return;
+    }
+
+    auto& [_, value] = *registration;
+    value.removed = true;
+    (void) epoll_ctl(m_poll_fd, EPOLL_CTL_DEL, value.fd, nullptr);
+
+    // When called from its own handler, the worker finishes the removal once the handler returns.
+    if (s_current_id == id) {
+        value.detached = true;
+        return;
+    }
+
+    // Wait for the handler to finish, since it likely references the caller's state.
+    m_condition.wait(lock, [&] {
+        return !value.running;
+    });
+
+    if (value.owns_fd) {
+        close(value.fd);
+    }
+    state.registrations.erase(id);
+}
+
+void IoReactor::stop() {
+    m_state.with_lock([&](State&) {
+        m_failed.store(true, di::MemoryOrder::Release);
+        m_done.store(true, di::MemoryOrder::Release);
+        m_condition.notify_all();
+    });
+}
+
+void IoReactor::poll_thread() {
+    constexpr auto max_events = 64;
+
+    epoll_event events[max_events];
+    while (!m_done.load(di::MemoryOrder::Acquire)) {
+        auto count = epoll_wait(m_poll_fd, events, max_events, -1);
+        if (count < 0) {
+            // Being interrupted by a signal is harmless. Any other error means the epoll file descriptor is unusable,
+            // so retrying would just spin. Stop instead, which lets new panes fall back to dedicated threads.
+            if (errno == EINTR) {
+                continue;
+            }
+            auto error = errno;
+            dius::eprintln("I/O reactor stopped: epoll_wait() failed with errno {}"_sv, error);
+            stop();
+            return;
+        }
+
+        m_state.with_lock([&](State& state) {
+            for (auto i = 0; i < count; i++) {
+                auto id = events[i].data.u64;
+                auto registration = state.registrations.find(id);
+                if (id == wake_id || registration == state.registrations.end()) {
+                    continue;
+                }
+
+                // Queue the registration on the worker which last ran it, which likely still has its state cached.
+                auto& [_, value] = *registration;
+                m_workers[value.worker]->queue.with_lock([&](di::Queue<u64>& queue) {
+                    queue.push(id);
+                });
+                m_pending.fetch_add(1, di::MemoryOrder::Release);
+            }
+            m_condition.notify_all();
+        });
+    }
+}
+
+auto IoReactor::take_ready(usize index) -> di::Optional<u64> {
+    // Prefer this worker's own queue, and otherwise steal from the other workers, starting with the next one
+    // so that stealing is spread evenly.
+    for (auto offset : di::range(m_workers.size())) {
+        auto& worker = *m_workers[(index + offset) % m_workers.size()];
+        auto id = worker.queue.with_lock([&](di::Queue<u64>& queue) {
+            return queue.pop();
+        });
+        if (id) {
+            m_pending.fetch_sub(1, di::MemoryOrder::Relaxed);
+            return id;
+        }
+    }
+    return {};
+}
+
+void IoReactor::worker_thread(usize index) {
+    for (;;) {
+        auto id = take_ready(index);
+
+        auto lock = di::UniqueLock(m_state.get_lock());
+        if (!id) {
+            // Only sleep once every queue is empty. The pending count is incremented while holding the state
+            // lock, so checking it in the predicate can't miss a wake up.
+            m_condition.wait(lock, [&] {
+                return m_done.load(di::MemoryOrder::Acquire) || m_pending.load(di::MemoryOrder::Acquire) > 0;
+            });
+            if (m_done.load(di::MemoryOrder::Acquire)) {
+                return;
+            }
+            continue;
+        }
+        if (m_done.load(di::MemoryOrder::Acquire)) {
+            return;
+        }
+
+        // SAFETY: we acquired the lock manually above.
+        auto& state = m_state.get_assuming_no_concurrent_accesses();
+
+        // The registration may have been removed after it was reported.
+        auto registration = state.registrations.find(*id);
+        if (registration == state.registrations.end()) {
+            continue;
+        }
+        auto& [_, value] = *registration;
+        if (value.removed) {
+            continue;
+        }
+
+        // Run the handler without holding the lock. The registration can't be erased while it is running.
+        value.running = true;
+        value.worker = index;
+        s_current_id = *id;
+        lock.unlock();
+        auto keep_polling = value.handler();
+        lock.lock();
+        s_current_id = 0;
+        value.running = false;
+
+        if (!value.removed && keep_polling) {
+            (void) watch(m_poll_fd, EPOLL_CTL_MOD, value.fd, *id);
+        } else if (value.detached) {
+            // The handler removed itself, so nobody else is waiting to erase the registration.
+            if (value.owns_fd) {
+                close(value.fd);
+            }
+            state.registrations.erase(*id);
+        }
+        m_condition.notify_all();
+    }
+}
+#else
+auto IoReactor::shared() -> IoReactor* {
+    return nullptr;
+}
+
+IoReactor::~IoReactor() = default;
+
+auto IoReactor::add(i32, Handler) -> di::Result<u64> {
+    return di::Unexpected(di::BasicError::InvalidArgument);
+}
+
+auto IoReactor::add_process(i32, Handler) -> di::Result<u64> {
+    return di::Unexpected(di::BasicError::InvalidArgument);
+}
+
+void IoReactor::remove(u64) {}
+#endif
+}
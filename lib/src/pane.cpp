@@ -5,11 +5,14 @@
 #include "di/function/container/function.h"
 #include "di/sync/atomic.h"
 #include "di/sync/memory_order.h"
+#include "di/vocab/array/prelude.h"
 #include "di/vocab/pointer/box.h"
 #include "dius/print.h"
+#include "dius/steady_clock.h"
 #include "dius/sync_file.h"
 #include "dius/system/process.h"
 #include "ttx/direction.h"
+#include "ttx/io_reactor.h"
 #include "ttx/modifiers.h"
 #include "ttx/mouse.h"
 #include "ttx/mouse_event.h"
@@ -89,12 +92,14 @@ auto Pane::create_from_replay(u64 id, di::Optional<di::Path> cwd, di::PathView r
             break;
         }
 
-        auto utf8_string = utf8_decoder.decode(buffer | di::take(*nread));
-
-        auto parser_result = parser.parse_application_escape_sequences(utf8_string);
-
+        // Parse directly into the terminal, so that no intermediate results are stored.
         auto events = pane->m_terminal.with_lock([&](Terminal& terminal) {
-            terminal.on_parser_results(parser_result.span());
+            utf8_decoder.decode_view(buffer | di::take(*nread), [&](di::StringView utf8_text) {
+                parser.parse(utf8_text, [&](auto&& result) {
+                    terminal.on_parser_result(di::move(result));
+                });
+            });
+            terminal.flush_line_feeds();
             return terminal.outgoing_events();
         });
 
@@ -165,56 +170,68 @@ auto Pane::create(u64 id, CreatePaneArgs args, Size const& size) -> di::Result<d
     pane->m_restore_termios = di::move(restore_termios);
 #endif
 
-    pane->m_process_thread = TRY(dius::Thread::create([&pane = *pane] mutable {
-        auto result = pane.m_process.wait();
-        pane.m_done.store(true, di::MemoryOrder::Release);
-
-        if (pane.m_hooks.did_exit) {
-            pane.m_hooks.did_exit(pane, result.optional_value());
+    // Track the pane's scroll back usage before anything can write to it.
+    if (args.scroll_back_limit) {
+        pane->m_terminal.get_assuming_no_concurrent_accesses().set_scroll_back_limit(*args.scroll_back_limit);
+    }
+    if (args.scroll_back_spill_dir) {
+        // Spilling is best effort, so the pane is still usable if the directory can't be created.
+        if (auto spill = terminal::ScrollBackSpill::create(args.scroll_back_spill_dir.value().clone())) {
+            pane->m_terminal.get_assuming_no_concurrent_accesses().set_scroll_back_spill(di::move(spill).value());
         }
-    }));
-
-    pane->m_reader_thread =
-        TRY(dius::Thread::create([&pane = *pane, capture_file = di::move(capture_file)] mutable -> void {
-            auto parser = EscapeSequenceParser();
-            auto utf8_decoder = Utf8StreamDecoder {};
-
-            auto buffer = di::Vector<byte> {};
-            buffer.resize(16384);
-
-            while (!pane.m_done.load(di::MemoryOrder::Acquire)) {
-                // SAFETY: this thread is the only one which reads the pty.
-                auto nread = pane.m_pty_controller.get_assuming_no_concurrent_accesses().read_some(buffer.span());
-                if (!nread.has_value()) {
-                    break;
-                }
-
-                if (capture_file) {
-                    if (pane.m_capture.load(di::MemoryOrder::Acquire)) {
-                        (void) di::write_exactly(*capture_file, buffer | di::take(*nread));
-                    } else {
-                        capture_file = {};
-                    }
-                }
-
-                auto utf8_string = utf8_decoder.decode(buffer | di::take(*nread));
+    }
+    pane->m_governor = &ScrollBackGovernor::shared();
+    pane->m_governor_id = pane->m_governor->add({
+        .last_viewed =
+            [&pane = *pane] {
+                return pane.last_viewed();
+            },
+        .discard_oldest =
+            [&pane = *pane] {
+                return pane.discard_oldest_scroll_back();
+            },
+    });
 
-                auto parser_result = parser.parse_application_escape_sequences(utf8_string);
+    auto reader = PtyReader { .capture_file = di::move(capture_file) };
 
-                auto events = pane.m_terminal.with_lock([&](Terminal& terminal) {
-                    terminal.on_parser_results(parser_result.span());
-                    return terminal.outgoing_events();
-                });
+    // Prefer servicing the pane from the shared reactor, which keeps the number of threads constant regardless
+    // of how many panes are open. If that isn't possible, fall back to dedicated threads.
+    pane->m_reactor = IoReactor::shared();
+    if (pane->m_reactor) {
+        // SAFETY: only the reactor reads the pty, and the file descriptor remains valid for the pane's lifetime.
+        auto pty_fd = pane->m_pty_controller.get_assuming_no_concurrent_accesses().file_descriptor();
+        auto pty_registration = pane->m_reactor->add(pty_fd, [&pane = *pane, reader = di::move(reader)] mutable {
+            return pane.read_pty_output(reader);
+        });
+        auto process_registration = pane->m_reactor->add_process(process.id(), [&pane = *pane] {
+            pane.wait_for_process_exit();
+            return false;
+        });
+        if (pty_registration && process_registration) {
+            pane->m_pty_registration = *pty_registration;
+            pane->m_process_registration = *process_registration;
+        } else {
+            // Undo any partial registration. The reader state was consumed, so recreate it without capturing.
+            if (pty_registration) {
+                pane->m_reactor->remove(*pty_registration);
+            }
+            if (process_registration) {
+                pane->m_reactor->remove(*process_registration);
+            }
+            pane->m_reactor = nullptr;
+            reader = PtyReader {};
+        }
+    }
 
-                for (auto&& event : events) {
-                    pane.handle_terminal_event(di::move(event));
-                }
+    if (!pane->m_reactor) {
+        pane->m_process_thread = TRY(dius::Thread::create([&pane = *pane] mutable {
+            pane.wait_for_process_exit();
+        }));
 
-                if (pane.m_hooks.did_update) {
-                    pane.m_hooks.did_update(pane);
-                }
-            }
+        pane->m_reader_thread = TRY(dius::Thread::create([&pane = *pane, reader = di::move(reader)] mutable -> void {
+            while (pane.read_pty_output(reader)) {}
         }));
+    }
 
     if (args.pipe_input) {
         pane->m_pipe_writer_thread = TRY(dius::Thread::create(
@@ -243,8 +260,9 @@ auto Pane::create(u64 id, CreatePaneArgs args, Size const& size) -> di::Result<d
                         break;
                     }
 
-                    auto utf8_string = utf8_decoder.decode(buffer | di::take(*nread));
-                    contents.append(utf8_string);
+                    utf8_decoder.decode_view(buffer | di::take(*nread), [&](di::StringView utf8_text) {
+                        contents.append(utf8_text);
+                    });
                 }
 
                 (void) read.close();
@@ -269,12 +287,139 @@ Pane::~Pane() {
     (void) m_process.signal(dius::Signal::Hangup);
     (void) m_pipe_reader_thread.join();
     (void) m_pipe_writer_thread.join();
+
+    // Removing the registrations waits for any running handler, after which the reactor no longer references
+    // this pane. If the process exit hasn't been observed yet, wait for it here like the process thread would.
+    if (m_reactor) {
+        for (auto id : m_pty_registration) {
+            m_reactor->remove(id);
+        }
+        for (auto id : m_process_registration) {
+            m_reactor->remove(id);
+        }
+        if (!m_done.load(di::MemoryOrder::Acquire)) {
+            wait_for_process_exit();
+        }
+    }
+
     (void) m_reader_thread.join();
     (void) m_process_thread.join();
+
+    // Nothing reports usage anymore, since the reader has finished.
+    if (m_governor) {
+        m_governor->remove(m_governor_id, m_scroll_back_cells);
+    }
+}
+
+struct Pane::PtyReader {
+    EscapeSequenceParser parser {};
+    Utf8StreamDecoder utf8_decoder {};
+    di::Optional<dius::SyncFile> capture_file {};
+};
+
+auto Pane::read_pty_output(PtyReader& reader) -> bool {
+    if (m_done.load(di::MemoryOrder::Acquire)) {
+        return false;
+    }
+
+    // The read buffer is per thread rather than per pane, since it is only used until the data is parsed.
+    constexpr auto buffer_size = 16384_usize;
+    constexpr auto parse_budget = 4096_usize;
+    thread_local auto buffer = di::Array<byte, buffer_size> {};
+
+    // SAFETY: only one thread reads the pty at a time.
+    auto nread = m_pty_controller.get_assuming_no_concurrent_accesses().read_some(buffer.span());
+    if (!nread.has_value() || *nread == 0) {
+        return false;
+    }
+
+    if (reader.capture_file) {
+        if (m_capture.load(di::MemoryOrder::Acquire)) {
+            (void) di::write_exactly(*reader.capture_file, buffer | di::take(*nread));
+        } else {
+            reader.capture_file = {};
+        }
+    }
+
+    // Parse directly into the terminal, so that no intermediate results are stored. The text is applied in slices
+    // of at most parse_budget bytes, releasing the terminal lock in between, so that a pane which is flooded with
+    // output doesn't starve the render thread.
+    reader.utf8_decoder.decode_view(buffer | di::take(*nread), [&](di::StringView utf8_text) {
+        auto const* it = utf8_text.data();
+        auto const* end = it + utf8_text.size_bytes();
+        while (it != end) {
+            auto const* slice_end = end - it > isize(parse_budget) ? it + parse_budget : end;
+            while (slice_end != end && (u8(*slice_end) & 0xC0) == 0x80) {
+                --slice_end;
+            }
+            auto slice = di::StringView(di::encoding::assume_valid, it, slice_end);
+            it = slice_end;
+
+            auto events = m_terminal.with_lock([&](Terminal& terminal) {
+                reader.parser.parse(slice, [&](auto&& result) {
+                    terminal.on_parser_result(di::move(result));
+                });
+                terminal.flush_line_feeds();
+                update_scroll_back_usage(terminal);
+                return terminal.outgoing_events();
+            });
+
+            for (auto&& event : events) {
+                handle_terminal_event(di::move(event));
+            }
+        }
+    });
+
+    // This must happen without holding the terminal lock, since the governor may lock other panes.
+    if (m_governor && m_governor->over_budget()) {
+        m_governor->enforce();
+    }
+
+    if (m_hooks.did_update) {
+        m_hooks.did_update(*this);
+    }
+    return true;
+}
+
+void Pane::update_scroll_back_usage(Terminal& terminal) {
+    if (!m_governor) {
+        return;
+    }
+    auto cells = terminal.scroll_back_cells();
+    if (cells != m_scroll_back_cells) {
+        m_governor->update_usage(m_scroll_back_cells, cells);
+        m_scroll_back_cells = cells;
+    }
+}
+
+void Pane::set_scroll_back_limit(usize max_cells) {
+    m_terminal.with_lock([&](Terminal& terminal) {
+        terminal.set_scroll_back_limit(max_cells);
+        update_scroll_back_usage(terminal);
+    });
+}
+
+auto Pane::discard_oldest_scroll_back() -> usize {
+    return m_terminal.with_lock([&](Terminal& terminal) {
+        auto result = terminal.discard_oldest_scroll_back();
+        update_scroll_back_usage(terminal);
+        return result;
+    });
+}
+
+void Pane::wait_for_process_exit() {
+    auto result = m_process.wait();
+    m_done.store(true, di::MemoryOrder::Release);
+
+    if (m_hooks.did_exit) {
+        m_hooks.did_exit(*this, result.optional_value());
+    }
 }
 
 // NOLINTNEXTLINE(readability-function-cognitive-complexity)
 auto Pane::draw(Renderer& renderer) -> RenderedCursor {
+    m_last_viewed.store(i64(dius::SteadyClock::now().time_since_epoch().count()), di::MemoryOrder::Relaxed);
+
     auto rendered_cursor = m_terminal.with_lock([&](Terminal& terminal) {
         auto visible_size = m_desired_visible_size.value_or(terminal.visible_size());
         auto& screen = terminal.active_screen().screen;
@@ -291,15 +436,40 @@ auto Pane::draw(Renderer& renderer) -> RenderedCursor {
                 }
                 end_row = r - m_vertical_scroll_offset + 1;
 
-                auto end_col = 0_u32;
                 auto [row_index, row_group] = screen.find_row(r + screen.visual_scroll_offset());
                 auto const& row = row_group.rows()[row_index];
-                for (auto [c, cell, text, graphics, hyperlink, multi_cell_info] : row_group.iterate_row(row_index)) {
-                    if (c < m_horizontal_scroll_offset || cell.is_nonprimary_in_multi_cell()) {
-                        continue;
-                    }
+                auto const cols = u32(row.cells.size());
+                auto end_col = cols > m_horizontal_scroll_offset ? cols - m_horizontal_scroll_offset : 0_u32;
+
+                // Only redraw the columns which changed since the last frame. The renderer remembers the
+                // previous contents, so clean rows can be skipped entirely.
+                auto dirty_start = whole_screen_dirty ? 0_u32 : row.dirty_start;
+                auto dirty_end = whole_screen_dirty ? cols : (row.dirty_end < cols ? row.dirty_end : cols);
+                while (dirty_start > 0 && dirty_start < dirty_end &&
+                       row.cells[dirty_start].is_nonprimary_in_multi_cell()) {
+                    dirty_start--;
+                }
+                if (dirty_start < m_horizontal_scroll_offset) {
+                    dirty_start = m_horizontal_scroll_offset;
+                }
+
+                if (dirty_start < dirty_end) {
+                    auto search_matches = screen.search_matches_in_row(r + screen.visual_scroll_offset());
+                    auto in_search_match = [&](u32 col) {
+                        for (auto const& match : search_matches) {
+                            if (col >= match.start.col && col <= match.end.col) {
+                                return true;
+                            }
+                        }
+                        return false;
+                    };
+
+                    for (auto [c, cell, text, graphics, hyperlink, multi_cell_info] :
+                         row_group.iterate_row(row_index, dirty_start, dirty_end)) {
+                        if (cell.is_nonprimary_in_multi_cell()) {
+                            continue;
+                        }
 
-                    if (!cell.stale || !row.stale || whole_screen_dirty) {
                         auto selected = !text.empty() && screen.in_selection({ r + screen.visual_scroll_offset(),
                                                                                c - m_horizontal_scroll_offset });
                         auto gfx = graphics;
@@ -314,13 +484,21 @@ auto Pane::draw(Renderer& renderer) -> RenderedCursor {
                             gfx.fg = Color(0xcd, 0xd6, 0xf4);
                             gfx.bg = Color(0x58, 0x5b, 0x70);
                             gfx.inverted = false;
+                        } else if (screen.in_search_match({ r + screen.visual_scroll_offset(), c })) {
+                            // Taken from catpuccin mocha (peach)
+                            gfx.fg = Color(0x1e, 0x1e, 0x2e);
+                            gfx.bg = Color(0xfa, 0xb3, 0x87);
+                            gfx.inverted = false;
+                        } else if (in_search_match(c)) {
+                            // Taken from catpuccin mocha (yellow)
+                            gfx.fg = Color(0x1e, 0x1e, 0x2e);
+                            gfx.bg = Color(0xf9, 0xe2, 0xaf);
+                            gfx.inverted = false;
                         }
                         renderer.put_cell(text, r - m_vertical_scroll_offset, c - m_horizontal_scroll_offset, gfx,
                                           hyperlink, multi_cell_info, cell.explicitly_sized,
                                           cell.complex_grapheme_cluster);
-                        cell.stale = true;
                     }
-                    end_col = c - m_horizontal_scroll_offset + multi_cell_info.compute_width();
                 }
                 // Clear any blank cols after the terminal.
                 if (end_col < visible_size.cols) {
@@ -330,7 +508,7 @@ auto Pane::draw(Renderer& renderer) -> RenderedCursor {
                                           terminal::narrow_multi_cell_info, false, false);
                     }
                 }
-                row.stale = true;
+                row.clear_dirty();
             }
 
             // Clear any blank rows after the terminal.
@@ -396,6 +574,7 @@ auto Pane::event(KeyEvent const& event) -> bool {
             // Clear the selection and scroll to the bottom when sending keys to the application.
             terminal.active_screen().screen.visual_scroll_to_bottom();
             terminal.active_screen().screen.clear_selection();
+            terminal.active_screen().screen.clear_search();
             m_pending_selection_start = {};
         });
 
@@ -662,6 +841,42 @@ void Pane::scroll_next_command() {
     });
 }
 
+auto Pane::search(di::StringView pattern, bool regex) -> bool {
+    reset_viewport_scroll();
+
+    auto compiled = regex ? terminal::SearchPattern::regex(pattern) : terminal::SearchPattern::literal(pattern);
+    return m_terminal.with_lock([&](Terminal& terminal) -> bool {
+        auto& screen = terminal.active_screen().screen;
+        if (!compiled) {
+            screen.clear_search();
+            return false;
+        }
+        return screen.set_search(di::move(compiled).value());
+    });
+}
+
+void Pane::search_prev() {
+    reset_viewport_scroll();
+
+    m_terminal.with_lock([&](Terminal& terminal) {
+        terminal.active_screen().screen.search_prev();
+    });
+}
+
+void Pane::search_next() {
+    reset_viewport_scroll();
+
+    m_terminal.with_lock([&](Terminal& terminal) {
+        terminal.active_screen().screen.search_next();
+    });
+}
+
+void Pane::clear_search() {
+    m_terminal.with_lock([&](Terminal& terminal) {
+        terminal.active_screen().screen.clear_search();
+    });
+}
+
 void Pane::copy_last_command(bool include_command) {
     m_terminal.with_lock([&](Terminal& terminal) {
         auto text = terminal.active_screen().screen.text_in_last_command(include_command);
@@ -0,0 +1,65 @@
+#include "ttx/scroll_back_governor.h"
+
+#include "di/container/algorithm/sort.h"
+#include "di/container/vector/vector.h"
+
+namespace ttx {
+auto ScrollBackGovernor::shared() -> ScrollBackGovernor& {
+    static auto governor = ScrollBackGovernor();
+    return governor;
+}
+
+auto ScrollBackGovernor::add(Member member) -> u64 {
+    return m_state.with_lock([&](State& state) {
+        auto id = state.next_id++;
+        state.members.insert_or_assign(id, di::move(member));
+        return id;
+    });
+}
+
+void ScrollBackGovernor::remove(u64 id, usize cells) {
+    // Holding the lock ensures enforce() isn't currently discarding from this member.
+    m_state.with_lock([&](State& state) {
+        state.members.erase(id);
+        m_total_cells.fetch_sub(cells, di::MemoryOrder::Relaxed);
+    });
+}
+
+void ScrollBackGovernor::update_usage(usize old_cells, usize new_cells) {
+    if (new_cells > old_cells) {
+        m_total_cells.fetch_add(new_cells - old_cells, di::MemoryOrder::Relaxed);
+    } else {
+        m_total_cells.fetch_sub(old_cells - new_cells, di::MemoryOrder::Relaxed);
+    }
+}
+
+void ScrollBackGovernor::enforce() {
+    m_state.with_lock([&](State& state) {
+        // Another thread may have already brought usage back within budget.
+        if (!over_budget()) {
+            return;
+        }
+
+        // Sample each member's view time once, since it can change while sorting.
+        struct Candidate {
+            i64 last_viewed { 0 };
+            Member* member { nullptr };
+        };
+        auto order = di::Vector<Candidate> {};
+        for (auto& [_, member] : state.members) {
+            order.push_back({ member.last_viewed(), &member });
+        }
+        di::sort(order, di::compare, &Candidate::last_viewed);
+        for (auto const& candidate : order) {
+            while (over_budget()) {
+                if (candidate.member->discard_oldest() == 0) {
+                    break;
+                }
+            }
+            if (!over_budget()) {
+                return;
+            }
+        }
+    });
+}
+}
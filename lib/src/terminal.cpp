@@ -1,11 +1,13 @@
 #include "ttx/terminal.h"
 
+#include "di/container/algorithm/all_of.h"
 #include "di/container/algorithm/contains.h"
 #include "di/math/align_up.h"
 #include "di/serialization/base64.h"
 #include "di/util/construct.h"
 #include "dius/print.h"
 #include "ttx/cursor_style.h"
+#include "ttx/dispatch_table.h"
 #include "ttx/escape_sequence_parser.h"
 #include "ttx/features.h"
 #include "ttx/focus_event_io.h"
@@ -29,24 +31,33 @@ namespace ttx {
 Terminal::Terminal(u64 id, Size const& size)
     : m_id(id), m_primary_screen(size, terminal::Screen::ScrollBackEnabled::Yes), m_available_size(size) {}
 
-void Terminal::on_parser_results(di::Span<ParserResult> results) {
-    for (auto& result : results) {
-        di::visit(
-            [&](auto& r) {
-                this->on_parser_result(di::move(r));
-            },
-            result);
-    }
-}
-
 void Terminal::on_parser_result(PrintableCharacter&& printable_character) {
+    flush_line_feeds();
     if (printable_character.code_point < 0x7F || printable_character.code_point > 0x9F) {
         put_char(printable_character.code_point);
         m_last_graphics_charcter = printable_character.code_point;
     }
 }
 
+void Terminal::on_parser_result(PrintableRun&& printable_run) {
+    if (defer_text_run(printable_run.text)) {
+        return;
+    }
+    flush_line_feeds();
+
+    // The parser considers DEL printable, but it has no graphical representation. Split the run around it,
+    // which matches the filtering done for individual printable characters.
+    for (di::StringView text : printable_run.text | di::split(U'\x7f')) {
+        if (text.empty()) {
+            continue;
+        }
+        active_screen().screen.put_text_run(text, m_auto_wrap_mode);
+        m_last_graphics_charcter = text.back().value();
+    }
+}
+
 void Terminal::on_parser_result(DCS&& dcs) {
+    flush_line_feeds();
     if (dcs.intermediate == "$q"_sv) {
         dcs_decrqss(dcs.params, dcs.data);
         return;
@@ -58,43 +69,43 @@ void Terminal::on_parser_result(DCS&& dcs) {
 }
 
 void Terminal::on_parser_result(OSC&& osc) {
+    flush_line_feeds();
+
+    using Handler = void (Terminal::*)(di::StringView);
+    constexpr static auto table = DispatchTable(di::Array {
+        DispatchEntry<Handler> { 7, &Terminal::osc_7 },
+        DispatchEntry<Handler> { 8, &Terminal::osc_8 },
+        DispatchEntry<Handler> { 52, &Terminal::osc_52 },
+        DispatchEntry<Handler> { 66, &Terminal::osc_66 },
+        DispatchEntry<Handler> { 133, &Terminal::osc_133 },
+        DispatchEntry<Handler> { 8671, &Terminal::osc_8671 },
+    });
+
     auto ps_end = osc.data.find(';');
     if (!ps_end) {
         return;
     }
 
-    auto ps = osc.data.substr(osc.data.begin(), ps_end.begin());
-    if (ps == "7"_sv) {
-        osc_7(osc.data.substr(ps_end.end()));
+    auto key = dispatch_key(osc.data.substr(osc.data.begin(), ps_end.begin()));
+    if (!key) {
         return;
     }
-    if (ps == "8"_sv) {
-        osc_8(osc.data.substr(ps_end.end()));
-        return;
-    }
-    if (ps == "52"_sv) {
-        osc_52(osc.data.substr(ps_end.end()));
-        return;
-    }
-    if (ps == "66"_sv) {
-        osc_66(osc.data.substr(ps_end.end()));
-        return;
-    }
-    if (ps == "133"_sv) {
-        osc_133(osc.data.substr(ps_end.end()));
-        return;
-    }
-    if (ps == "8671"_sv) {
-        osc_8671(osc.data.substr(ps_end.end()));
-        return;
+    if (auto const* handler = table.find(*key)) {
+        (this->*(*handler))(osc.data.substr(ps_end.end()));
     }
 }
 
 void Terminal::on_parser_result(APC&& apc) {
+    flush_line_feeds();
     m_outgoing_events.push_back(di::move(apc));
 }
 
 void Terminal::on_parser_result(ControlCharacter&& control_character) {
+    // A carriage return doesn't depend on the rows, so it can be applied without ending a run of line feeds.
+    if (control_character.code_point != '\n' && control_character.code_point != '\r') {
+        flush_line_feeds();
+    }
+
     switch (control_character.code_point) {
         case 8: {
             c0_bs();
@@ -107,7 +118,7 @@ void Terminal::on_parser_result(ControlCharacter&& control_character) {
             return;
         }
         case '\n': {
-            c0_lf();
+            queue_line_feed();
             return;
         }
         case '\v': {
@@ -128,226 +139,67 @@ void Terminal::on_parser_result(ControlCharacter&& control_character) {
 }
 
 void Terminal::on_parser_result(CSI&& csi) {
-    if (csi.intermediate == "?$"_sv) {
-        switch (csi.terminator) {
-            case 'p': {
-                csi_decrqm(csi.params);
-                return;
-            }
-            default:
-                return;
-        }
-    }
-
-    if (csi.intermediate == "="_sv) {
-        switch (csi.terminator) {
-            case 'c': {
-                csi_da3(csi.params);
-                return;
-            }
-            case 'u': {
-                csi_set_key_reporting_flags(csi.params);
-                return;
-            }
-            default:
-                return;
-        }
-    }
-
-    if (csi.intermediate == ">"_sv) {
-        switch (csi.terminator) {
-            case 'c': {
-                csi_da2(csi.params);
-                return;
-            }
-            case 's': {
-                csi_xshiftescape(csi.params);
-                return;
-            }
-            case 'u': {
-                csi_push_key_reporting_flags(csi.params);
-                return;
-            }
-            default:
-                return;
-        }
-    }
-
-    if (csi.intermediate == "<"_sv) {
-        switch (csi.terminator) {
-            case 'u': {
-                csi_pop_key_reporting_flags(csi.params);
-                return;
-            }
-            default:
-                return;
-        }
-    }
-
-    if (csi.intermediate == "?"_sv) {
-        switch (csi.terminator) {
-            case 'h': {
-                csi_decset(csi.params);
-                return;
-            }
-            case 'l': {
-                csi_decrst(csi.params);
-                return;
-            }
-            case 'u': {
-                csi_get_key_reporting_flags(csi.params);
-                return;
-            }
-            default:
-                return;
-        }
-    }
-
-    if (csi.intermediate == " "_sv) {
-        switch (csi.terminator) {
-            case 'q': {
-                csi_decscusr(csi.params);
-                return;
-            }
-            default:
-                return;
-        }
-    }
-
-    if (csi.intermediate == "!"_sv) {
-        switch (csi.terminator) {
-            case 'p': {
-                csi_decstr(csi.params);
-                return;
-            }
-            default:
-                return;
-        }
-    }
+    flush_line_feeds();
+
+    using Handler = void (Terminal::*)(Params const&);
+    constexpr static auto entry = [](di::StringView intermediate, c32 terminator, Handler handler) {
+        return DispatchEntry<Handler> { *dispatch_key(intermediate, terminator), handler };
+    };
+    constexpr static auto table = DispatchTable(di::Array {
+        entry("?$"_sv, 'p', &Terminal::csi_decrqm),
+        entry("="_sv, 'c', &Terminal::csi_da3),
+        entry("="_sv, 'u', &Terminal::csi_set_key_reporting_flags),
+        entry(">"_sv, 'c', &Terminal::csi_da2),
+        entry(">"_sv, 's', &Terminal::csi_xshiftescape),
+        entry(">"_sv, 'u', &Terminal::csi_push_key_reporting_flags),
+        entry("<"_sv, 'u', &Terminal::csi_pop_key_reporting_flags),
+        entry("?"_sv, 'h', &Terminal::csi_decset),
+        entry("?"_sv, 'l', &Terminal::csi_decrst),
+        entry("?"_sv, 'u', &Terminal::csi_get_key_reporting_flags),
+        entry(" "_sv, 'q', &Terminal::csi_decscusr),
+        entry("!"_sv, 'p', &Terminal::csi_decstr),
+        entry(""_sv, '@', &Terminal::csi_ich),
+        entry(""_sv, 'A', &Terminal::csi_cuu),
+        entry(""_sv, 'B', &Terminal::csi_cud),
+        entry(""_sv, 'C', &Terminal::csi_cuf),
+        entry(""_sv, 'D', &Terminal::csi_cub),
+        entry(""_sv, 'E', &Terminal::csi_cnl),
+        entry(""_sv, 'F', &Terminal::csi_cpl),
+        entry(""_sv, 'G', &Terminal::csi_cha),
+        entry(""_sv, 'H', &Terminal::csi_cup),
+        entry(""_sv, 'J', &Terminal::csi_ed),
+        entry(""_sv, 'K', &Terminal::csi_el),
+        entry(""_sv, 'L', &Terminal::csi_il),
+        entry(""_sv, 'M', &Terminal::csi_dl),
+        entry(""_sv, 'P', &Terminal::csi_dch),
+        entry(""_sv, 'S', &Terminal::csi_su),
+        entry(""_sv, 'T', &Terminal::csi_sd),
+        entry(""_sv, 'X', &Terminal::csi_ech),
+        entry(""_sv, 'b', &Terminal::csi_rep),
+        entry(""_sv, 'c', &Terminal::csi_da1),
+        entry(""_sv, 'd', &Terminal::csi_vpa),
+        entry(""_sv, 'f', &Terminal::csi_hvp),
+        entry(""_sv, 'g', &Terminal::csi_tbc),
+        entry(""_sv, 'm', &Terminal::csi_sgr),
+        entry(""_sv, 'n', &Terminal::csi_dsr),
+        entry(""_sv, 'r', &Terminal::csi_decstbm),
+        entry(""_sv, 's', &Terminal::csi_scosc),
+        entry(""_sv, 't', &Terminal::csi_xtwinops),
+        entry(""_sv, 'u', &Terminal::csi_scorc),
+    });
 
-    if (!csi.intermediate.empty()) {
+    auto key = dispatch_key(csi.intermediate.view(), csi.terminator);
+    if (!key) {
         return;
     }
-
-    switch (csi.terminator) {
-        case '@': {
-            csi_ich(csi.params);
-            return;
-        }
-        case 'A': {
-            csi_cuu(csi.params);
-            return;
-        }
-        case 'B': {
-            csi_cud(csi.params);
-            return;
-        }
-        case 'C': {
-            csi_cuf(csi.params);
-            return;
-        }
-        case 'D': {
-            csi_cub(csi.params);
-            return;
-        }
-        case 'E': {
-            csi_cnl(csi.params);
-            return;
-        }
-        case 'F': {
-            csi_cpl(csi.params);
-            return;
-        }
-        case 'G': {
-            csi_cha(csi.params);
-            return;
-        }
-        case 'H': {
-            csi_cup(csi.params);
-            return;
-        }
-        case 'J': {
-            csi_ed(csi.params);
-            return;
-        }
-        case 'K': {
-            csi_el(csi.params);
-            return;
-        }
-        case 'L': {
-            csi_il(csi.params);
-            return;
-        }
-        case 'M': {
-            csi_dl(csi.params);
-            return;
-        }
-        case 'P': {
-            csi_dch(csi.params);
-            return;
-        }
-        case 'S': {
-            csi_su(csi.params);
-            return;
-        }
-        case 'T': {
-            csi_sd(csi.params);
-            return;
-        }
-        case 'X': {
-            csi_ech(csi.params);
-            return;
-        }
-        case 'b': {
-            csi_rep(csi.params);
-            return;
-        }
-        case 'c': {
-            csi_da1(csi.params);
-            return;
-        }
-        case 'd': {
-            csi_vpa(csi.params);
-            return;
-        }
-        case 'f': {
-            csi_hvp(csi.params);
-            return;
-        }
-        case 'g': {
-            csi_tbc(csi.params);
-            return;
-        }
-        case 'm': {
-            csi_sgr(csi.params);
-            return;
-        }
-        case 'n': {
-            csi_dsr(csi.params);
-            return;
-        }
-        case 'r': {
-            csi_decstbm(csi.params);
-            return;
-        }
-        case 's': {
-            csi_scosc(csi.params);
-            return;
-        }
-        case 't': {
-            csi_xtwinops(csi.params);
-            return;
-        }
-        case 'u': {
-            csi_scorc(csi.params);
-            return;
-        }
-        default:
-            return;
+    if (auto const* handler = table.find(*key)) {
+        (this->*(*handler))(csi.params);
     }
 }
 
 void Terminal::on_parser_result(Escape&& escape) {
+    flush_line_feeds();
+
     if (escape.intermediate == "#"_sv) {
         switch (escape.terminator) {
             case '8': {
@@ -394,6 +246,87 @@ void Terminal::on_parser_result(Escape&& escape) {
     }
 }
 
+// Line feeds at the bottom of the scroll region are queued, so that lines of output scroll the screen once per batch
+// instead of once per line. At most one line feed per row of the scroll region can be queued, since scrolling further
+// would drop rows instead of moving them into the scroll back.
+void Terminal::queue_line_feed() {
+    auto& screen = active_screen().screen;
+    auto const& scroll_region = screen.scroll_region();
+    if (cursor_row() + 1 != scroll_region.end_row) {
+        c0_lf();
+        return;
+    }
+
+    // Like scrolling, a line feed cancels a pending wrap.
+    screen.set_cursor(cursor_row(), cursor_col());
+    m_queued_line_feeds++;
+    if (m_queued_line_feeds == scroll_region.end_row - scroll_region.start_row) {
+        flush_line_feeds();
+    }
+}
+
+// While line feeds are queued, the cursor's logical row is one of the blank rows which scrolling will add. Printable
+// ASCII which fits on that row can't affect any other row, so it is recorded and written once the line feeds are
+// applied. Only the cursor column is updated now, as carriage returns and later text depend on it.
+auto Terminal::defer_text_run(di::StringView text) -> bool {
+    if (m_queued_line_feeds == 0 || text.empty()) {
+        return false;
+    }
+
+    auto& screen = active_screen().screen;
+    auto cursor = screen.cursor();
+    if (cursor.overflow_pending || cursor.col + text.size_bytes() > screen.max_width()) {
+        return false;
+    }
+    if (!di::all_of(text.span(), [](c8 code_unit) {
+            return code_unit >= 0x20 && code_unit < 0x7F;
+        })) {
+        return false;
+    }
+
+    m_deferred_text.push_back({
+        .line = m_queued_line_feeds,
+        .col = cursor.col,
+        .offset = m_deferred_text_buffer.size_bytes(),
+        .size = text.size_bytes(),
+    });
+    m_deferred_text_buffer.append(text);
+
+    // Match the cursor movement of Screen::put_ascii_cells().
+    auto end_col = u32(cursor.col + text.size_bytes());
+    if (end_col == screen.max_width()) {
+        screen.set_cursor(cursor.row, end_col - 1, true);
+    } else {
+        screen.set_cursor(cursor.row, end_col);
+    }
+    m_last_graphics_charcter = text.back().value();
+    return true;
+}
+
+void Terminal::flush_line_feeds() {
+    if (m_queued_line_feeds == 0) {
+        return;
+    }
+
+    auto& screen = active_screen().screen;
+    auto cursor = screen.cursor();
+    screen.scroll_down(m_queued_line_feeds);
+
+    // Text written after the k-th queued line feed belongs on the row which was the bottom row after k line feeds.
+    auto const* buffer = m_deferred_text_buffer.view().data();
+    for (auto const& text : m_deferred_text) {
+        screen.set_cursor(cursor.row - (m_queued_line_feeds - text.line), text.col);
+        screen.put_text_run(di::StringView(di::encoding::assume_valid, buffer + text.offset,
+                                           buffer + text.offset + text.size),
+                            m_auto_wrap_mode);
+    }
+    screen.set_cursor(cursor.row, cursor.col, cursor.overflow_pending);
+
+    m_queued_line_feeds = 0;
+    m_deferred_text.clear();
+    m_deferred_text_buffer.clear();
+}
+
 // Backspace - https://vt100.net/docs/vt510-rm/chapter4.html#T4-1
 void Terminal::c0_bs() {
     auto col = cursor_col();
@@ -799,9 +732,7 @@ void Terminal::csi_rep(Params const& params) {
         return;
     }
     auto n = di::max(1u, params.get(0, 1));
-    for (auto _ : di::range(n)) {
-        active_screen().screen.put_code_point(m_last_graphics_charcter.value(), m_auto_wrap_mode);
-    }
+    active_screen().screen.put_repeated_code_point(m_last_graphics_charcter.value(), n, m_auto_wrap_mode);
 }
 
 // Primary Device Attributes - https://vt100.net/docs/vt510-rm/DA1.html
@@ -1095,6 +1026,8 @@ void Terminal::csi_pop_key_reporting_flags(Params const& params) {
 }
 
 void Terminal::set_visible_size(Size const& size) {
+    flush_line_feeds();
+
     if (m_available_size == size) {
         return;
     }
@@ -1139,12 +1072,17 @@ void Terminal::set_use_alternate_screen_buffer(bool b) {
     }
 
     if (b) {
-        m_alternate_screen = di::make_box<ScreenState>(size(), terminal::Screen::ScrollBackEnabled::No);
+        if (m_cached_alternate_screen) {
+            m_alternate_screen = di::move(m_cached_alternate_screen);
+            m_alternate_screen->reset(size());
+        } else {
+            m_alternate_screen = di::make_box<ScreenState>(size(), terminal::Screen::ScrollBackEnabled::No);
+        }
     } else {
         auto new_size = size();
 
         ASSERT(m_alternate_screen);
-        m_alternate_screen = {};
+        m_cached_alternate_screen = di::move(m_alternate_screen);
 
         active_screen().screen.resize(new_size);
     }
@@ -1164,6 +1102,7 @@ void Terminal::soft_reset() {
     // spec for DECSTR (https://vt100.net/docs/vt510-rm/DECSTR.html), becuase it claims
     // autowrap should be disabled. Autowrap is on by default in this terminal.
 
+    flush_line_feeds();
     set_use_alternate_screen_buffer(false);
 
     active_screen().cursor_style = CursorStyle::SteadyBlock;
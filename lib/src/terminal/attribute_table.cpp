@@ -0,0 +1,79 @@
+#include "ttx/terminal/attribute_table.h"
+
+namespace ttx::terminal {
+auto AttributeTable::maybe_allocate_graphics_id(GraphicsRendition const& rendition) -> di::Optional<u16> {
+    auto existing_id = graphics_id(rendition);
+    if (!existing_id) {
+        return allocate_graphics_id(rendition);
+    }
+    return use_graphics_id(existing_id.value());
+}
+
+auto AttributeTable::maybe_allocate_hyperlink_id(Hyperlink const& hyperlink) -> di::Optional<u16> {
+    auto existing_id = hyperlink_id(hyperlink.id);
+    if (!existing_id) {
+        return allocate_hyperlink_id(hyperlink.clone());
+    }
+    return use_hyperlink_id(existing_id.value());
+}
+
+auto AttributeTable::maybe_allocate_multi_cell_id(MultiCellInfo const& multi_cell_info) -> di::Optional<u16> {
+    auto existing_id = multi_cell_id(multi_cell_info);
+    if (!existing_id) {
+        return allocate_multi_cell_id(multi_cell_info);
+    }
+    return use_multi_cell_id(existing_id.value());
+}
+
+void AttributeTable::drop_graphics_id(u16& id) {
+    if (id) {
+        m_graphics_renditions.drop_id(id);
+        id = 0;
+    }
+}
+
+void AttributeTable::drop_hyperlink_id(u16& id) {
+    if (id) {
+        m_hyperlinks.drop_id(id);
+        id = 0;
+    }
+}
+
+void AttributeTable::drop_multi_cell_id(u16& id) {
+    if (id) {
+        if (id > 1) {
+            m_multi_cell_info.drop_id(id);
+        }
+        id = 0;
+    }
+}
+
+auto AttributeTable::graphics_rendition(u16 id) const -> GraphicsRendition const& {
+    if (id == 0) {
+        return m_empty_graphics;
+    }
+    return m_graphics_renditions.lookup_id(id);
+}
+
+auto AttributeTable::hyperlink(u16 id) const -> Hyperlink const& {
+    ASSERT_NOT_EQ(id, 0);
+    return m_hyperlinks.lookup_id(id);
+}
+
+auto AttributeTable::maybe_hyperlink(u16 id) const -> di::Optional<Hyperlink const&> {
+    if (id == 0) {
+        return {};
+    }
+    return hyperlink(id);
+}
+
+auto AttributeTable::multi_cell_info(u16 id) const -> MultiCellInfo const& {
+    if (id == 0) {
+        return narrow_multi_cell_info;
+    }
+    if (id == 1) {
+        return wide_multi_cell_info;
+    }
+    return m_multi_cell_info.lookup_id(id);
+}
+}
@@ -0,0 +1,359 @@
+#include "ttx/terminal/compressed_rows.h"
+
+#include "di/container/tree/tree_map.h"
+#include "ttx/terminal/cell.h"
+
+namespace ttx::terminal {
+// Each row is encoded as its cell count (u32) and overflow flag (u8), followed by runs of cells. Each run
+// stores its length (u16), the cell flags (u16), either the background color (u32) or the graphics rendition
+// and hyperlink ids (u16 each), and the multi cell id (u16). The text of every cell in the run follows. Since
+// the text size is part of the cell flags, it only needs to be stored once per run.
+//
+// Serialized rows are prefixed with every graphics rendition, hyperlink and multi cell info referenced by the
+// runs, keyed by the id used in the runs. These ids are replaced when the rows are deserialized.
+constexpr static auto max_run_length = usize(di::NumericLimits<u16>::max);
+
+static void write_u8(di::Vector<byte>& data, u8 value) {
+    data.push_back(byte(value));
+}
+
+static void write_u16(di::Vector<byte>& data, u16 value) {
+    write_u8(data, u8(value));
+    write_u8(data, u8(value >> 8));
+}
+
+static void write_u32(di::Vector<byte>& data, u32 value) {
+    write_u16(data, u16(value));
+    write_u16(data, u16(value >> 16));
+}
+
+static void write_string(di::Vector<byte>& data, di::StringView string) {
+    write_u16(data, u16(string.size_bytes()));
+    for (auto code_unit : string.span()) {
+        write_u8(data, u8(code_unit));
+    }
+}
+
+static auto read_u16_at(di::Span<byte const> data, usize offset) -> u16 {
+    return u16(u8(data[offset]) | u16(u8(data[offset + 1])) << 8);
+}
+
+static void write_u16_at(di::Vector<byte>& data, usize offset, u16 value) {
+    data[offset] = byte(u8(value));
+    data[offset + 1] = byte(u8(value >> 8));
+}
+
+static auto unpack_color(u32 packed) -> Color {
+    auto result = Color {};
+    result.type = Color::Type(packed >> 24);
+    result.r = u8(packed >> 16);
+    result.g = u8(packed >> 8);
+    result.b = u8(packed);
+    return result;
+}
+
+// Decodes the values written by the functions above.
+struct CompressedRowsReader {
+    auto read_u8() -> u8 {
+        ASSERT_LT(offset, data.size());
+        return u8(data[offset++]);
+    }
+
+    auto read_u16() -> u16 {
+        auto low = read_u8();
+        return u16(low | u16(read_u8()) << 8);
+    }
+
+    auto read_u32() -> u32 {
+        auto low = read_u16();
+        return low | u32(read_u16()) << 16;
+    }
+
+    auto read_text(usize size) -> di::StringView {
+        ASSERT_LT_EQ(offset + size, data.size());
+        auto const* text = reinterpret_cast<c8 const*>(data.data() + offset);
+        offset += size;
+        return di::StringView(di::encoding::assume_valid, text, text + size);
+    }
+
+    auto read_string() -> di::String { return read_text(read_u16()).to_owned(); }
+
+    di::Span<byte const> data;
+    usize offset { 0 };
+};
+
+// Call function(offset, length, background_only) for every run, where offset is the position of the run's
+// attribute ids (or background color), which are followed by its multi cell id.
+template<typename F>
+static void for_each_run(di::Span<byte const> data, usize row_count, F&& function) {
+    auto reader = CompressedRowsReader { data };
+    for (auto _ : di::range(row_count)) {
+        auto cols = reader.read_u32();
+        (void) reader.read_u8();
+        for (auto start = 0_usize; start < cols;) {
+            auto length = reader.read_u16();
+            auto flags = reader.read_u16();
+            function(reader.offset, usize(length), ((flags >> 11) & 1) != 0);
+            reader.offset += 6 + usize(length) * (flags & Cell::max_text_size);
+            start += length;
+        }
+    }
+    ASSERT_EQ(reader.offset, data.size());
+}
+
+static auto cell_flags(Cell const& cell) -> u16 {
+    return u16(cell.text_size | cell.background_only << 11 | cell.left_boundary_of_multicell << 12 |
+               cell.explicitly_sized << 13 | cell.complex_grapheme_cluster << 14);
+}
+
+static auto same_attributes(Cell const& a, Cell const& b) -> bool {
+    if (cell_flags(a) != cell_flags(b) || a.multi_cell_id != b.multi_cell_id) {
+        return false;
+    }
+    if (a.background_only) {
+        return a.background_color == b.background_color;
+    }
+    return a.ids.graphics_rendition_id == b.ids.graphics_rendition_id && a.ids.hyperlink_id == b.ids.hyperlink_id;
+}
+
+auto CompressedRows::compress(di::Ring<Row> const& rows) -> CompressedRows {
+    auto result = CompressedRows {};
+    result.m_row_count = rows.size();
+
+    auto& data = result.m_data;
+    for (auto const& row : rows) {
+        write_u32(data, u32(row.cells.size()));
+        write_u8(data, row.overflow);
+
+        for (auto start = 0_usize; start < row.cells.size();) {
+            auto const& cell = row.cells[start];
+            auto end = start + 1;
+            while (end < row.cells.size() && end - start < max_run_length && same_attributes(cell, row.cells[end])) {
+                end++;
+            }
+
+            write_u16(data, u16(end - start));
+            write_u16(data, cell_flags(cell));
+            if (cell.background_only) {
+                write_u32(data, cell.background_color.packed());
+            } else {
+                write_u16(data, cell.ids.graphics_rendition_id);
+                write_u16(data, cell.ids.hyperlink_id);
+            }
+            write_u16(data, cell.multi_cell_id);
+
+            for (auto i : di::range(start, end)) {
+                for (auto code_unit : row.cell_text(row.cells[i]).span()) {
+                    write_u8(data, u8(code_unit));
+                }
+            }
+            start = end;
+        }
+    }
+    return result;
+}
+
+void CompressedRows::decompress(di::Ring<Row>& rows, RowPool& pool) const {
+    auto reader = CompressedRowsReader { m_data.span() };
+    for (auto _ : di::range(m_row_count)) {
+        auto cols = reader.read_u32();
+        auto row = pool.acquire(cols, {});
+        row.overflow = reader.read_u8() != 0;
+        row.blank = false;
+        row.mark_all_dirty();
+
+        for (auto start = 0_usize; start < cols;) {
+            auto length = reader.read_u16();
+            auto flags = reader.read_u16();
+
+            auto cell = Cell {};
+            cell.background_only = (flags >> 11) & 1;
+            cell.left_boundary_of_multicell = (flags >> 12) & 1;
+            cell.explicitly_sized = (flags >> 13) & 1;
+            cell.complex_grapheme_cluster = (flags >> 14) & 1;
+            if (cell.background_only) {
+                cell.background_color = unpack_color(reader.read_u32());
+            } else {
+                cell.ids.graphics_rendition_id = reader.read_u16();
+                cell.ids.hyperlink_id = reader.read_u16();
+            }
+            cell.multi_cell_id = reader.read_u16();
+
+            auto text_size = usize(flags & Cell::max_text_size);
+            ASSERT_LT_EQ(start + length, cols);
+            for (auto i : di::range(start, start + length)) {
+                row.cells[i] = cell;
+                if (text_size > 0) {
+                    row.set_cell_text(row.cells[i], reader.read_text(text_size));
+                }
+            }
+            start += length;
+        }
+        rows.push_back(di::move(row));
+    }
+    ASSERT_EQ(reader.offset, m_data.size());
+}
+
+auto CompressedRows::serialize(AttributeTable const& attributes) const -> di::Vector<byte> {
+    // Collect the distinct ids referenced by the rows. Multi cell ids 0 and 1 are fixed, so they're never stored.
+    auto graphics_ids = di::TreeMap<u16, u16> {};
+    auto hyperlink_ids = di::TreeMap<u16, u16> {};
+    auto multi_cell_ids = di::TreeMap<u16, u16> {};
+    for_each_run(m_data.span(), m_row_count, [&](usize offset, usize, bool background_only) {
+        if (!background_only) {
+            if (auto id = read_u16_at(m_data.span(), offset)) {
+                graphics_ids.insert_or_assign(id, id);
+            }
+            if (auto id = read_u16_at(m_data.span(), offset + 2)) {
+                hyperlink_ids.insert_or_assign(id, id);
+            }
+        }
+        if (auto id = read_u16_at(m_data.span(), offset + 4); id > 1) {
+            multi_cell_ids.insert_or_assign(id, id);
+        }
+    });
+
+    auto result = di::Vector<byte> {};
+    write_u16(result, u16(graphics_ids.size()));
+    for (auto [id, _] : graphics_ids) {
+        auto const& rendition = attributes.graphics_rendition(id);
+        write_u16(result, id);
+        write_u32(result, rendition.fg.packed());
+        write_u32(result, rendition.bg.packed());
+        write_u32(result, rendition.underline_color.packed());
+        write_u8(result, u8(rendition.font_weight));
+        write_u8(result, u8(rendition.blink_mode));
+        write_u8(result, u8(rendition.underline_mode));
+        write_u8(result, u8(rendition.italic | rendition.overline << 1 | rendition.inverted << 2 |
+                            rendition.invisible << 3 | rendition.strike_through << 4));
+    }
+
+    write_u16(result, u16(hyperlink_ids.size()));
+    for (auto [id, _] : hyperlink_ids) {
+        auto const& hyperlink = attributes.hyperlink(id);
+        write_u16(result, id);
+        write_string(result, hyperlink.uri);
+        write_string(result, hyperlink.id);
+    }
+
+    write_u16(result, u16(multi_cell_ids.size()));
+    for (auto [id, _] : multi_cell_ids) {
+        auto const& info = attributes.multi_cell_info(id);
+        write_u16(result, id);
+        write_u8(result, info.scale);
+        write_u8(result, info.width);
+        write_u8(result, info.fractional_scale_numerator);
+        write_u8(result, info.fractional_scale_denominator);
+        write_u8(result, info.vertical_alignment);
+        write_u8(result, info.horizontal_alignment);
+    }
+
+    write_u32(result, u32(m_row_count));
+    for (auto value : m_data) {
+        result.push_back(value);
+    }
+    return result;
+}
+
+auto CompressedRows::deserialize(di::Span<byte const> data, AttributeTable& attributes) -> CompressedRows {
+    // Intern every stored attribute, and remember the id it now has. If the attribute table is full, the
+    // attribute is replaced with the default.
+    auto reader = CompressedRowsReader { data };
+    auto graphics_ids = di::TreeMap<u16, u16> {};
+    for (auto _ : di::range(reader.read_u16())) {
+        auto id = reader.read_u16();
+        auto rendition = GraphicsRendition {};
+        rendition.fg = unpack_color(reader.read_u32());
+        rendition.bg = unpack_color(reader.read_u32());
+        rendition.underline_color = unpack_color(reader.read_u32());
+        rendition.font_weight = FontWeight(reader.read_u8());
+        rendition.blink_mode = BlinkMode(reader.read_u8());
+        rendition.underline_mode = UnderlineMode(reader.read_u8());
+        auto flags = reader.read_u8();
+        rendition.italic = flags & 1;
+        rendition.overline = flags & 2;
+        rendition.inverted = flags & 4;
+        rendition.invisible = flags & 8;
+        rendition.strike_through = flags & 16;
+        graphics_ids.insert_or_assign(id, attributes.maybe_allocate_graphics_id(rendition).value_or(0));
+    }
+
+    auto hyperlink_ids = di::TreeMap<u16, u16> {};
+    for (auto _ : di::range(reader.read_u16())) {
+        auto id = reader.read_u16();
+        auto hyperlink = Hyperlink {};
+        hyperlink.uri = reader.read_string();
+        hyperlink.id = reader.read_string();
+        hyperlink_ids.insert_or_assign(id, attributes.maybe_allocate_hyperlink_id(hyperlink).value_or(0));
+    }
+
+    auto multi_cell_ids = di::TreeMap<u16, u16> {};
+    for (auto _ : di::range(reader.read_u16())) {
+        auto id = reader.read_u16();
+        auto info = MultiCellInfo {};
+        info.scale = reader.read_u8();
+        info.width = reader.read_u8();
+        info.fractional_scale_numerator = reader.read_u8();
+        info.fractional_scale_denominator = reader.read_u8();
+        info.vertical_alignment = reader.read_u8();
+        info.horizontal_alignment = reader.read_u8();
+        multi_cell_ids.insert_or_assign(id, attributes.maybe_allocate_multi_cell_id(info).value_or(0));
+    }
+
+    auto result = CompressedRows {};
+    result.m_row_count = reader.read_u32();
+    for (auto value : *data.subspan(reader.offset)) {
+        result.m_data.push_back(value);
+    }
+
+    // Replace the stored ids, and add a reference for every cell in each run. Ids which aren't stored (like the
+    // default attributes) are left as is.
+    auto remap = [&](di::TreeMap<u16, u16> const& ids, usize offset) -> u16 {
+        auto id = read_u16_at(result.m_data.span(), offset);
+        auto new_id = u16(ids.at(id).value_or(id));
+        write_u16_at(result.m_data, offset, new_id);
+        return new_id;
+    };
+    for_each_run(result.m_data.span(), result.m_row_count, [&](usize offset, usize length, bool background_only) {
+        if (!background_only) {
+            auto graphics_id = remap(graphics_ids, offset);
+            auto hyperlink_id = remap(hyperlink_ids, offset + 2);
+            for (auto _ : di::range(length)) {
+                (void) attributes.use_graphics_id(graphics_id);
+                (void) attributes.use_hyperlink_id(hyperlink_id);
+            }
+        }
+        auto multi_cell_id = remap(multi_cell_ids, offset + 4);
+        for (auto _ : di::range(length)) {
+            (void) attributes.use_multi_cell_id(multi_cell_id);
+        }
+    });
+
+    // Every cell now holds its own reference, so release the ones taken when interning the attributes.
+    for (auto [_, id] : graphics_ids) {
+        attributes.drop_graphics_id(id);
+    }
+    for (auto [_, id] : hyperlink_ids) {
+        attributes.drop_hyperlink_id(id);
+    }
+    for (auto [_, id] : multi_cell_ids) {
+        attributes.drop_multi_cell_id(id);
+    }
+    return result;
+}
+
+void CompressedRows::drop_attributes(AttributeTable& attributes) {
+    for_each_run(m_data.span(), m_row_count, [&](usize offset, usize length, bool background_only) {
+        for (auto _ : di::range(length)) {
+            if (!background_only) {
+                auto graphics_id = read_u16_at(m_data.span(), offset);
+                auto hyperlink_id = read_u16_at(m_data.span(), offset + 2);
+                attributes.drop_graphics_id(graphics_id);
+                attributes.drop_hyperlink_id(hyperlink_id);
+            }
+            auto multi_cell_id = read_u16_at(m_data.span(), offset + 4);
+            attributes.drop_multi_cell_id(multi_cell_id);
+        }
+    });
+}
+}
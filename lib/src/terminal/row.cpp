@@ -0,0 +1,91 @@
+#include "ttx/terminal/row.h"
+
+#include "ttx/terminal/cell.h"
+
+namespace ttx::terminal {
+auto Row::cell_text(Cell const& cell) const -> di::StringView {
+    if (cell.has_inline_text()) {
+        return di::StringView(di::encoding::assume_valid, cell.inline_text.data(),
+                              cell.inline_text.data() + cell.text_size);
+    }
+    ASSERT_LT(cell.overflow_text_index, overflow_text.size());
+    return overflow_text[cell.overflow_text_index].view();
+}
+
+void Row::set_cell_text(Cell& cell, di::StringView text) {
+    ASSERT_LT_EQ(text.size_bytes(), Cell::max_text_size);
+
+    if (text.size_bytes() <= Cell::max_inline_text_size) {
+        // Copy the text before releasing any overflow entry, as the text may point into it.
+        auto inline_text = di::Array<c8, Cell::max_inline_text_size> {};
+        di::copy(text.span(), inline_text.data());
+        clear_cell_text(cell);
+        cell.inline_text = inline_text;
+        cell.text_size = text.size_bytes();
+        return;
+    }
+
+    // Reuse the cell's existing overflow entry if possible. The text is copied first, as it may point into the
+    // entry being replaced.
+    auto owned = text.to_owned();
+    if (cell.has_inline_text()) {
+        if (auto index = free_overflow_text.pop_back()) {
+            cell.overflow_text_index = *index;
+        } else {
+            cell.overflow_text_index = u32(overflow_text.size());
+            overflow_text.emplace_back();
+        }
+    }
+    overflow_text[cell.overflow_text_index] = di::move(owned);
+    cell.text_size = text.size_bytes();
+}
+
+void Row::append_cell_text(Cell& cell, c32 code_point) {
+    auto code_units = di::encoding::convert_to_code_units(di::String::Encoding(), code_point);
+    ASSERT_LT_EQ(cell.text_size + code_units.size_bytes(), Cell::max_text_size);
+
+    // Fast path: the result still fits inline.
+    if (cell.text_size + code_units.size_bytes() <= Cell::max_inline_text_size) {
+        for (auto code_unit : code_units) {
+            cell.inline_text[cell.text_size++] = code_unit;
+        }
+        return;
+    }
+
+    if (!cell.has_inline_text()) {
+        auto& text = overflow_text[cell.overflow_text_index];
+        text.push_back(code_point);
+        cell.text_size = text.size_bytes();
+        return;
+    }
+
+    auto text = cell_text(cell).to_owned();
+    text.push_back(code_point);
+    set_cell_text(cell, text.view());
+}
+
+void Row::clear_cell_text(Cell& cell) {
+    if (!cell.has_inline_text()) {
+        overflow_text[cell.overflow_text_index].clear();
+        free_overflow_text.push_back(cell.overflow_text_index);
+    }
+    cell.text_size = 0;
+}
+
+void Row::clear_text() {
+    for (auto& cell : cells) {
+        cell.text_size = 0;
+    }
+    overflow_text.clear();
+    free_overflow_text.clear();
+}
+
+auto Row::storage_bytes() const -> usize {
+    auto result = cells.capacity() * sizeof(Cell) + overflow_text.capacity() * sizeof(di::String) +
+                  free_overflow_text.capacity() * sizeof(u32);
+    for (auto const& text : overflow_text) {
+        result += text.size_bytes();
+    }
+    return result;
+}
+}
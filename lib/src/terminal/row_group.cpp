@@ -27,13 +27,12 @@ auto RowGroup::reflow(u64 absolute_row_start, u32 target_width) -> ReflowResult
                           return a.overflow;
                       })) {
         // Now we just take text from each row in the group greedily to fill new rows satisfying the
-        // new target width. We get to keep the same metadata IDs as the original cells, but the text
-        // offset does change. Each chunk will have at least 1 row.
+        // new target width. We get to keep the same metadata IDs as the original cells, but any text stored
+        // in the row's overflow pool must be moved. Each chunk will have at least 1 row.
         new_rows.emplace_back();
         result.add_offset({ absolute_row_start + original_row_index, 0 }, compute_dr(), 0);
         auto current_width = 0_u32;
         for (auto& row : chunk) {
-            auto text_offset = 0_usize;
             auto [end, _] = di::find_last_if_not(row.cells, &Cell::is_empty);
             auto effective_width = row.cells.end() == end ? 0_usize : usize(end - row.cells.begin() + 1);
             auto need_mapping = false;
@@ -44,7 +43,6 @@ auto RowGroup::reflow(u64 absolute_row_start, u32 target_width) -> ReflowResult
 
                 auto _ = di::ScopeExit([&] {
                     col += width;
-                    text_offset += cell.text_size;
                 });
 
                 // If the target width is smaller than the cell width we actually have to drop this cell. For this case
@@ -87,13 +85,12 @@ auto RowGroup::reflow(u64 absolute_row_start, u32 target_width) -> ReflowResult
                 new_row.cells.append_container(row.cells.subspan(col, width).value());
                 current_width += width;
 
-                // Append the relevant text.
-                auto text_start = row.text.iterator_at_offset(text_offset);
-                auto text_end = row.text.iterator_at_offset(text_offset + cell.text_size);
-                ASSERT(text_start);
-                ASSERT(text_end);
-                auto text = row.text.substr(text_start.value(), text_end.value());
-                new_row.text.append(text);
+                // Inline text was copied with the cell, but overflow text needs to be moved to the new row's pool.
+                if (!cell.has_inline_text()) {
+                    auto& new_cell = new_row.cells[new_row.cells.size() - width];
+                    new_cell.text_size = 0;
+                    new_row.set_cell_text(new_cell, row.cell_text(cell));
+                }
             }
 
             original_row_index++;
@@ -113,55 +110,7 @@ auto RowGroup::reflow(u64 absolute_row_start, u32 target_width) -> ReflowResult
     return result;
 }
 
-auto RowGroup::maybe_allocate_graphics_id(GraphicsRendition const& rendition) -> di::Optional<u16> {
-    auto existing_id = graphics_id(rendition);
-    if (!existing_id) {
-        return allocate_graphics_id(rendition);
-    }
-    return use_graphics_id(existing_id.value());
-}
-
-auto RowGroup::maybe_allocate_hyperlink_id(Hyperlink const& hyperlink) -> di::Optional<u16> {
-    auto existing_id = hyperlink_id(hyperlink.id);
-    if (!existing_id) {
-        return allocate_hyperlink_id(hyperlink.clone());
-    }
-    return use_hyperlink_id(existing_id.value());
-}
-
-auto RowGroup::maybe_allocate_multi_cell_id(MultiCellInfo const& multi_cell_info) -> di::Optional<u16> {
-    auto existing_id = multi_cell_id(multi_cell_info);
-    if (!existing_id) {
-        return allocate_multi_cell_id(multi_cell_info);
-    }
-    return use_multi_cell_id(existing_id.value());
-}
-
-void RowGroup::drop_graphics_id(u16& id) {
-    if (id) {
-        m_graphics_renditions.drop_id(id);
-        id = 0;
-    }
-}
-
-void RowGroup::drop_hyperlink_id(u16& id) {
-    if (id) {
-        m_hyperlinks.drop_id(id);
-        id = 0;
-    }
-}
-
-void RowGroup::drop_multi_cell_id(u16& id) {
-    if (id) {
-        if (id > 1) {
-            m_multi_cell_info.drop_id(id);
-        }
-        id = 0;
-    }
-}
-
 void RowGroup::drop_cell(Cell& cell) {
-    auto was_empty = cell.is_empty();
     if (cell.has_ids()) {
         drop_graphics_id(cell.ids.graphics_rendition_id);
         drop_hyperlink_id(cell.ids.hyperlink_id);
@@ -174,41 +123,20 @@ void RowGroup::drop_cell(Cell& cell) {
     cell.left_boundary_of_multicell = false;
     cell.explicitly_sized = false;
     cell.complex_grapheme_cluster = false;
-    cell.stale = cell.stale && was_empty;
-}
-
-auto RowGroup::graphics_rendition(u16 id) const -> GraphicsRendition const& {
-    if (id == 0) {
-        return m_empty_graphics;
-    }
-    return m_graphics_renditions.lookup_id(id);
-}
-
-auto RowGroup::hyperlink(u16 id) const -> Hyperlink const& {
-    ASSERT_NOT_EQ(id, 0);
-    return m_hyperlinks.lookup_id(id);
 }
 
-auto RowGroup::maybe_hyperlink(u16 id) const -> di::Optional<Hyperlink const&> {
-    if (id == 0) {
-        return {};
-    }
-    return hyperlink(id);
-}
-
-auto RowGroup::multi_cell_info(u16 id) const -> MultiCellInfo const& {
-    if (id == 0) {
-        return narrow_multi_cell_info;
-    }
-    if (id == 1) {
-        return wide_multi_cell_info;
+void RowGroup::drop_all_cells() {
+    for (auto& row : m_rows) {
+        for (auto& cell : row.cells) {
+            drop_cell(cell);
+        }
     }
-    return m_multi_cell_info.lookup_id(id);
 }
 
 auto RowGroup::transfer_from(RowGroup& from, usize from_index, usize to_index, usize row_count,
                              di::Optional<u32> desired_cols) -> usize {
     auto& to = *this;
+    ASSERT_EQ(from.m_attributes, to.m_attributes);
     ASSERT_LT_EQ(from_index + row_count, from.total_rows());
     ASSERT_LT_EQ(to_index, to.total_rows());
 
@@ -226,7 +154,6 @@ auto RowGroup::transfer_from(RowGroup& from, usize from_index, usize to_index, u
     for (auto [from_row, to_row] : di::zip(di::View(from_begin, from_end), di::View(to_begin, to_end))) {
         auto cols_to_take = desired_cols.value_or(from_row.cells.size());
         total_cells += cols_to_take > 0 ? cols_to_take : 1; // Consider empty rows to have 1 cell.
-        to_row.cells.resize(cols_to_take);
 
         // Truncate any wide cells if they won't fully fit into the requested column size.
         auto from_cells_to_take = di::min(cols_to_take, u32(from_row.cells.size()));
@@ -243,42 +170,20 @@ auto RowGroup::transfer_from(RowGroup& from, usize from_index, usize to_index, u
             }
         }
 
-        auto text_size = 0_usize;
-        for (auto [i, cells] : di::zip(from_row.cells | di::take(from_cells_to_take), to_row.cells) | di::enumerate) {
-            // Insert the new cell as desired.
-            auto& [from_cell, to_cell] = cells;
-            if (i < cols_to_take) {
-                to_cell = from_cell;
-                if (from_cell.has_ids()) {
-                    if (from_cell.ids.graphics_rendition_id) {
-                        to_cell.ids.graphics_rendition_id =
-                            to.maybe_allocate_graphics_id(from.graphics_rendition(from_cell.ids.graphics_rendition_id))
-                                .value_or(0);
-                    }
-                    if (from_cell.ids.hyperlink_id) {
-                        to_cell.ids.hyperlink_id =
-                            to.maybe_allocate_hyperlink_id(from.hyperlink(from_cell.ids.hyperlink_id)).value_or(0);
-                    }
-                }
-                if (from_cell.multi_cell_id) {
-                    to_cell.multi_cell_id =
-                        to.maybe_allocate_multi_cell_id(from.multi_cell_info(from_cell.multi_cell_id)).value_or(0);
-                }
-            }
-
-            // Always drop the cell `from` cell. We don't have to worry about clearing the associated text since the
-            // entire row is deleted later.
-            text_size += from_cell.text_size;
+        // Release any truncated cells, including their overflow text so that it isn't carried over.
+        for (auto& from_cell : from_row.cells | di::drop(from_cells_to_take)) {
             from.drop_cell(from_cell);
+            from_row.clear_cell_text(from_cell);
+            from_cell = {};
         }
 
-        // Copy over row attributes (overflow flag and text). Text is moved over to prevent
-        // copying, but has to be truncated if desired cols is smaller than the actual row size.
+        // Since both groups share the same attribute table, the cells can be moved as is. Cells also retain their
+        // indices into the overflow text pool, so it is moved over as well.
+        to_row.cells = di::move(from_row.cells);
+        to_row.cells.resize(cols_to_take);
         to_row.overflow = from_row.overflow;
-        to_row.text = di::move(from_row.text);
-        auto text_end = to_row.text.iterator_at_offset(text_size);
-        ASSERT(text_end);
-        to_row.text.erase(text_end.value(), to_row.text.end());
+        to_row.overflow_text = di::move(from_row.overflow_text);
+        to_row.free_overflow_text = di::move(from_row.free_overflow_text);
     }
 
     // Erase all desired rows in `from`.
@@ -0,0 +1,28 @@
+#include "ttx/terminal/row_pool.h"
+
+namespace ttx::terminal {
+auto RowPool::acquire(u32 cols, Cell const& blank) -> Row {
+    auto row = Row {};
+    if (auto recycled = m_rows.pop_back()) {
+        row = di::move(*recycled);
+    }
+    row.cells.resize(cols, blank);
+    row.set_blank(blank.background_only ? blank.background_color : Color {});
+    return row;
+}
+
+void RowPool::release(Row&& row) {
+    if (m_rows.size() >= max_rows) {
+        return;
+    }
+
+    // Clearing the vectors keeps their capacity, which is what makes reusing the row worthwhile.
+    row.cells.clear();
+    row.overflow_text.clear();
+    row.free_overflow_text.clear();
+    row.overflow = false;
+    row.blank = false;
+    row.mark_all_dirty();
+    m_rows.push_back(di::move(row));
+}
+}
@@ -1,5 +1,6 @@
 #include "ttx/terminal/screen.h"
 
+#include "di/container/algorithm/all_of.h"
 #include "di/container/algorithm/rotate.h"
 #include "di/io/vector_writer.h"
 #include "di/util/clamp.h"
@@ -22,11 +23,51 @@
 #include "ttx/terminal/selection.h"
 
 namespace ttx::terminal {
+static auto is_printable_ascii(c32 code_point) -> bool {
+    return code_point >= 0x20 && code_point < 0x7F;
+}
+
+// Check if a cell references any attributes or text which must be released before overwriting it.
+static auto references_storage(Cell const& cell) -> bool {
+    return cell.graphics_rendition_id() != 0 || cell.hyperlink_id() != 0 || cell.multi_cell_id != 0 ||
+           cell.text_size != 0;
+}
+
+// Check if a cell is identical to the blank cell, in which case clearing it doesn't change anything.
+static auto is_same_blank(Cell const& cell, Cell const& blank) -> bool {
+    if (references_storage(cell) || cell.explicitly_sized || cell.complex_grapheme_cluster ||
+        cell.left_boundary_of_multicell || cell.background_only != blank.background_only) {
+        return false;
+    }
+    return !blank.background_only || cell.background_color == blank.background_color;
+}
+
 Screen::Screen(Size const& size, ScrollBackEnabled scroll_back_enabled)
-    : m_scroll_back_enabled(scroll_back_enabled), m_scroll_region(0, size.rows) {
+    : m_attributes(di::make_box<AttributeTable>())
+    , m_active_rows(*m_attributes)
+    , m_scroll_back(*m_attributes)
+    , m_scroll_back_enabled(scroll_back_enabled)
+    , m_scroll_region(0, size.rows) {
     resize(size);
 }
 
+void Screen::reset(Size const& size) {
+    // Release the attributes referenced by the cursor and every cell, while keeping the rows allocated.
+    set_current_graphics_rendition({});
+    set_current_hyperlink({});
+    clear_scroll_back();
+    m_commands = Commands {};
+    m_selection = {};
+    clear_search();
+    m_origin_mode = OriginMode::Disabled;
+    m_cursor = {};
+    clear();
+
+    m_scroll_region = ScrollRegion(0, max_height());
+    resize(size);
+    invalidate_all();
+}
+
 auto Screen::resize(Size const& size) -> ReflowResult {
     ASSERT_GT(size.rows, 0);
     ASSERT_GT(size.cols, 0);
@@ -34,6 +75,7 @@ auto Screen::resize(Size const& size) -> ReflowResult {
     if (size.cols == max_width() && size.rows == max_height()) {
         return {};
     }
+    m_scroll_back.set_visible_size(size.rows, size.cols);
 
     // Always update the size and clamp the scroll region in bounds.
     auto _ = di::ScopeExit([&] {
@@ -46,6 +88,7 @@ auto Screen::resize(Size const& size) -> ReflowResult {
 
         m_size = size;
         clamp_selection();
+        clamp_search_match();
         clamp_semantic_prompts();
     });
 
@@ -97,22 +140,20 @@ auto Screen::resize(Size const& size) -> ReflowResult {
     for (auto& row : rows()) {
         // When expanding, just add blank cells.
         if (row.cells.size() <= size.cols) {
+            if (!row.is_blank(m_current_background_color)) {
+                row.blank = false;
+            }
             row.cells.resize(size.cols, blank_cell());
             continue;
         }
 
         // When contracting, we need to free resources used by each cell we're deleting.
-        auto text_bytes_to_delete = 0zu;
         while (row.cells.size() > size.cols) {
-            auto cell = *row.cells.pop_back();
+            auto& cell = row.cells.back().value();
             m_active_rows.drop_cell(cell);
-
-            text_bytes_to_delete += cell.text_size;
+            row.clear_cell_text(cell);
+            row.cells.pop_back();
         }
-
-        auto text_end = row.text.iterator_at_offset(row.text.size_bytes() - text_bytes_to_delete);
-        ASSERT(text_end);
-        row.text.erase(text_end.value(), row.text.end());
     }
 
     // Now either add new rows or move existing rows to the scroll back.
@@ -159,9 +200,8 @@ auto Screen::resize(Size const& size) -> ReflowResult {
             for (auto& row : rows_to_delete) {
                 for (auto& cell : row.cells) {
                     m_active_rows.drop_cell(cell);
-                    cell.text_size = 0;
                 }
-                row.text.clear();
+                row.clear_text();
                 row.overflow = false;
             }
             rows().erase(rows().begin(), rows().end() - size.rows);
@@ -187,6 +227,7 @@ auto Screen::resize(Size const& size) -> ReflowResult {
         for (auto _ : di::range(size.rows - rows().size())) {
             auto row = Row {};
             row.cells.resize(size.cols, blank_cell());
+            row.set_blank(m_current_background_color);
             rows().push_back(di::move(row));
         }
     }
@@ -196,13 +237,6 @@ auto Screen::resize(Size const& size) -> ReflowResult {
     m_cursor.row = di::min(m_cursor.row, size.rows - 1);
     m_cursor.col = di::min(m_cursor.col, size.cols - 1);
 
-    // Recompute the cursor text offset.
-    auto& row_object = rows()[m_cursor.row];
-    m_cursor.text_offset = 0;
-    for (auto const& cell : row_object.cells | di::take(m_cursor.col)) {
-        m_cursor.text_offset += cell.text_size;
-    }
-
     // When resizing, just invalidate everything. Resize happens when
     // the layout changes and the caller expects us to redraw everything.
     invalidate_all();
@@ -243,7 +277,9 @@ void Screen::set_current_graphics_rendition(GraphicsRendition const& rendition)
 
     m_active_rows.drop_graphics_id(m_graphics_id);
 
-    auto new_id = m_active_rows.allocate_graphics_id(rendition);
+    auto new_id = allocate_attribute_id([&] {
+        return m_active_rows.allocate_graphics_id(rendition);
+    });
     if (!new_id) {
         m_graphics_id = 0;
         return;
@@ -271,7 +307,9 @@ void Screen::set_current_hyperlink(di::Optional<Hyperlink const&> hyperlink) {
 
     m_active_rows.drop_hyperlink_id(m_hyperlink_id);
 
-    auto new_id = m_active_rows.allocate_hyperlink_id(hyperlink.value().clone());
+    auto new_id = allocate_attribute_id([&] {
+        return m_active_rows.allocate_hyperlink_id(hyperlink.value().clone());
+    });
     if (!new_id) {
         m_hyperlink_id = 0;
         return;
@@ -336,13 +374,6 @@ void Screen::set_cursor(u32 row, u32 col) {
 
     m_cursor.row = row;
     m_cursor.col = col;
-    m_cursor.text_offset = 0;
-
-    // Compute the text offset from the beginning of the row.
-    auto& row_object = rows()[row];
-    for (auto const& cell : row_object.cells | di::take(col)) {
-        m_cursor.text_offset += cell.text_size;
-    }
 }
 
 void Screen::set_cursor_row_relative(u32 row) {
@@ -363,30 +394,7 @@ void Screen::set_cursor_col(u32 col) {
     // Setting the cursor always clears the overflow pending flag.
     m_cursor.overflow_pending = false;
 
-    col = di::clamp(translate_col(col), min_col(), max_col_inclusive());
-    if (m_cursor.col == col) {
-        return;
-    }
-
-    // Special case when moving to column 0.
-    if (col == 0) {
-        m_cursor.text_offset = 0;
-        m_cursor.col = 0;
-        return;
-    }
-
-    // Compute the text offset relative the current cursor.
-    auto& row = rows()[m_cursor.row];
-    if (m_cursor.col < col) {
-        for (auto const& cell : row.cells | di::drop(m_cursor.col) | di::take(col - m_cursor.col)) {
-            m_cursor.text_offset += cell.text_size;
-        }
-    } else {
-        for (auto const& cell : row.cells | di::drop(col) | di::take(m_cursor.col - col)) {
-            m_cursor.text_offset -= cell.text_size;
-        }
-    }
-    m_cursor.col = col;
+    m_cursor.col = di::clamp(translate_col(col), min_col(), max_col_inclusive());
 }
 
 void Screen::insert_blank_characters(u32 count) {
@@ -403,18 +411,8 @@ void Screen::insert_blank_characters(u32 count) {
             m_active_rows.drop_cell(row.cells[erase_position]);
             erase_position--;
         }
-
-        auto& primary_cell = row.cells[erase_position];
-        clear_cell(primary_cell);
-
-        auto erase_text_start = row.text.iterator_at_offset(m_cursor.text_offset - primary_cell.text_size);
-        ASSERT(erase_text_start);
-        auto erase_text_end = row.text.iterator_at_offset(m_cursor.text_offset);
-        ASSERT(erase_text_end);
-        row.text.erase(erase_text_start.value(), erase_text_end.value());
-
-        m_cursor.text_offset -= primary_cell.text_size;
-        primary_cell.text_size = 0;
+        clear_cells(row, erase_position, erase_position + 1);
+        row.mark_dirty(erase_position, m_cursor.col);
     }
 
     // Drop the correct number of cells, based on how many new ones we need
@@ -426,27 +424,14 @@ void Screen::insert_blank_characters(u32 count) {
             deletion_point--;
         }
     }
-    auto text_start_position = row.text.size_bytes();
-    for (auto& cell : auto(*row.cells.subspan(deletion_point))) {
-        clear_cell(cell);
-        text_start_position -= cell.text_size;
-        cell.text_size = 0;
-    }
+    clear_cells(row, deletion_point, row.cells.size());
     row.cells.erase(row.cells.end() - max_to_insert, row.cells.end());
 
-    // Erase the text of the deleted cells.
-    auto text_start = row.text.iterator_at_offset(text_start_position);
-    ASSERT(text_start);
-    row.text.erase(text_start.value(), row.text.end());
-
     // Mark any cells which have moved as dirty.
-    for (auto& cell : row.cells | di::drop(m_cursor.col)) {
-        cell.stale = false;
-    }
+    row.mark_dirty(m_cursor.col, max_width());
 
     // Finally, insert the blank cells. Note that to implement bce this would need to
-    // preserve the background color. The cursor position is unchanged, as is
-    // the cursor byte offset.
+    // preserve the background color. The cursor position is unchanged.
     row.cells.insert_container(row.cells.begin() + m_cursor.col, di::repeat(blank_cell(), max_to_insert));
     row.overflow = false;
 }
@@ -463,11 +448,7 @@ void Screen::insert_blank_lines(u32 count) {
     auto delete_row_it = end_row_iterator() - max_to_insert;
     for (auto it = delete_row_it; it != end_row_iterator(); ++it) {
         auto& row = *it;
-        for (auto& cell : row.cells) {
-            clear_cell(cell);
-            cell.text_size = 0;
-        }
-        row.text.clear();
+        clear_cells(row, 0, row.cells.size());
         row.overflow = false;
     }
 
@@ -475,7 +456,6 @@ void Screen::insert_blank_lines(u32 count) {
     di::rotate(rows().begin() + m_cursor.row, delete_row_it, end_row_iterator());
 
     // Now set the cursor to the left margin.
-    m_cursor.text_offset = 0;
     m_cursor.col = 0;
 
     // Invalidate all moved rows as necessary.
@@ -483,7 +463,7 @@ void Screen::insert_blank_lines(u32 count) {
         invalidate_all();
     } else {
         for (auto& row : di::View(rows().begin() + m_cursor.row, end_row_iterator())) {
-            row.stale = false;
+            row.mark_all_dirty();
         }
     }
 }
@@ -501,41 +481,19 @@ void Screen::delete_characters(u32 count) {
             deletion_point--;
         }
     }
-    auto text_start_position = m_cursor.text_offset;
-    if (deletion_point < m_cursor.col) {
-        for (auto& cell : auto(*row.cells.subspan(deletion_point, m_cursor.col - deletion_point))) {
-            text_start_position -= cell.text_size;
-        }
-    }
     auto deletion_end = m_cursor.col + max_to_delete;
     while (deletion_end < max_width() && row.cells[deletion_end].is_nonprimary_in_multi_cell()) {
         deletion_end++;
     }
-    auto text_end_position = text_start_position;
-    for (auto& cell : auto(*row.cells.subspan(deletion_point, deletion_end - deletion_point))) {
-        clear_cell(cell);
-        text_end_position += cell.text_size;
-        cell.text_size = 0;
-    }
+    clear_cells(row, deletion_point, deletion_end);
     row.cells.erase(row.cells.begin() + m_cursor.col, row.cells.begin() + m_cursor.col + max_to_delete);
 
-    // Erase the text of the deleted cells.
-    auto text_start = row.text.iterator_at_offset(text_start_position);
-    auto text_end = row.text.iterator_at_offset(text_end_position);
-    ASSERT(text_start);
-    ASSERT(text_end);
-    row.text.erase(text_start.value(), text_end.value());
-
     // Mark any cells which have moved as dirty.
-    for (auto& cell : row.cells | di::drop(m_cursor.col)) {
-        cell.stale = false;
-    }
+    row.mark_dirty(m_cursor.col, max_width());
 
-    // Insert blank cells at the end of the row. The cursor position is unchanged, as is the cursor byte offset.
+    // Insert blank cells at the end of the row. The cursor position is unchanged.
     row.cells.resize(max_width(), blank_cell());
     row.overflow = false;
-
-    m_cursor.text_offset = text_start_position;
 }
 
 void Screen::delete_lines(u32 count) {
@@ -547,15 +505,21 @@ void Screen::delete_lines(u32 count) {
     // Start by dropping the correct number of rows. We're clearing starting from
     // the cursor row.
     auto max_to_delete = di::min(count, m_scroll_region.end_row - m_cursor.row);
+
+    // When deleting from the top of the screen, no rows remain above the deleted rows, so
+    // the rows can be moved without rotating the whole screen.
+    if (m_cursor.row == 0 && m_scroll_region == ScrollRegion(0, max_height())) {
+        recycle_rows_to_bottom(max_to_delete);
+        m_cursor.col = 0;
+        invalidate_all();
+        return;
+    }
+
     auto delete_row_it = rows().begin() + m_cursor.row;
     auto delete_row_end = di::next(delete_row_it, max_to_delete, rows().end());
     for (auto it = delete_row_it; it != delete_row_end; ++it) {
         auto& row = *it;
-        for (auto& cell : row.cells) {
-            clear_cell(cell);
-            cell.text_size = 0;
-        }
-        row.text.clear();
+        clear_cells(row, 0, row.cells.size());
         row.overflow = false;
     }
 
@@ -563,7 +527,6 @@ void Screen::delete_lines(u32 count) {
     di::rotate(delete_row_it, delete_row_end, end_row_iterator());
 
     // Now set the cursor to the left margin.
-    m_cursor.text_offset = 0;
     m_cursor.col = 0;
 
     // Invalidate all moved rows as necessary.
@@ -571,7 +534,7 @@ void Screen::delete_lines(u32 count) {
         invalidate_all();
     } else {
         for (auto& row : di::View(delete_row_it, end_row_iterator())) {
-            row.stale = false;
+            row.mark_all_dirty();
         }
     }
 }
@@ -580,16 +543,9 @@ void Screen::clear() {
     m_cursor.overflow_pending = false;
 
     for (auto& row : rows()) {
-        for (auto& cell : row.cells) {
-            clear_cell(cell);
-            cell.text_size = 0;
-        }
-        row.text.clear();
+        clear_cells(row, 0, row.cells.size());
         row.overflow = false;
     }
-
-    // After clearing, there is no text.
-    m_cursor.text_offset = 0;
 }
 
 void Screen::clear_after_cursor() {
@@ -599,11 +555,7 @@ void Screen::clear_after_cursor() {
 
     // Now we just need to delete all lines below the cursor.
     for (auto& row : rows() | di::drop(m_cursor.row + 1)) {
-        for (auto& cell : row.cells) {
-            clear_cell(cell);
-            cell.text_size = 0;
-        }
-        row.text.clear();
+        clear_cells(row, 0, row.cells.size());
         row.overflow = false;
     }
 }
@@ -621,11 +573,7 @@ void Screen::clear_before_cursor() {
     // the rows here because rows are always assumed to start at the top
     // of the screen.
     for (auto& row : rows() | di::take(m_cursor.row)) {
-        for (auto& cell : row.cells) {
-            clear_cell(cell);
-            cell.text_size = 0;
-        }
-        row.text.clear();
+        clear_cells(row, 0, row.cells.size());
         row.overflow = false;
     }
 }
@@ -634,49 +582,22 @@ void Screen::clear_row() {
     m_cursor.overflow_pending = false;
 
     auto& row = rows()[m_cursor.row];
-    for (auto& cell : row.cells) {
-        clear_cell(cell);
-        cell.text_size = 0;
-    }
-    row.text.clear();
+    clear_cells(row, 0, row.cells.size());
     row.overflow = false;
-
-    // We deleted all the text on the cursor's row.
-    m_cursor.text_offset = 0;
 }
 
 void Screen::clear_row_after_cursor() {
     m_cursor.overflow_pending = false;
 
     auto& row = rows()[m_cursor.row];
-    auto text_size_to_delete = 0zu;
     auto deletion_point = m_cursor.col;
     if (row.cells[deletion_point].is_nonprimary_in_multi_cell()) {
         while (!row.cells[deletion_point].is_primary_in_multi_cell()) {
             deletion_point--;
         }
     }
-    auto text_start_position = m_cursor.text_offset;
-    if (deletion_point < m_cursor.col) {
-        for (auto& cell : auto(*row.cells.subspan(deletion_point, m_cursor.col - deletion_point))) {
-            text_start_position -= cell.text_size;
-        }
-    }
-    for (auto& cell : row.cells | di::drop(deletion_point)) {
-        clear_cell(cell);
-        text_size_to_delete += cell.text_size;
-        cell.text_size = 0;
-    }
+    clear_cells(row, deletion_point, row.cells.size());
     row.overflow = false;
-
-    // Delete text after the cursor.
-    auto text_start = row.text.iterator_at_offset(text_start_position);
-    auto text_end = row.text.iterator_at_offset(text_start_position + text_size_to_delete);
-    ASSERT(text_start);
-    ASSERT(text_end);
-    row.text.erase(text_start.value(), text_end.value());
-
-    m_cursor.text_offset = text_start_position;
 }
 
 void Screen::clear_row_before_cursor() {
@@ -687,20 +608,7 @@ void Screen::clear_row_before_cursor() {
     while (deletion_end < row.cells.size() && row.cells[deletion_end].is_nonprimary_in_multi_cell()) {
         deletion_end++;
     }
-    auto text_size_to_delete = 0zu;
-    for (auto& cell : row.cells | di::take(deletion_end)) {
-        clear_cell(cell);
-        text_size_to_delete += cell.text_size;
-        cell.text_size = 0;
-    }
-
-    // Delete all text before the cursor.
-    auto text_end = row.text.iterator_at_offset(text_size_to_delete);
-    ASSERT(text_end);
-    row.text.erase(row.text.begin(), text_end.value());
-
-    // We deleted all the text before the cursor.
-    m_cursor.text_offset = 0;
+    clear_cells(row, 0, deletion_end);
 }
 
 void Screen::erase_characters(u32 n) {
@@ -714,49 +622,40 @@ void Screen::erase_characters(u32 n) {
             deletion_point--;
         }
     }
-    auto text_start_position = m_cursor.text_offset;
-    if (deletion_point < m_cursor.col) {
-        for (auto& cell : auto(*row.cells.subspan(deletion_point, m_cursor.col - deletion_point))) {
-            text_start_position -= cell.text_size;
-        }
-    }
     auto deletion_end = di::min(insertion_point + n, u32(row.cells.size()));
     while (deletion_end < max_width() && row.cells[deletion_end].is_nonprimary_in_multi_cell()) {
         deletion_end++;
     }
-    auto text_end_position = text_start_position;
-    for (auto& cell : auto(*row.cells.subspan(deletion_point, deletion_end - deletion_point))) {
-        clear_cell(cell);
-        text_end_position += cell.text_size;
-        cell.text_size = 0;
-    }
-
-    // Delete text after the cursor.
-    auto text_start = row.text.iterator_at_offset(text_start_position);
-    auto text_end = row.text.iterator_at_offset(text_end_position);
-    ASSERT(text_start);
-    ASSERT(text_end);
-    row.text.erase(text_start.value(), text_end.value());
+    clear_cells(row, deletion_point, deletion_end);
 
     // Clear row overflow flag if text after the cursor is fully deleted.
-    if (text_end.value() == row.text.end()) {
+    if (di::all_of(row.cells | di::drop(deletion_end), [](Cell const& cell) {
+            return cell.text_size == 0;
+        })) {
         row.overflow = false;
     }
-
-    m_cursor.text_offset = text_start_position;
 }
 
-void Screen::scroll_down() {
+void Screen::scroll_down(u32 count) {
     ASSERT_EQ(m_cursor.row + 1, m_scroll_region.end_row);
 
-    // Clear the first row, optionally putting it into the scroll back buffer.
+    count = di::min(count, m_scroll_region.end_row - m_scroll_region.start_row);
+    if (count == 0) {
+        return;
+    }
+
+    // Clear the first rows, optionally putting them into the scroll back buffer.
     if (m_scroll_back_enabled == ScrollBackEnabled::Yes) {
         auto was_at_bottom = visual_scroll_at_bottom();
-        m_scroll_back.add_rows(m_active_rows, m_scroll_region.start_row, 1);
+        m_scroll_back.add_rows(m_active_rows, m_scroll_region.start_row, count);
 
-        // Insert the new row.
-        auto row = m_active_rows.rows().emplace(m_active_rows.rows().iterator(m_scroll_region.end_row - 1));
-        row->cells.resize(max_width(), blank_cell());
+        // Insert the new rows, reusing the storage of rows discarded from the scroll back if possible.
+        auto blank = blank_cell();
+        m_active_rows.rows().insert_container(
+            m_active_rows.rows().iterator(m_scroll_region.end_row - count),
+            di::range(count) | di::transform([&](auto) {
+                return m_scroll_back.row_pool().acquire(max_width(), blank);
+            }));
 
         if (was_at_bottom) {
             // Automatically scroll to the bottom if the screen isn't already scrolled.
@@ -766,31 +665,42 @@ void Screen::scroll_down() {
             m_visual_scroll_offset = absolute_row_start();
         }
         clamp_selection();
+        clamp_search_match();
         clamp_semantic_prompts();
+    } else if (m_scroll_region == ScrollRegion(0, max_height())) {
+        recycle_rows_to_bottom(count);
     } else {
-        auto& row = *begin_row_iterator();
-        for (auto& cell : row.cells) {
-            clear_cell(cell);
-            cell.text_size = 0;
+        for (auto& row : di::View(begin_row_iterator(), begin_row_iterator() + count)) {
+            clear_cells(row, 0, row.cells.size());
+            row.overflow = false;
         }
-        row.text.clear();
-        row.overflow = false;
 
         // Rotate rows into place.
-        di::rotate(begin_row_iterator(), begin_row_iterator() + 1, end_row_iterator());
+        di::rotate(begin_row_iterator(), begin_row_iterator() + count, end_row_iterator());
     }
 
-    m_cursor.text_offset = 0;
     m_cursor.overflow_pending = false;
     invalidate_all();
 }
 
+void Screen::recycle_rows_to_bottom(u32 count) {
+    ASSERT_EQ(m_scroll_region, ScrollRegion(0, max_height()));
+    ASSERT_LT_EQ(count, max_height());
+
+    for (auto _ : di::range(count)) {
+        auto row = *rows().pop_front();
+        clear_cells(row, 0, row.cells.size());
+        row.overflow = false;
+        rows().push_back(di::move(row));
+    }
+}
+
 void Screen::put_code_point(c32 code_point, AutoWrapMode auto_wrap_mode) {
     // 1. Measure the width of the code point.
     auto width = dius::unicode::code_point_width(code_point).value_or(0);
 
     // 2. Determine the previous cell.
-    auto prev_cell = di::Optional<di::Tuple<Row&, Cell&, usize, u8, u32, u32>> {};
+    auto prev_cell = di::Optional<di::Tuple<Row&, Cell&, u8, u32, u32>> {};
     if (m_cursor.row > 0 && m_cursor.col == 0) {
         auto& row = rows()[m_cursor.row - 1];
         auto width = 1_u8;
@@ -799,8 +709,7 @@ void Screen::put_code_point(c32 code_point, AutoWrapMode auto_wrap_mode) {
             candidate_position--;
             width++;
         }
-        auto& cell = row.cells[candidate_position];
-        prev_cell = { row, cell, row.text.size_bytes() - cell.text_size, width, m_cursor.row - 1, candidate_position };
+        prev_cell = { row, row.cells[candidate_position], width, m_cursor.row - 1, candidate_position };
     } else if (m_cursor.col > 0) {
         auto& row = rows()[m_cursor.row];
         auto width = 1_u8;
@@ -809,12 +718,7 @@ void Screen::put_code_point(c32 code_point, AutoWrapMode auto_wrap_mode) {
             candidate_position--;
             width++;
         }
-        auto& cell = row.cells[candidate_position];
-        if (candidate_position == m_cursor.col) {
-            prev_cell = { row, cell, m_cursor.text_offset, width, m_cursor.row, candidate_position };
-        } else {
-            prev_cell = { row, cell, m_cursor.text_offset - cell.text_size, width, m_cursor.row, candidate_position };
-        }
+        prev_cell = { row, row.cells[candidate_position], width, m_cursor.row, candidate_position };
     }
 
     // 3. Combining path - width is 0, so potentially add the
@@ -838,7 +742,7 @@ void Screen::put_code_point(c32 code_point, AutoWrapMode auto_wrap_mode) {
         }
 
         // Now, we're safe to add the 0 width character to the cell's text.
-        auto [row, primary_cell, text_offset, width, r, c] = prev_cell.value();
+        auto [row, primary_cell, width, r, c] = prev_cell.value();
         if (primary_cell.text_size + code_units.size_bytes() > Cell::max_text_size) {
             return;
         }
@@ -847,8 +751,6 @@ void Screen::put_code_point(c32 code_point, AutoWrapMode auto_wrap_mode) {
         // results in explicitly sizing the text, but may cause cells to
         // shrink if terminals to implement that part of the kitty text sizing
         // spec.
-        auto it = row.text.iterator_at_offset(text_offset + primary_cell.text_size);
-        ASSERT(it);
         if (code_point == dius::unicode::VariationSelector_15) {
             primary_cell.explicitly_sized = true;
         }
@@ -856,20 +758,17 @@ void Screen::put_code_point(c32 code_point, AutoWrapMode auto_wrap_mode) {
             // For variation selector 16, if the previous character
             // was an emoji and the cell isn't already a wide cell,
             // the cell's width is promoted to have width 2.
-            auto prev = *di::prev(it.value());
-            if (width == 1 && !primary_cell.explicitly_sized &&
-                dius::unicode::emoji(prev) == dius::unicode::Emoji::Yes) {
+            auto prev = row.cell_text(primary_cell).back();
+            if (width == 1 && !primary_cell.explicitly_sized && prev &&
+                dius::unicode::emoji(*prev) == dius::unicode::Emoji::Yes) {
                 // In this case, we need to increase the cell width to 2. This
                 // is especially annoying when this would cause the current cell
                 // to wrap. To implement this cleanly, we fetch the full attributes
                 // and call put_cell() directly, after first clearing the current
                 // cell.
-                auto text_start = row.text.iterator_at_offset(text_offset);
-                ASSERT(text_start);
-                auto new_text = di::StringView(text_start.value(), it.value()).to_owned();
+                auto new_text = row.cell_text(primary_cell).to_owned();
                 new_text.push_back(code_point);
-                row.text.erase(text_start.value(), it.value());
-                primary_cell.text_size = 0;
+                row.clear_cell_text(primary_cell);
 
                 // We know our goal is to call put_cell(), but that function requires
                 // the current graphics attributes and hyperlink value are correct. So
@@ -894,19 +793,14 @@ void Screen::put_code_point(c32 code_point, AutoWrapMode auto_wrap_mode) {
                 m_active_rows.drop_cell(primary_cell);
                 m_cursor.row = r;
                 m_cursor.col = c;
-                m_cursor.text_offset = text_offset;
                 put_cell(new_text.view(), info, auto_wrap_mode, true, false);
                 return;
             }
         }
 
-        auto [s, e] = row.text.insert(it.value(), code_point);
-        auto byte_size = e.data() - s.data();
-        if (m_cursor.col > 0 && c < m_cursor.col) {
-            m_cursor.text_offset += byte_size;
-        }
-        primary_cell.text_size += byte_size;
-        primary_cell.stale = false;
+        row.append_cell_text(primary_cell, code_point);
+        row.blank = false;
+        row.mark_dirty(c);
         return;
     }
 
@@ -922,12 +816,8 @@ void Screen::put_code_point(c32 code_point, AutoWrapMode auto_wrap_mode) {
     //    This state could also be used to enable the ASCII optimization for 2 subsequent ASCII characters.
     if (prev_cell) {
         auto clusterer = dius::unicode::GraphemeClusterer {};
-        auto [row, primary_cell, text_offset, _, _, prev_col] = prev_cell.value();
-        auto text_start = row.text.iterator_at_offset(text_offset);
-        auto text_end = row.text.iterator_at_offset(text_offset + primary_cell.text_size);
-        ASSERT(text_start);
-        ASSERT(text_end);
-        auto text = row.text.substr(text_start.value(), text_end.value());
+        auto [row, primary_cell, _, _, col] = prev_cell.value();
+        auto text = row.cell_text(primary_cell);
         for (auto ch : text) {
             clusterer.is_boundary(ch);
         }
@@ -936,14 +826,10 @@ void Screen::put_code_point(c32 code_point, AutoWrapMode auto_wrap_mode) {
             if (text.size_bytes() + code_units.size_bytes() > Cell::max_text_size) {
                 return;
             }
-            auto [s, e] = row.text.insert(text_end.value(), code_point);
-            auto byte_size = e.data() - s.data();
-            if (m_cursor.col > 0 && prev_col < m_cursor.col) {
-                m_cursor.text_offset += byte_size;
-            }
-            primary_cell.text_size += byte_size;
+            row.append_cell_text(primary_cell, code_point);
             primary_cell.complex_grapheme_cluster = true;
-            primary_cell.stale = false;
+            row.blank = false;
+            row.mark_dirty(col);
             return;
         }
     }
@@ -961,6 +847,49 @@ void Screen::put_code_point(c32 code_point, AutoWrapMode auto_wrap_mode) {
     put_wide_cell(view, terminal::wide_multi_cell_info, auto_wrap_mode, false, false);
 }
 
+void Screen::put_text_run(di::StringView text, AutoWrapMode auto_wrap_mode) {
+    for (auto it = text.begin(); it != text.end();) {
+        // The first code point always goes through the general path, because it may combine with the
+        // previous cell (for example, if the previous cell ends with a code point in the Prepend class).
+        auto code_point = *it;
+        ++it;
+        put_code_point(code_point, auto_wrap_mode);
+        if (!is_printable_ascii(code_point)) {
+            continue;
+        }
+
+        // A printable ASCII code point following another printable ASCII code point is always a grapheme
+        // cluster boundary and always has width 1. This lets us skip grapheme clustering entirely, and
+        // write the whole sequence into the row at once.
+        auto ascii_end = it;
+        while (ascii_end != text.end() && is_printable_ascii(*ascii_end)) {
+            ++ascii_end;
+        }
+        if (it != ascii_end) {
+            put_ascii_cells(di::StringView(it, ascii_end), auto_wrap_mode);
+            it = ascii_end;
+        }
+    }
+}
+
+void Screen::put_repeated_code_point(c32 code_point, u32 count, AutoWrapMode auto_wrap_mode) {
+    if (!is_printable_ascii(code_point)) {
+        for (auto _ : di::range(count)) {
+            put_code_point(code_point, auto_wrap_mode);
+        }
+        return;
+    }
+
+    // Printable ASCII goes through the text run path, which fills each row's span of cells at once. The text
+    // is generated in chunks of at most one row, so that large counts don't need a large buffer.
+    auto chunk = di::repeat(code_point, di::min(count, max_width())) | di::to<di::String>();
+    while (count > 0) {
+        auto chunk_size = di::min(count, max_width());
+        put_text_run(di::StringView(chunk.begin(), di::next(chunk.begin(), chunk_size)), auto_wrap_mode);
+        count -= chunk_size;
+    }
+}
+
 void Screen::put_osc66(OSC66 const& sized_text, AutoWrapMode auto_wrap_mode) {
     // 1. Scale>0 (multi-height cell). For now we don't support this.
     if (sized_text.info.scale > 1) {
@@ -1061,7 +990,7 @@ void Screen::put_single_cell(di::StringView text, MultiCellInfo const& multi_cel
         // Mark the current row as having overflowed, and then advance the cursor.
         row.overflow = true;
 
-        auto new_cursor = Cursor { m_cursor.row + 1, 0, 0, false };
+        auto new_cursor = Cursor { m_cursor.row + 1, 0, false };
         if (m_cursor.row + 1 == m_scroll_region.end_row) {
             // This was the last line - so induce scrolling by adding a new row.
             scroll_down();
@@ -1075,7 +1004,9 @@ void Screen::put_single_cell(di::StringView text, MultiCellInfo const& multi_cel
 
     // Try to the allocate the multi cell info. This is required, and so we bail if
     // this fails.
-    auto multi_cell_id = m_active_rows.maybe_allocate_multi_cell_id(multi_cell_info);
+    auto multi_cell_id = allocate_attribute_id([&] {
+        return m_active_rows.maybe_allocate_multi_cell_id(multi_cell_info);
+    });
     if (!multi_cell_id.has_value()) {
         return;
     }
@@ -1084,20 +1015,15 @@ void Screen::put_single_cell(di::StringView text, MultiCellInfo const& multi_cel
     // deletion of cells to account for a potential multi cell already partially occuppying the
     // new multi cell.
     auto insertion_point = m_cursor.col;
-    auto text_start_position = m_cursor.text_offset;
     auto& cell = row.cells[insertion_point];
     if (cell.has_ids() && cell.ids.graphics_rendition_id == m_graphics_id && cell.ids.hyperlink_id == m_hyperlink_id &&
         cell.multi_cell_id == multi_cell_id) {
         // Since everything else matches, we only need to update potentially the text.
-        auto text_start = row.text.iterator_at_offset(m_cursor.text_offset);
-        auto text_end = row.text.iterator_at_offset(m_cursor.text_offset + cell.text_size);
-        ASSERT(text_start.has_value());
-        ASSERT(text_end.has_value());
-        if (row.text.substr(text_start.value(), text_end.value()) != text) {
-            row.text.replace(text_start.value(), text_end.value(), text);
-            cell.stale = false;
-        }
-        cell.text_size = text.size_bytes();
+        if (row.cell_text(cell) != text) {
+            row.set_cell_text(cell, text);
+            row.blank = false;
+            row.mark_dirty(insertion_point);
+        }
         cell.explicitly_sized = explicitly_sized;
         cell.complex_grapheme_cluster = complex_grapheme_cluster;
         m_active_rows.drop_multi_cell_id(multi_cell_id.value());
@@ -1108,21 +1034,11 @@ void Screen::put_single_cell(di::StringView text, MultiCellInfo const& multi_cel
                 deletion_point--;
             }
         }
-        if (deletion_point < m_cursor.col) {
-            for (auto& cell : auto(*row.cells.subspan(deletion_point, m_cursor.col - deletion_point))) {
-                text_start_position -= cell.text_size;
-            }
-        }
         auto deletion_end = insertion_point + 1;
         while (deletion_end < max_width() && row.cells[deletion_end].is_nonprimary_in_multi_cell()) {
             deletion_end++;
         }
-        auto text_end_position = text_start_position;
-        for (auto& cell : auto(*row.cells.subspan(deletion_point, deletion_end - deletion_point))) {
-            clear_cell(cell);
-            text_end_position += cell.text_size;
-            cell.text_size = 0;
-        }
+        clear_cells(row, deletion_point, deletion_end);
 
         // Modify the cell with the new attributes, starting by clearing the old attributes.
         if (m_graphics_id) {
@@ -1142,29 +1058,18 @@ void Screen::put_single_cell(di::StringView text, MultiCellInfo const& multi_cel
         cell.explicitly_sized = explicitly_sized;
         cell.complex_grapheme_cluster = complex_grapheme_cluster;
         cell.background_only = false;
-        cell.stale = false;
+        row.blank = false;
+        row.mark_dirty(insertion_point);
 
-        // Insert the text. We can safely assert the iterator is valid because we compute the text offset in all cases
-        // and it should be correct. Additionally, because each cell contains valid UTF-8 text, the cell boundaries
-        // will always be valid insertion points.
-        auto text_start = row.text.iterator_at_offset(text_start_position);
-        auto text_end = row.text.iterator_at_offset(text_end_position);
-        ASSERT(text_start.has_value());
-        ASSERT(text_end.has_value());
-        row.text.replace(text_start.value(), text_end.value(), text);
-        cell.text_size = text.size_bytes();
+        row.set_cell_text(cell, text);
     }
 
     // Advance the cursor 1 cell.
-    auto new_cursor = m_cursor;
-    if (new_cursor.col + 1 == max_width()) {
-        new_cursor.overflow_pending = true;
-        new_cursor.text_offset = text_start_position;
+    if (m_cursor.col + 1 == max_width()) {
+        m_cursor.overflow_pending = true;
     } else {
-        new_cursor.col++;
-        new_cursor.text_offset = text_start_position + text.size_bytes();
+        m_cursor.col++;
     }
-    m_cursor = new_cursor;
 }
 
 void Screen::put_wide_cell(di::StringView text, MultiCellInfo const& multi_cell_info, AutoWrapMode auto_wrap_mode,
@@ -1197,7 +1102,7 @@ void Screen::put_wide_cell(di::StringView text, MultiCellInfo const& multi_cell_
             // Mark the current row as having overflowed, and then advance the cursor.
             row.overflow = true;
 
-            auto new_cursor = Cursor { m_cursor.row + 1, 0, 0, false };
+            auto new_cursor = Cursor { m_cursor.row + 1, 0, false };
             if (m_cursor.row + 1 == m_scroll_region.end_row) {
                 // This was the last line - so induce scrolling by adding a new row.
                 scroll_down();
@@ -1212,7 +1117,9 @@ void Screen::put_wide_cell(di::StringView text, MultiCellInfo const& multi_cell_
 
     // Try to the allocate the multi cell info. This is required, and so we bail if
     // this fails.
-    auto multi_cell_id = m_active_rows.maybe_allocate_multi_cell_id(multi_cell_info);
+    auto multi_cell_id = allocate_attribute_id([&] {
+        return m_active_rows.maybe_allocate_multi_cell_id(multi_cell_info);
+    });
     if (!multi_cell_id.has_value()) {
         return;
     }
@@ -1221,7 +1128,6 @@ void Screen::put_wide_cell(di::StringView text, MultiCellInfo const& multi_cell_
     // end of the line.
     ASSERT_LT_EQ(m_cursor.col, max_width() - width);
     auto insertion_point = m_cursor.col;
-    auto text_start_position = m_cursor.text_offset;
 
     // Fast path: check for redundant updates. This means we're putting the same text into a cell.
     auto& primary_cell = row.cells[insertion_point];
@@ -1229,17 +1135,13 @@ void Screen::put_wide_cell(di::StringView text, MultiCellInfo const& multi_cell_
         primary_cell.has_ids() && primary_cell.ids.graphics_rendition_id == m_graphics_id &&
         primary_cell.ids.hyperlink_id == m_hyperlink_id) {
         // Since everything else matches, we only need to update potentially the text.
-        auto text_start = row.text.iterator_at_offset(m_cursor.text_offset);
-        auto text_end = row.text.iterator_at_offset(m_cursor.text_offset + primary_cell.text_size);
-        ASSERT(text_start.has_value());
-        ASSERT(text_end.has_value());
-        if (row.text.substr(text_start.value(), text_end.value()) != text) {
-            row.text.replace(text_start.value(), text_end.value(), text);
-            primary_cell.stale = false;
+        if (row.cell_text(primary_cell) != text) {
+            row.set_cell_text(primary_cell, text);
+            row.blank = false;
+            row.mark_dirty(insertion_point);
         }
         primary_cell.explicitly_sized = explicitly_sized;
         primary_cell.complex_grapheme_cluster = complex_grapheme_cluster;
-        primary_cell.text_size = text.size_bytes();
         m_active_rows.drop_multi_cell_id(multi_cell_id.value());
     } else {
         // We have to clear text starting from the insertion point. However, we have to extend the
@@ -1251,21 +1153,11 @@ void Screen::put_wide_cell(di::StringView text, MultiCellInfo const& multi_cell_
                 deletion_point--;
             }
         }
-        if (deletion_point < m_cursor.col) {
-            for (auto& cell : auto(*row.cells.subspan(deletion_point, m_cursor.col - deletion_point))) {
-                text_start_position -= cell.text_size;
-            }
-        }
         auto deletion_end = insertion_point + width;
         while (deletion_end < max_width() && row.cells[deletion_end].is_nonprimary_in_multi_cell()) {
             deletion_end++;
         }
-        auto text_end_position = text_start_position;
-        for (auto& cell : auto(*row.cells.subspan(deletion_point, deletion_end - deletion_point))) {
-            clear_cell(cell);
-            text_end_position += cell.text_size;
-            cell.text_size = 0;
-        }
+        clear_cells(row, deletion_point, deletion_end);
 
         // Now that we've cleared any old text, set the attributes appropriately on the primary cells.
         primary_cell.left_boundary_of_multicell = true;
@@ -1273,7 +1165,8 @@ void Screen::put_wide_cell(di::StringView text, MultiCellInfo const& multi_cell_
         primary_cell.explicitly_sized = explicitly_sized;
         primary_cell.complex_grapheme_cluster = complex_grapheme_cluster;
         primary_cell.background_only = false;
-        primary_cell.stale = false;
+        row.blank = false;
+        row.mark_dirty(insertion_point);
         if (m_graphics_id) {
             primary_cell.ids.graphics_rendition_id = m_active_rows.use_graphics_id(m_graphics_id);
         } else {
@@ -1292,26 +1185,88 @@ void Screen::put_wide_cell(di::StringView text, MultiCellInfo const& multi_cell_
             cell.multi_cell_id = m_active_rows.use_multi_cell_id(multi_cell_id.value());
         }
 
-        // Insert the text. We can safely assert the iterator is valid because we compute the text offset in all cases
-        // and it should be correct. Additionally, because each cell contains valid UTF-8 text, the cell boundaries
-        // will always be valid insertion points.
-        auto text_start = row.text.iterator_at_offset(text_start_position);
-        auto text_end = row.text.iterator_at_offset(text_end_position);
-        ASSERT(text_start.has_value());
-        ASSERT(text_end.has_value());
-        row.text.replace(text_start.value(), text_end.value(), text);
-        primary_cell.text_size = text.size_bytes();
+        row.set_cell_text(primary_cell, text);
     }
 
     // Advance the cursor 1 cell.
-    auto new_cursor = m_cursor;
-    new_cursor.col += width;
-    new_cursor.text_offset = text_start_position + text.size_bytes();
-    if (new_cursor.col >= max_width()) {
-        new_cursor.col = max_col_inclusive();
-        new_cursor.overflow_pending = true;
+    m_cursor.col += width;
+    if (m_cursor.col >= max_width()) {
+        m_cursor.col = max_col_inclusive();
+        m_cursor.overflow_pending = true;
+    }
+}
+
+void Screen::put_ascii_cells(di::StringView text, AutoWrapMode auto_wrap_mode) {
+    while (!text.empty()) {
+        if (m_cursor.overflow_pending) {
+            if (auto_wrap_mode == AutoWrapMode::Disabled) {
+                // Without auto-wrap, every remaining code point overwrites the last cell of the row, so
+                // only the final one needs to be written.
+                auto last = di::prev(text.end());
+                put_single_cell(di::StringView(last, text.end()), narrow_multi_cell_info, auto_wrap_mode, false,
+                                false);
+                return;
+            }
+
+            // Let the single cell path handle wrapping, which may induce scrolling.
+            auto first_end = di::next(text.begin());
+            put_single_cell(di::StringView(text.begin(), first_end), narrow_multi_cell_info, auto_wrap_mode, false,
+                            false);
+            text = di::StringView(first_end, text.end());
+            continue;
+        }
+
+        // Fetch and validate the row from the cursor position.
+        auto& row = rows()[m_cursor.row];
+        ASSERT_LT(m_cursor.col, max_width());
+        ASSERT_EQ(row.cells.size(), max_width());
+
+        // Take as much text as fits on the cursor row. Since the text is ASCII, each byte occupies exactly 1 cell.
+        auto count = u32(di::min(text.size_bytes(), usize(max_width() - m_cursor.col)));
+        auto chunk_end = di::next(text.begin(), count);
+        auto chunk = di::StringView(text.begin(), chunk_end);
+        text = di::StringView(chunk_end, text.end());
+
+        // We have to clear text starting from the insertion point. However, we have to extend the
+        // deletion of cells to account for multi cells partially overlapping either end of the chunk.
+        auto insertion_point = m_cursor.col;
+        auto deletion_point = insertion_point;
+        if (row.cells[deletion_point].is_nonprimary_in_multi_cell()) {
+            while (!row.cells[deletion_point].is_primary_in_multi_cell()) {
+                deletion_point--;
+            }
+        }
+        auto deletion_end = insertion_point + count;
+        while (deletion_end < max_width() && row.cells[deletion_end].is_nonprimary_in_multi_cell()) {
+            deletion_end++;
+        }
+        clear_cells(row, deletion_point, deletion_end);
+
+        // Assign the current attributes and text to every new cell. Since the old text was cleared above, each
+        // cell's single byte of text can be written inline directly.
+        auto const* code_units = chunk.data();
+        for (auto& cell : auto(*row.cells.subspan(insertion_point, count))) {
+            cell.ids.graphics_rendition_id = m_active_rows.use_graphics_id(m_graphics_id);
+            cell.ids.hyperlink_id = m_active_rows.use_hyperlink_id(m_hyperlink_id);
+            cell.left_boundary_of_multicell = false;
+            cell.multi_cell_id = 0;
+            cell.explicitly_sized = false;
+            cell.complex_grapheme_cluster = false;
+            cell.background_only = false;
+            cell.inline_text[0] = *code_units++;
+            cell.text_size = 1;
+        }
+        row.blank = false;
+        row.mark_dirty(insertion_point, insertion_point + count);
+
+        // Advance the cursor past the chunk, matching the behavior of put_single_cell().
+        if (insertion_point + count == max_width()) {
+            m_cursor.col = max_col_inclusive();
+            m_cursor.overflow_pending = true;
+        } else {
+            m_cursor.col += count;
+        }
     }
-    m_cursor = new_cursor;
 }
 
 void Screen::put_semantic_prompt(OSC133&& osc133) {
@@ -1385,6 +1340,45 @@ auto Screen::cursor_in_scroll_region() const -> bool {
 void Screen::clear_scroll_back() {
     visual_scroll_to_bottom();
     m_scroll_back.clear();
+    clamp_search_match();
+}
+
+void Screen::set_scroll_back_limit(usize max_cells) {
+    m_scroll_back.set_max_cells(max_cells);
+    clamp_to_scroll_back_start();
+}
+
+auto Screen::discard_oldest_scroll_back() -> usize {
+    auto result = m_scroll_back.discard_oldest_group();
+    clamp_to_scroll_back_start();
+    return result;
+}
+
+auto Screen::allocate_attribute_id(di::FunctionRef<di::Optional<u16>()> allocate) -> di::Optional<u16> {
+    for (;;) {
+        if (auto id = allocate()) {
+            return id;
+        }
+
+        // Discarding (or spilling) the oldest group releases its references. New output takes priority over
+        // old history, so keep going until either an id is freed or there's no scroll back left to evict.
+        auto row_start = absolute_row_start();
+        auto released_cells = m_scroll_back.discard_oldest_group();
+        if (released_cells == 0 && row_start == absolute_row_start()) {
+            return {};
+        }
+        clamp_to_scroll_back_start();
+    }
+}
+
+void Screen::clamp_to_scroll_back_start() {
+    if (m_visual_scroll_offset < absolute_row_start()) {
+        m_visual_scroll_offset = absolute_row_start();
+        invalidate_all();
+    }
+    clamp_selection();
+    clamp_search_match();
+    clamp_semantic_prompts();
 }
 
 void Screen::visual_scroll_up() {
@@ -1445,10 +1439,7 @@ void Screen::visual_reflow_rows_if_needed(u64 visible_rows) {
 
 void Screen::clear_damage_tracking() {
     for (auto const& row : m_active_rows.rows()) {
-        for (auto const& cell : row.cells) {
-            cell.stale = true;
-        }
-        row.stale = true;
+        row.clear_dirty();
     }
 }
 
@@ -1492,7 +1483,7 @@ void Screen::begin_selection(AbsolutePosition const& point, BeginSelectionMode m
     switch (mode) {
         case BeginSelectionMode::Single: {
             m_selection = { adjusted_point, adjusted_point };
-            row.cells[adjusted_point.col].stale = false;
+            row.mark_dirty(adjusted_point.col);
             return;
         }
         case BeginSelectionMode::Word: {
@@ -1527,15 +1518,13 @@ void Screen::begin_selection(AbsolutePosition const& point, BeginSelectionMode m
             }
             m_selection = { AbsolutePosition { adjusted_point.row, start },
                             AbsolutePosition { adjusted_point.row, end } };
-            for (auto const& cell : auto(*row.cells.subspan(start, end - start + 1))) {
-                cell.stale = false;
-            }
+            row.mark_dirty(start, end + 1);
             return;
         }
         case BeginSelectionMode::Line:
             m_selection = { AbsolutePosition { adjusted_point.row, 0 },
                             AbsolutePosition { adjusted_point.row, u32(row.cells.size() - 1) } };
-            row.stale = false;
+            row.mark_all_dirty();
             return;
     }
     di::unreachable();
@@ -1562,6 +1551,175 @@ auto Screen::in_selection(AbsolutePosition const& point) const -> bool {
     return point >= start && point <= end;
 }
 
+auto Screen::set_search(SearchPattern pattern) -> bool {
+    clear_search();
+    m_search_pattern = di::move(pattern);
+    invalidate_all();
+
+    auto const last_visible_row = visual_scroll_offset() + max_height() - 1;
+    m_search_match = find_search_match_before({ last_visible_row, di::NumericLimits<u32>::max });
+    release_searched_scroll_back();
+    scroll_to_search_match();
+    return m_search_match.has_value();
+}
+
+void Screen::clear_search() {
+    if (m_search_pattern) {
+        invalidate_all();
+    }
+    m_search_pattern = {};
+    m_search_match = {};
+}
+
+auto Screen::search_prev() -> bool {
+    if (!m_search_pattern) {
+        return false;
+    }
+
+    // Without a current match, start over from the bottom of the visible rows.
+    auto const last_visible_row = visual_scroll_offset() + max_height() - 1;
+    auto const from = m_search_match ? m_search_match.value().start
+                                     : AbsolutePosition { last_visible_row, di::NumericLimits<u32>::max };
+    auto match = find_search_match_before(from);
+    if (!match) {
+        release_searched_scroll_back();
+        return false;
+    }
+    m_search_match = match;
+    release_searched_scroll_back();
+    invalidate_all();
+    scroll_to_search_match();
+    return true;
+}
+
+auto Screen::search_next() -> bool {
+    if (!m_search_pattern || !m_search_match) {
+        return false;
+    }
+
+    auto match = find_search_match_after(m_search_match.value().start);
+    if (!match) {
+        release_searched_scroll_back();
+        return false;
+    }
+    m_search_match = match;
+    release_searched_scroll_back();
+    invalidate_all();
+    scroll_to_search_match();
+    return true;
+}
+
+void Screen::release_searched_scroll_back() {
+    if (m_scroll_back.respill()) {
+        clamp_to_scroll_back_start();
+    }
+}
+
+auto Screen::search_matches_in_row(u64 row) const -> di::Vector<Selection> {
+    auto result = di::Vector<Selection> {};
+    if (!m_search_pattern) {
+        return result;
+    }
+
+    auto [row_index, row_group] = find_row(row);
+    auto text = SearchText::from_row(row_group.rows()[row_index]);
+    auto start = 0_usize;
+    while (auto match = m_search_pattern.value().find(text.code_points.span(), start)) {
+        auto [match_start, match_end] = match.value();
+        result.push_back({ AbsolutePosition { row, text.cols[match_start] },
+                           AbsolutePosition { row, text.cols[match_end - 1] } });
+        start = match_end;
+    }
+    return result;
+}
+
+auto Screen::in_search_match(AbsolutePosition const& point) const -> bool {
+    if (!m_search_match) {
+        return false;
+    }
+    auto [start, end] = m_search_match.value();
+    return point >= start && point <= end;
+}
+
+auto Screen::find_search_match_before(AbsolutePosition const& point) const -> di::Optional<Selection> {
+    if (!m_search_pattern || point.row < absolute_row_start()) {
+        return {};
+    }
+
+    auto row = di::min(point.row, absolute_row_end() - 1);
+    for (;;) {
+        if (row < absolute_row_screen_start()) {
+            auto [group_start, _, might_match] = m_scroll_back.search_hint(row, m_search_pattern.value());
+            if (!might_match) {
+                if (group_start == absolute_row_start()) {
+                    return {};
+                }
+                row = group_start - 1;
+                continue;
+            }
+        }
+        auto matches = search_matches_in_row(row);
+        for (auto const& match : matches | di::reverse) {
+            if (match.start < point) {
+                return match;
+            }
+        }
+        if (row == absolute_row_start()) {
+            return {};
+        }
+        row--;
+    }
+}
+
+auto Screen::find_search_match_after(AbsolutePosition const& point) const -> di::Optional<Selection> {
+    if (!m_search_pattern) {
+        return {};
+    }
+
+    auto row = di::max(point.row, absolute_row_start());
+    while (row < absolute_row_end()) {
+        if (row < absolute_row_screen_start()) {
+            auto [_, group_end, might_match] = m_scroll_back.search_hint(row, m_search_pattern.value());
+            if (!might_match) {
+                row = group_end;
+                continue;
+            }
+        }
+        for (auto const& match : search_matches_in_row(row)) {
+            if (match.start > point) {
+                return match;
+            }
+        }
+        row++;
+    }
+    return {};
+}
+
+void Screen::scroll_to_search_match() {
+    if (!m_search_match) {
+        return;
+    }
+
+    auto const row = m_search_match.value().start.row;
+    if (row >= m_visual_scroll_offset && row < m_visual_scroll_offset + max_height()) {
+        return;
+    }
+    auto const target = row > max_height() / 2 ? row - max_height() / 2 : 0_u64;
+    m_visual_scroll_offset = di::clamp(target, absolute_row_start(), absolute_row_screen_start());
+    invalidate_all();
+}
+
+void Screen::clamp_search_match() {
+    if (!m_search_match) {
+        return;
+    }
+    auto const& match = m_search_match.value();
+    if (match.start.row < absolute_row_start() || match.end.row >= absolute_row_end()) {
+        m_search_match = {};
+        invalidate_all();
+    }
+}
+
 auto Screen::text_in_last_command(bool include_command) const -> di::String {
     for (auto const& command : m_commands.last_command()) {
         auto const selection = [&] -> Selection {
@@ -1600,16 +1758,14 @@ void Screen::invalidate_region(Selection const& region) {
         auto [row, group] = find_row(r);
         auto const& row_object = group.rows()[row];
         if ((r > start.row && r < end.row) || row_object.cells.empty()) {
-            row_object.stale = false;
+            row_object.mark_all_dirty();
             continue;
         }
 
         // Slow path: iterate over the whole row and invalidate the relevant cells.
         auto iter_start_col = r == start.row ? start.col : 0_usize;
         auto iter_end_col = r == end.row ? end.col : row_object.cells.size() - 1;
-        for (auto const& cell : auto(*row_object.cells.subspan(iter_start_col, iter_end_col - iter_start_col + 1))) {
-            cell.stale = false;
-        }
+        row_object.mark_dirty(iter_start_col, iter_end_col + 1);
     }
 }
 
@@ -1623,11 +1779,45 @@ auto Screen::blank_cell() -> Cell {
     };
 }
 
-void Screen::clear_cell(Cell& cell) {
-    m_active_rows.drop_cell(cell);
-    if (m_current_background_color.type != Color::Type::Default) {
-        cell.background_color = m_current_background_color;
-        cell.background_only = true;
+void Screen::clear_cells(Row& row, usize start, usize end) {
+    // Clearing a row which is already blank is a no-op, which makes repeatedly clearing the screen cheap.
+    if (row.is_blank(m_current_background_color)) {
+        return;
+    }
+
+    // Fill the cells with the blank pattern in a single pass. Only cells which reference attributes or text
+    // need to be released first, and cells which are already blank are left untouched.
+    auto const blank = blank_cell();
+    auto const whole_row = start == 0 && end == row.cells.size();
+    auto dirty_start = u32(end);
+    auto dirty_end = u32(start);
+    for (auto col : di::range(start, end)) {
+        auto& cell = row.cells[col];
+        if (is_same_blank(cell, blank)) {
+            continue;
+        }
+        if (references_storage(cell)) {
+            m_active_rows.drop_cell(cell);
+
+            // When clearing the whole row, the text storage is released all at once below.
+            if (!whole_row) {
+                row.clear_cell_text(cell);
+            }
+        }
+        cell = blank;
+        dirty_start = di::min(dirty_start, u32(col));
+        dirty_end = u32(col + 1);
+    }
+
+    // Clearing a blank cell doesn't change anything, so it doesn't need to be rendered again.
+    row.mark_dirty(dirty_start, dirty_end);
+
+    if (whole_row) {
+        row.overflow_text.clear();
+        row.free_overflow_text.clear();
+        row.set_blank(m_current_background_color);
+    } else {
+        row.blank = false;
     }
 }
 
@@ -1652,7 +1842,9 @@ auto Screen::selected_text(Selection selection) const -> di::String {
         auto [row, group] = find_row(r);
         auto const& row_object = group.rows()[row];
         if (r > start.row && r < end.row) {
-            text.append(row_object.text);
+            for (auto const& cell : row_object.cells) {
+                text.append(row_object.cell_text(cell));
+            }
             if (!row_object.overflow) {
                 text.push_back('\n');
             }
@@ -1693,6 +1885,7 @@ void Screen::clamp_selection() {
 
 void Screen::apply_reflow_result(ReflowResult const& reflow_result) {
     m_selection.transform(di::bind_back(&Selection::apply_reflow_result, di::ref(reflow_result)));
+    m_search_match.transform(di::bind_back(&Selection::apply_reflow_result, di::ref(reflow_result)));
     m_commands.apply_reflow_result(reflow_result);
 
     m_visual_scroll_offset =
@@ -1738,7 +1931,9 @@ auto Screen::state_as_escape_sequences() const -> di::String {
 
     // 3. Screen contents
     auto prev_sgr = GraphicsRendition();
-    auto prev_hyperlink = di::Optional<Hyperlink const&> {};
+    // The previous hyperlink is copied, since its entry in the attribute table may be released along with the
+    // scroll back group it came from.
+    auto prev_hyperlink = di::Optional<Hyperlink> {};
     auto semantic_prompts = di::TreeMap<AbsolutePosition, di::Vector<OSC133>> {};
     for (auto const& command : m_commands.commands()) {
         semantic_prompts[command.prompt_start].emplace_back(BeginPrompt {
@@ -1809,7 +2004,9 @@ auto Screen::state_as_escape_sequences() const -> di::String {
             }
             if (hyperlink != prev_hyperlink) {
                 write_hyperlink(hyperlink);
-                prev_hyperlink = hyperlink;
+                prev_hyperlink = hyperlink.transform([](Hyperlink const& value) {
+                    return value.clone();
+                });
             }
 
             // Write out the text according the explicit size flag and account for non-standard multi-cell info.
@@ -1835,6 +2032,12 @@ auto Screen::state_as_escape_sequences() const -> di::String {
         if (!row_object.overflow && r != absolute_row_end() - 1) {
             di::writer_print<di::String::Encoding>(writer, "\r\n"_sv);
         }
+
+        // Once a scroll back group has been written, release it again if it had to be read back from disk. Otherwise
+        // saving the state would keep the entire history in memory.
+        if (r < m_scroll_back.absolute_row_end() && row_index + 1 == group.total_rows()) {
+            m_scroll_back.release_loaded_group(r);
+        }
     }
 
     // 4. Scroll region
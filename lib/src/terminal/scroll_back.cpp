@@ -1,5 +1,6 @@
 #include "ttx/terminal/scroll_back.h"
 
+#include "di/container/algorithm/find.h"
 #include "ttx/terminal/row_group.h"
 
 namespace ttx::terminal {
@@ -24,16 +25,26 @@ void ScrollBack::add_rows(RowGroup& from, usize row_index, usize row_count) {
             cells_to_take += cells;
             rows_to_take++;
 
-            prev_row_overflow = from.rows()[row_index + rows_to_take].overflow;
+            if (rows_to_take < row_count) {
+                prev_row_overflow = from.rows()[row_index + rows_to_take].overflow;
+            }
         }
 
+        m_total_cells -= to.footprint_cells();
+        auto first_new_row = to.group.total_rows();
         auto cells_taken = to.group.transfer_from(from, row_index, to.group.total_rows(), rows_to_take);
+        index_rows(to, first_new_row);
+        for (auto i : di::range(first_new_row, to.group.total_rows())) {
+            to.row_bytes += to.group.rows()[i].storage_bytes();
+        }
 
         // NOTE: row index remains unchanged because the "old" rows have now been deleted.
         row_count -= rows_to_take;
         m_total_rows += rows_to_take;
         to.cell_count += cells_taken;
         to.last_reflowed_to = {};
+        release_spill_record(to);
+        m_total_cells += to.footprint_cells();
     }
 }
 
@@ -48,14 +59,33 @@ void ScrollBack::take_rows(RowGroup& to, u32 desired_cols, usize row_index, usiz
         auto rows_to_take = di::min(row_count, from.group.total_rows());
         auto from_index = from.group.total_rows() - rows_to_take;
 
+        m_total_cells -= from.footprint_cells();
         auto cells_taken = to.transfer_from(from.group, from_index, row_index, rows_to_take, desired_cols);
 
         row_count -= rows_to_take;
         m_total_rows -= rows_to_take;
         from.cell_count -= cells_taken;
+        release_spill_record(from);
+        update_row_bytes(from);
 
-        if (from.group.empty()) {
+        if (!from.group.empty()) {
+            m_total_cells += from.footprint_cells();
+        } else {
             m_groups.pop_back();
+            if (m_groups.empty()) {
+                continue;
+            }
+
+            // The last group is always kept decompressed, since rows are added to and taken from it. Its index
+            // was shrunk when it was compressed, so it's rebuilt at full size to stay selective as rows are added.
+            auto index = m_groups.size() - 1;
+            auto& group = m_groups[index];
+            forget_hot_group(index);
+            decompress_group(group);
+            m_total_cells -= group.footprint_cells();
+            group.filter.clear();
+            index_rows(group, 0);
+            m_total_cells += group.footprint_cells();
         }
     }
 }
@@ -73,9 +103,15 @@ auto ScrollBack::take_rows_for_reflow(RowGroup& to) -> u64 {
             break;
         }
 
+        m_total_cells -= group.footprint_cells();
         auto cells_taken = to.transfer_from(group.group, group.group.total_rows() - rows_to_take, 0, rows_to_take);
         m_total_rows -= rows_to_take;
         group.cell_count -= cells_taken;
+        update_row_bytes(group);
+        if (rows_to_take > 0) {
+            release_spill_record(group);
+        }
+        m_total_cells += group.footprint_cells();
     }
 
     return rows_to_take;
@@ -86,13 +122,23 @@ auto ScrollBack::reflow_visual_rows(u64 absolute_row_start, usize row_count, u32
     auto result = di::Optional<ReflowResult> {};
     auto visible_rows = 0_usize;
     while (absolute_row_start < absolute_row_end() && visible_rows < row_count) {
-        auto [row_offset, row_group_start, group] = find_row_group(absolute_row_start);
+        auto [row_offset, group_index, group] = find_row_group(absolute_row_start);
+        auto row_group_start = group.absolute_row_start;
         if (group.last_reflowed_to != desired_cols) {
             group.last_reflowed_to = desired_cols;
+            release_spill_record(group);
 
             m_total_rows -= group.group.total_rows();
+            m_total_cells -= group.footprint_cells();
             auto reflow_result = group.group.reflow(row_group_start, desired_cols);
             m_total_rows += group.group.total_rows();
+            update_row_bytes(group);
+
+            // Reflowing joins and splits rows, so the group's index is rebuilt from scratch.
+            group.filter.clear();
+            index_rows(group, 0);
+            m_total_cells += group.footprint_cells();
+            update_group_starts(group_index);
 
             absolute_row_start = reflow_result.map_position({ absolute_row_start, 0 }).row;
             row_offset = reflow_result.map_position({ row_group_start + row_offset, 0 }).row - row_group_start;
@@ -111,35 +157,155 @@ auto ScrollBack::reflow_visual_rows(u64 absolute_row_start, usize row_count, u32
     return result;
 }
 
+void ScrollBack::set_visible_size(u32 rows, u32 cols) {
+    // Every group holds at least target_cells_per_group cells, so a screenful of rows spans at most this many
+    // groups (assuming the rows aren't wider than the screen). One more is needed when the screen straddles a
+    // group boundary.
+    auto groups = di::divide_round_up(usize(rows) * cols, target_cells_per_group) + 1;
+    m_max_decompressed_groups = di::max(min_decompressed_groups, groups);
+    compress_cold_groups();
+}
+
 auto ScrollBack::find_row(u64 row) const -> di::Tuple<u32, RowGroup const&> {
     auto [row_offset, _, group] = const_cast<ScrollBack&>(*this).find_row_group(row);
     return { row_offset, group.group };
 }
 
-auto ScrollBack::find_row_group(u64 row) -> di::Tuple<u32, u64, Group&> {
+void ScrollBack::release_loaded_group(u64 row) const {
+    // Like find_row(), this only changes how the rows are stored, not their contents.
+    auto& self = const_cast<ScrollBack&>(*this);
+    auto index = find_group_index(row);
+    auto& group = self.m_groups[index];
+    if (group.spilled || !group.spill_record || index + 1 == m_groups.size()) {
+        return;
+    }
+    self.spill_group(index);
+}
+
+auto ScrollBack::search_hint(u64 row, SearchPattern const& pattern) const -> di::Tuple<u64, u64, bool> {
+    auto const& group = m_groups[find_group_index(row)];
+    return { group.absolute_row_start, group.absolute_row_start + group.total_rows(),
+             group.filter.might_contain(pattern) };
+}
+
+auto ScrollBack::find_group_index(u64 row) const -> usize {
     ASSERT_GT_EQ(row, absolute_row_start());
     ASSERT_LT(row, absolute_row_end());
 
-    auto row_group_start = absolute_row_start();
-    row -= absolute_row_start();
-
-    // TODO: optimize!
-    for (auto& group : m_groups) {
-        if (row < group.group.total_rows()) {
-            return { u32(row), row_group_start, group };
+    // Binary search for the last group which starts at or before the row. Groups are contiguous, so this is
+    // the group containing the row.
+    auto low = 0_usize;
+    auto high = m_groups.size();
+    while (high - low > 1) {
+        auto mid = low + (high - low) / 2;
+        if (m_groups[mid].absolute_row_start <= row) {
+            low = mid;
+        } else {
+            high = mid;
         }
-        row -= group.group.total_rows();
-        row_group_start += group.group.total_rows();
     }
-    di::unreachable();
+    return low;
+}
+
+auto ScrollBack::find_row_group(u64 row) -> di::Tuple<u32, usize, Group&> {
+    auto index = find_group_index(row);
+    auto& group = use_group(index);
+    ASSERT_LT(row - group.absolute_row_start, group.group.total_rows());
+    return { u32(row - group.absolute_row_start), index, group };
+}
+
+void ScrollBack::update_group_starts(usize index) {
+    // Reflowing a group changes its row count, which shifts every group after it. This is the only operation
+    // which modifies a group other than the first or last one, so it's fine for it to be linear.
+    for (auto i : di::range(index + 1, m_groups.size())) {
+        auto const& previous = m_groups[i - 1];
+        m_groups[i].absolute_row_start = previous.absolute_row_start + previous.total_rows();
+    }
+}
+
+void ScrollBack::index_rows(Group& group, usize row_index) {
+    for (auto i : di::range(row_index, group.group.total_rows())) {
+        group.filter.add(group.group.rows()[i]);
+    }
+}
+
+void ScrollBack::update_row_bytes(Group& group) {
+    group.row_bytes = 0;
+    for (auto const& row : group.group.rows()) {
+        group.row_bytes += row.storage_bytes();
+    }
+}
+
+void ScrollBack::release_spill_record(Group& group) {
+    // The record no longer matches the group's rows, so its space in the spill can be reused.
+    if (group.spill_record && m_spill) {
+        m_spill->release(group.spill_record.value());
+    }
+    group.spill_record = {};
 }
 
 void ScrollBack::clear() {
     while (!m_groups.empty()) {
-        m_absolute_row_start += m_groups.front().value().group.total_rows();
+        auto& group = m_groups.front().value();
+        m_absolute_row_start += group.total_rows();
+        m_total_cells -= group.footprint_cells();
+        recycle_rows(group);
         m_groups.pop_front();
+        m_first_group_id++;
     }
     m_total_rows = 0;
+    m_hot_groups.clear();
+
+    // Nothing references the spilled data anymore, so the segments can be deleted.
+    if (m_spill) {
+        m_spill->clear();
+    }
+}
+
+void ScrollBack::set_max_cells(usize max_cells) {
+    m_max_cells = max_cells;
+    if (m_spill) {
+        while (total_cells() > m_max_cells && spill_oldest_group() > 0) {}
+        return;
+    }
+    while (m_groups.size() > 1 && total_cells() > m_max_cells) {
+        discard_oldest_group();
+    }
+}
+
+auto ScrollBack::respill() -> bool {
+    if (!m_spill) {
+        return false;
+    }
+
+    auto row_start = absolute_row_start();
+    while (total_cells() > m_max_cells && spill_oldest_group() > 0) {}
+    return absolute_row_start() != row_start;
+}
+
+auto ScrollBack::discard_oldest_group() -> usize {
+    if (m_spill) {
+        return spill_oldest_group();
+    }
+    return discard_front_group();
+}
+
+auto ScrollBack::discard_front_group() -> usize {
+    if (m_groups.empty()) {
+        return 0;
+    }
+
+    auto& group = m_groups.front().value();
+    auto deleted_rows = group.total_rows();
+    auto deleted_cells = group.footprint_cells();
+    m_absolute_row_start += deleted_rows;
+    m_total_rows -= deleted_rows;
+    m_total_cells -= deleted_cells;
+    recycle_rows(group);
+    forget_hot_group(0);
+    m_groups.pop_front();
+    m_first_group_id++;
+    return deleted_cells;
 }
 
 auto ScrollBack::is_last_group_full() const -> bool {
@@ -153,12 +319,204 @@ auto ScrollBack::is_last_group_full() const -> bool {
 }
 
 auto ScrollBack::add_group() -> Group& {
-    if (m_groups.size() >= max_groups) {
-        auto deleted_rows = m_groups.front().value().group.total_rows();
-        m_absolute_row_start += deleted_rows;
-        m_total_rows -= deleted_rows;
-        m_groups.pop_front();
+    auto group = Group { .group = RowGroup(*m_attributes) };
+
+    // Make room for the new group by evicting the oldest groups, which are written to disk when spilling and
+    // discarded otherwise. Since older groups are compressed, this usually evicts a single group for every few
+    // groups added.
+    if (m_spill) {
+        while (total_cells() + target_cells_per_group > m_max_cells && spill_oldest_group() > 0) {}
+    } else {
+        while (m_groups.size() > 1 && total_cells() + target_cells_per_group > m_max_cells) {
+            discard_oldest_group();
+        }
+
+        if (!m_groups.empty() && total_cells() + target_cells_per_group > m_max_cells) {
+            auto deleted_rows = m_groups.front().value().total_rows();
+            m_absolute_row_start += deleted_rows;
+            m_total_rows -= deleted_rows;
+
+            // Reuse the oldest group, which keeps the storage of both its row ring and its rows.
+            group = di::move(m_groups.front().value());
+            forget_hot_group(0);
+            m_groups.pop_front();
+            m_first_group_id++;
+            m_total_cells -= group.footprint_cells();
+            recycle_rows(group);
+            group.last_reflowed_to = {};
+            group.filter.clear();
+        }
+    }
+
+    group.absolute_row_start = absolute_row_end();
+    auto& result = m_groups.emplace_back(di::move(group));
+    m_total_cells += result.footprint_cells();
+
+    // The previous last group won't be modified anymore, so it's the first to be compressed unless it's accessed.
+    if (m_groups.size() > 1) {
+        m_hot_groups.push_front(m_first_group_id + m_groups.size() - 2);
+        compress_cold_groups();
+    }
+    return result;
+}
+
+void ScrollBack::recycle_rows(Group& group) {
+    // The attribute table is shared with the screen, so the group's references must be released explicitly.
+    // Compressed rows release their references without being decoded. Spilled rows don't hold any references,
+    // so they're simply forgotten. The caller is responsible for removing the group from the running total.
+    release_spill_record(group);
+    if (group.compressed) {
+        group.compressed.value().drop_attributes(*m_attributes);
+        group.compressed = {};
+    } else if (!group.spilled) {
+        group.group.drop_all_cells();
+        for (auto& row : group.group.rows()) {
+            m_row_pool.release(di::move(row));
+        }
+        group.group.rows().clear();
+    }
+    group.spilled = false;
+    group.cell_count = 0;
+    group.row_bytes = 0;
+}
+
+auto ScrollBack::use_group(usize index) -> Group& {
+    // The last group is always decompressed, and isn't tracked since it's never compressed.
+    auto& group = m_groups[index];
+    if (index + 1 == m_groups.size()) {
+        return group;
+    }
+
+    // Move the group to the most recently used end of the list. The list only holds enough groups for a
+    // screenful of rows, so searching it is cheap.
+    forget_hot_group(index);
+    decompress_group(group);
+    m_hot_groups.push_back(m_first_group_id + index);
+    compress_cold_groups();
+    return group;
+}
+
+void ScrollBack::forget_hot_group(usize index) {
+    auto it = di::find(m_hot_groups, m_first_group_id + index);
+    if (it != m_hot_groups.end()) {
+        m_hot_groups.erase(it);
+    }
+}
+
+void ScrollBack::compress_group(Group& group) {
+    ASSERT(!group.compressed);
+
+    // The compressed rows take over the cells' attribute references, so the rows are released as is.
+    m_total_cells -= group.footprint_cells();
+    group.compressed = CompressedRows::compress(group.group.rows());
+    group.filter.shrink_to_fit();
+    for (auto& row : group.group.rows()) {
+        m_row_pool.release(di::move(row));
+    }
+
+    // Clearing the ring keeps its storage, which would stay allocated for as long as the group is compressed or
+    // spilled. So swap it with an empty ring instead.
+    auto released = di::Ring<Row> {};
+    di::swap(group.group.rows(), released);
+    group.row_bytes = 0;
+    m_total_cells += group.footprint_cells();
+}
+
+void ScrollBack::decompress_group(Group& group) {
+    if (group.decompressed()) {
+        return;
+    }
+
+    m_total_cells -= group.footprint_cells();
+    if (group.spilled) {
+        load_spilled_group(group);
+    }
+    if (group.compressed) {
+        group.compressed.value().decompress(group.group.rows(), m_row_pool);
+        group.compressed = {};
+    }
+    update_row_bytes(group);
+    m_total_cells += group.footprint_cells();
+}
+
+void ScrollBack::compress_cold_groups() {
+    // Compress the least recently used groups until only a few remain decompressed.
+    while (m_hot_groups.size() > m_max_decompressed_groups) {
+        auto id = m_hot_groups.front().value();
+        m_hot_groups.pop_front();
+        compress_group(m_groups[usize(id - m_first_group_id)]);
+    }
+}
+
+auto ScrollBack::spill_group(usize index) -> bool {
+    auto& group = m_groups[index];
+    forget_hot_group(index);
+    if (!group.compressed) {
+        compress_group(group);
+    }
+
+    // Groups which were read back from disk can be spilled again without rewriting them, as long as they
+    // haven't been modified.
+    if (!group.spill_record) {
+        auto data = group.compressed.value().serialize(*m_attributes);
+        auto record = m_spill->write(data.span());
+        if (!record) {
+            return false;
+        }
+        group.spill_record = record.value();
+    }
+
+    m_total_cells -= group.footprint_cells();
+    group.spilled_rows = group.compressed.value().total_rows();
+    group.compressed.value().drop_attributes(*m_attributes);
+    group.compressed = {};
+    group.spilled = true;
+    m_total_cells += group.footprint_cells();
+    return true;
+}
+
+auto ScrollBack::spill_oldest_group() -> usize {
+    if (!m_spill) {
+        return 0;
+    }
+
+    // The last group is still being modified, so it's always kept in memory.
+    for (auto i : di::range(m_groups.size() > 0 ? m_groups.size() - 1 : 0)) {
+        auto& group = m_groups[i];
+        if (group.spilled) {
+            continue;
+        }
+        auto cells = group.footprint_cells();
+        if (spill_group(i)) {
+            return cells - group.footprint_cells();
+        }
+
+        // The group couldn't be written (for example because the disk is full), so fall back to discarding it
+        // to keep the memory limit. Rows can only be removed from the start of the scroll back, so every group
+        // before it is discarded as well.
+        m_spill_errors++;
+        for (auto _ : di::range(i + 1)) {
+            discard_front_group();
+        }
+        return cells;
+    }
+    return 0;
+}
+
+void ScrollBack::load_spilled_group(Group& group) {
+    group.spilled = false;
+    auto mapping = m_spill->read(group.spill_record.value());
+    if (!mapping) {
+        m_spill_errors++;
+
+        // Keep the group's row count intact even if it can't be read, since the absolute row
+        // numbers of every later row depend on it.
+        for (auto _ : di::range(group.spilled_rows)) {
+            group.group.rows().push_back(m_row_pool.acquire(0, {}));
+        }
+        release_spill_record(group);
+        return;
     }
-    return m_groups.emplace_back();
+    group.compressed = CompressedRows::deserialize(mapping.value().span(), *m_attributes);
 }
 }
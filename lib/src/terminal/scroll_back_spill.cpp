@@ -0,0 +1,130 @@
+#include "ttx/terminal/scroll_back_spill.h"
+
+#include "dius/filesystem/operations.h"
+
+// Segment files are created with mkostemp() and mapped by byte range, so they're managed with POSIX calls directly.
+// This is the only place the scroll back touches them, and every failure is reported with its errno.
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace ttx::terminal {
+static auto errno_error() -> di::Unexpected<di::BasicError> {
+    return di::Unexpected(di::BasicError(errno));
+}
+
+ScrollBackSpill::Mapping::~Mapping() {
+    if (m_base) {
+        munmap(m_base, m_length);
+    }
+}
+
+auto ScrollBackSpill::create(di::Path directory) -> di::Result<di::Box<ScrollBackSpill>> {
+    TRY(dius::filesystem::create_directories(directory));
+    return di::make_box<ScrollBackSpill>(di::move(directory));
+}
+
+ScrollBackSpill::~ScrollBackSpill() {
+    clear();
+}
+
+auto ScrollBackSpill::create_segment() -> di::Result<Segment> {
+    // mkostemp() requires a mutable, null terminated template.
+    auto path = m_directory.clone() / "scroll-back-XXXXXX"_tsv;
+    auto name = di::Vector<char> {};
+    for (auto c : path.data()) {
+        name.push_back(c);
+    }
+    name.push_back('\0');
+
+    // The file is opened with O_CLOEXEC atomically, since panes fork from other threads and a child which inherits
+    // the descriptor would keep the file's space allocated.
+    auto fd = mkostemp(name.data(), O_CLOEXEC);
+    if (fd < 0) {
+        return errno_error();
+    }
+
+    // Unlink the file immediately, so that it is removed once closed, even if the process crashes.
+    (void) unlink(name.data());
+    return Segment { .fd = fd };
+}
+
+auto ScrollBackSpill::write(di::Span<byte const> data) -> di::Result<Record> {
+    if (m_segments.empty() || m_segments.back().value().size + data.size() > max_segment_size) {
+        m_segments.push_back(TRY(create_segment()));
+    }
+
+    auto& segment = m_segments.back().value();
+    auto record = Record { .segment = m_segments.size() - 1, .offset = segment.size, .size = data.size() };
+    for (auto written = 0_usize; written < data.size();) {
+        auto result = pwrite(segment.fd, data.data() + written, data.size() - written, off_t(segment.size + written));
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result < 0) {
+            return errno_error();
+        }
+        if (result == 0) {
+            return di::Unexpected(di::BasicError(EIO));
+        }
+        written += usize(result);
+    }
+    segment.size += data.size();
+    segment.live_bytes += data.size();
+    return record;
+}
+
+auto ScrollBackSpill::read(Record const& record) const -> di::Result<Mapping> {
+    ASSERT_LT(record.segment, m_segments.size());
+    ASSERT_LT_EQ(record.offset + record.size, m_segments[record.segment].size);
+
+    // The mapping must start on a page boundary, so map from the start of the page containing the record.
+    auto page_size = u64(sysconf(_SC_PAGESIZE));
+    auto map_offset = record.offset / page_size * page_size;
+    auto length = usize(record.offset - map_offset) + record.size;
+    auto* base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, m_segments[record.segment].fd, off_t(map_offset));
+    if (base == MAP_FAILED) {
+        return errno_error();
+    }
+    return Mapping(base, length, usize(record.offset - map_offset), record.size);
+}
+
+void ScrollBackSpill::release(Record const& record) {
+    ASSERT_LT(record.segment, m_segments.size());
+    auto& segment = m_segments[record.segment];
+    ASSERT_LT_EQ(record.size, segment.live_bytes);
+    segment.live_bytes -= record.size;
+    if (segment.live_bytes > 0 || segment.fd < 0) {
+        return;
+    }
+
+    // The segments are already unlinked, so closing one frees its space. The current segment is kept open so that
+    // writing doesn't need to create a new file. Nothing maps a segment outside of read(), so truncating it is safe.
+    if (record.segment + 1 < m_segments.size()) {
+        close(segment.fd);
+        segment.fd = -1;
+        segment.size = 0;
+    } else if (ftruncate(segment.fd, 0) == 0) {
+        segment.size = 0;
+    }
+}
+
+void ScrollBackSpill::clear() {
+    for (auto const& segment : m_segments) {
+        if (segment.fd >= 0) {
+            close(segment.fd);
+        }
+    }
+    m_segments.clear();
+}
+
+auto ScrollBackSpill::total_bytes() const -> u64 {
+    auto result = u64(0);
+    for (auto const& segment : m_segments) {
+        result += segment.size;
+    }
+    return result;
+}
+}
@@ -0,0 +1,434 @@
+#include "ttx/terminal/search.h"
+
+#include "di/container/algorithm/all_of.h"
+
+namespace ttx::terminal {
+// Visit the code points of each cell in the row along with its column. This defines the text which is searched, so
+// the index and the matcher must agree on it.
+template<typename F>
+static void for_each_code_point(Row const& row, F&& function) {
+    for (auto col : di::range(u32(row.cells.size()))) {
+        auto const& cell = row.cells[col];
+        if (cell.is_nonprimary_in_multi_cell()) {
+            continue;
+        }
+        auto text = row.cell_text(cell);
+        if (text.empty()) {
+            function(U' ', col);
+            continue;
+        }
+        for (auto code_point : text) {
+            function(code_point, col);
+        }
+    }
+}
+
+auto SearchText::from_row(Row const& row) -> SearchText {
+    auto result = SearchText {};
+    for_each_code_point(row, [&](c32 code_point, u32 col) {
+        result.code_points.push_back(code_point);
+        result.cols.push_back(col);
+    });
+
+    // Drop trailing blank cells, so that anchoring to the end of the row works for rows on the screen.
+    while (!result.code_points.empty() && result.code_points.back().value() == U' ') {
+        result.code_points.pop_back();
+        result.cols.pop_back();
+    }
+    return result;
+}
+
+auto SearchPattern::literal(di::StringView text) -> di::Optional<SearchPattern> {
+    auto result = SearchPattern {};
+    for (auto code_point : text) {
+        result.m_literal.push_back(code_point);
+    }
+    if (result.m_literal.empty()) {
+        return {};
+    }
+
+    auto runs = di::Vector<di::Vector<c32>> {};
+    runs.push_back(result.m_literal.clone());
+    result.m_required_text.push_back(di::move(runs));
+    return result;
+}
+
+static auto add_class_ranges(auto& ranges, c32 name) -> bool {
+    switch (name) {
+        case 'd':
+            ranges.push_back({ '0', '9' });
+            return true;
+        case 'w':
+            ranges.push_back({ '0', '9' });
+            ranges.push_back({ 'A', 'Z' });
+            ranges.push_back({ 'a', 'z' });
+            ranges.push_back({ '_', '_' });
+            return true;
+        case 's':
+            ranges.push_back({ ' ', ' ' });
+            ranges.push_back({ '\t', '\t' });
+            return true;
+        default:
+            return false;
+    }
+}
+
+static auto escaped_code_point(c32 code_point) -> c32 {
+    switch (code_point) {
+        case 't':
+            return '\t';
+        case 'n':
+            return '\n';
+        default:
+            return code_point;
+    }
+}
+
+auto SearchPattern::regex(di::StringView text) -> di::Optional<SearchPattern> {
+    auto pattern = di::Vector<c32> {};
+    for (auto code_point : text) {
+        pattern.push_back(code_point);
+    }
+
+    auto result = SearchPattern {};
+    auto alternative = Alternative {};
+    auto i = 0_usize;
+    while (i < pattern.size()) {
+        auto code_point = pattern[i++];
+        if (code_point == '|') {
+            result.m_alternatives.push_back(di::move(alternative));
+            alternative = {};
+            continue;
+        }
+        if (code_point == '^' && alternative.nodes.empty() && !alternative.anchored_start) {
+            alternative.anchored_start = true;
+            continue;
+        }
+        if (code_point == '$' && (i == pattern.size() || pattern[i] == '|')) {
+            alternative.anchored_end = true;
+            continue;
+        }
+        if (code_point == '(' || code_point == ')' || code_point == '*' || code_point == '+' || code_point == '?') {
+            return {};
+        }
+
+        auto node = Node {};
+        if (code_point == '.') {
+            node.negated = true;
+        } else if (code_point == '\\') {
+            if (i == pattern.size()) {
+                return {};
+            }
+            auto name = pattern[i++];
+            auto lower = name >= 'A' && name <= 'Z' ? c32(name - 'A' + 'a') : name;
+            if (add_class_ranges(node.ranges, lower)) {
+                node.negated = name != lower;
+            } else {
+                auto literal = escaped_code_point(name);
+                node.ranges.push_back({ literal, literal });
+            }
+        } else if (code_point == '[') {
+            if (i < pattern.size() && pattern[i] == '^') {
+                node.negated = true;
+                i++;
+            }
+            // A closing bracket at the start of the expression is taken literally.
+            auto first = true;
+            for (;;) {
+                if (i == pattern.size()) {
+                    return {};
+                }
+                auto start = pattern[i++];
+                if (start == ']' && !first) {
+                    break;
+                }
+                first = false;
+                if (start == '\\' && i < pattern.size()) {
+                    auto name = pattern[i++];
+                    if (add_class_ranges(node.ranges, name)) {
+                        continue;
+                    }
+                    start = escaped_code_point(name);
+                }
+                auto end = start;
+                if (i + 1 < pattern.size() && pattern[i] == '-' && pattern[i + 1] != ']') {
+                    end = pattern[i + 1];
+                    i += 2;
+                    if (end < start) {
+                        return {};
+                    }
+                }
+                node.ranges.push_back({ start, end });
+            }
+        } else {
+            node.ranges.push_back({ code_point, code_point });
+        }
+
+        if (i < pattern.size()) {
+            switch (pattern[i]) {
+                case '*':
+                    node.min = 0;
+                    node.max = di::NumericLimits<u32>::max;
+                    i++;
+                    break;
+                case '+':
+                    // Match x+ as xx*, so that every node matches at most once or any number of times.
+                    alternative.nodes.push_back(Node { .ranges = node.ranges.clone(), .negated = node.negated });
+                    node.min = 0;
+                    node.max = di::NumericLimits<u32>::max;
+                    i++;
+                    break;
+                case '?':
+                    node.min = 0;
+                    i++;
+                    break;
+                default:
+                    break;
+            }
+        }
+        alternative.nodes.push_back(di::move(node));
+    }
+    result.m_alternatives.push_back(di::move(alternative));
+
+    // Each alternative has a state before each of its nodes, and a final state which accepts a match.
+    for (auto& candidate : result.m_alternatives) {
+        candidate.first_state = result.m_state_count;
+        result.m_state_count += candidate.nodes.size() + 1;
+    }
+
+    for (auto const& candidate : result.m_alternatives) {
+        auto runs = di::Vector<di::Vector<c32>> {};
+        auto run = di::Vector<c32> {};
+        for (auto const& node : candidate.nodes) {
+            if (node.min == 1 && node.max == 1 && !node.negated && node.ranges.size() == 1 &&
+                node.ranges[0].first == node.ranges[0].last) {
+                run.push_back(node.ranges[0].first);
+                continue;
+            }
+            if (!run.empty()) {
+                runs.push_back(di::move(run));
+                run = {};
+            }
+        }
+        if (!run.empty()) {
+            runs.push_back(di::move(run));
+        }
+        result.m_required_text.push_back(di::move(runs));
+    }
+
+    // Reject patterns which can only produce empty matches, since those are ignored anyways.
+    auto can_match = false;
+    for (auto const& candidate : result.m_alternatives) {
+        for (auto const& node : candidate.nodes) {
+            can_match |= node.max > 0;
+        }
+    }
+    if (!can_match) {
+        return {};
+    }
+    return result;
+}
+
+auto SearchPattern::Node::matches(c32 code_point) const -> bool {
+    for (auto const& range : ranges) {
+        if (code_point >= range.first && code_point <= range.last) {
+            return !negated;
+        }
+    }
+    return negated;
+}
+
+// Simulate the automaton of every alternative at once, tracking for each state the leftmost start position of any
+// partial match which reached it. Since this never backtracks, matching takes time proportional to the length of the
+// text times the size of the pattern, regardless of how many quantifiers the pattern has. Like POSIX, the leftmost
+// match is found, and the longest of those.
+auto SearchPattern::find_regex(di::Span<c32 const> text, usize start) const -> di::Optional<di::Tuple<usize, usize>> {
+    constexpr auto no_match = di::NumericLimits<usize>::max;
+
+    auto current = di::Vector<usize> {};
+    auto next = di::Vector<usize> {};
+    current.resize(m_state_count, no_match);
+    next.resize(m_state_count, no_match);
+
+    // Enter a state, along with every following state which can be reached without consuming any text.
+    auto add_state = [&](di::Vector<usize>& states, Alternative const& alternative, usize node_index,
+                         usize match_start) {
+        for (;; node_index++) {
+            auto& state = states[alternative.first_state + node_index];
+            if (state <= match_start) {
+                return;
+            }
+            state = match_start;
+            if (node_index == alternative.nodes.size() || alternative.nodes[node_index].min > 0) {
+                return;
+            }
+        }
+    };
+
+    auto best = di::Optional<di::Tuple<usize, usize>> {};
+    for (auto position = start;; position++) {
+        // New matches can only start before the best match so far.
+        if (!best) {
+            for (auto const& alternative : m_alternatives) {
+                if (!alternative.anchored_start || position == 0) {
+                    add_state(current, alternative, 0, position);
+                }
+            }
+        }
+
+        for (auto const& alternative : m_alternatives) {
+            auto match_start = current[alternative.first_state + alternative.nodes.size()];
+            if (match_start >= position || (alternative.anchored_end && position != text.size())) {
+                continue;
+            }
+            if (!best || match_start < di::get<0>(*best) ||
+                (match_start == di::get<0>(*best) && position > di::get<1>(*best))) {
+                best = di::make_tuple(match_start, position);
+            }
+        }
+        if (position == text.size()) {
+            break;
+        }
+
+        auto alive = false;
+        for (auto& state : next) {
+            state = no_match;
+        }
+        for (auto const& alternative : m_alternatives) {
+            for (auto [node_index, node] : alternative.nodes | di::enumerate) {
+                auto match_start = current[alternative.first_state + node_index];
+                if (match_start == no_match || (best && match_start > di::get<0>(*best)) ||
+                    !node.matches(text[position])) {
+                    continue;
+                }
+                alive = true;
+                add_state(next, alternative, node.max > 1 ? node_index : node_index + 1, match_start);
+            }
+        }
+        di::swap(current, next);
+
+        // Once there's a match, keep going only while it can still be extended.
+        if (best && !alive) {
+            break;
+        }
+    }
+    return best;
+}
+
+auto SearchPattern::find(di::Span<c32 const> text, usize start) const -> di::Optional<di::Tuple<usize, usize>> {
+    if (start >= text.size()) {
+        return {};
+    }
+
+    if (!is_regex()) {
+        if (start + m_literal.size() > text.size()) {
+            return {};
+        }
+        for (auto position : di::range(start, text.size() - m_literal.size() + 1)) {
+            auto matched = true;
+            for (auto i : di::range(m_literal.size())) {
+                if (text[position + i] != m_literal[i]) {
+                    matched = false;
+                    break;
+                }
+            }
+            if (matched) {
+                return di::make_tuple(position, position + m_literal.size());
+            }
+        }
+        return {};
+    }
+
+    return find_regex(text, start);
+}
+
+auto TrigramFilter::bits(c32 a, c32 b, c32 c) const -> di::Array<usize, 2> {
+    static_assert(max_bit_count <= usize(1) << 32);
+
+    // Take both bits from different halves of a single hash. Masking (rather than a modulo) means folding the
+    // filter in half maps every bit onto the bit it's merged with.
+    auto value = (u64(a) << 42) ^ (u64(b) << 21) ^ u64(c);
+    value *= 0x9e3779b97f4a7c15;
+    auto mask = bit_count() - 1;
+    return { usize(value >> 32) & mask, usize(value & 0xffffffff) & mask };
+}
+
+void TrigramFilter::add(Row const& row) {
+    auto seen = 0_usize;
+    auto a = c32(0);
+    auto b = c32(0);
+    for_each_code_point(row, [&](c32 c, u32) {
+        if (++seen >= 3) {
+            if (m_bits.empty()) {
+                m_bits.resize(max_bit_count / 64, 0);
+            }
+            for (auto bit : bits(a, b, c)) {
+                m_bits[bit / 64] |= u64(1) << (bit % 64);
+            }
+        }
+        a = b;
+        b = c;
+    });
+}
+
+void TrigramFilter::clear() {
+    m_bits.clear();
+}
+
+void TrigramFilter::shrink_to_fit() {
+    // Fold the upper half of the filter onto the lower half while at most an eighth of the bits are set, so that
+    // the folded filter stays at most a quarter full.
+    auto words = m_bits.size();
+    auto set_bits = [&] {
+        auto result = 0_usize;
+        for (auto i : di::range(words)) {
+            result += usize(__builtin_popcountll(m_bits[i]));
+        }
+        return result;
+    };
+    while (words * 64 > min_bit_count && set_bits() * 8 <= words * 64) {
+        words /= 2;
+        for (auto i : di::range(words)) {
+            m_bits[i] |= m_bits[i + words];
+        }
+    }
+    if (words == m_bits.size()) {
+        return;
+    }
+
+    // Copy into a new vector, since shrinking the existing one keeps its storage.
+    auto folded = di::Vector<u64> {};
+    folded.reserve(words);
+    for (auto i : di::range(words)) {
+        folded.push_back(m_bits[i]);
+    }
+    m_bits = di::move(folded);
+}
+
+auto TrigramFilter::contains_trigrams(di::Span<c32 const> text) const -> bool {
+    for (auto i = 2_usize; i < text.size(); i++) {
+        if (m_bits.empty()) {
+            return false;
+        }
+        for (auto bit : bits(text[i - 2], text[i - 1], text[i])) {
+            if (!(m_bits[bit / 64] & (u64(1) << (bit % 64)))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+auto TrigramFilter::might_contain(SearchPattern const& pattern) const -> bool {
+    // The rows might match if any alternative's required text is present. Runs with fewer than 3 code points don't
+    // have any trigrams, so an alternative without longer runs could match any row.
+    for (auto const& runs : pattern.required_text()) {
+        if (di::all_of(runs, [&](di::Vector<c32> const& run) {
+                return contains_trigrams(run.span());
+            })) {
+            return true;
+        }
+    }
+    return false;
+}
+}
@@ -51,6 +51,13 @@ void TerminalInputParser::handle(PrintableCharacter const& printable_character)
     m_events.emplace_back(key_event_from_legacy_code_point(printable_character.code_point));
 }
 
+void TerminalInputParser::handle(PrintableRun const& printable_run) {
+    // Runs are only produced when parsing application output, but handle them anyway for completeness.
+    for (auto code_point : printable_run.text) {
+        handle(PrintableCharacter(code_point));
+    }
+}
+
 void TerminalInputParser::handle(DCS const& dcs) {
     if (auto status_string_response = terminal::StatusStringResponse::from_dcs(dcs)) {
         m_events.emplace_back(di::move(status_string_response).value());
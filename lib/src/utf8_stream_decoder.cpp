@@ -3,17 +3,144 @@
 #include "di/function/between_inclusive.h"
 #include "di/parser/integral.h"
 #include "di/types/byte.h"
+#include "di/vocab/tuple/prelude.h"
 
 namespace ttx {
+// Determine the length of the ASCII prefix of the input. This checks 16 bytes at a time by testing the high bit of
+// each byte using word sized operations. This is portable, and compilers lower it to vector instructions when
+// available.
+static auto ascii_prefix_length(byte const* data, usize size) -> usize {
+    constexpr auto high_bits = u64(0x8080808080808080);
+
+    auto i = 0_usize;
+    for (; i + 16 <= size; i += 16) {
+        u64 words[2];
+        __builtin_memcpy(words, data + i, sizeof(words));
+        if ((words[0] | words[1]) & high_bits) {
+            break;
+        }
+    }
+    while (i < size && di::to_integer<u8>(data[i]) < 0x80) {
+        i++;
+    }
+    return i;
+}
+
+// Validate UTF-8 in place. This returns the length of the longest prefix made up of complete, valid sequences, and
+// whether or not the remaining bytes are the valid start of a sequence which was cut off by the end of the input.
+static auto validate_utf8(byte const* data, usize size) -> di::Tuple<usize, bool> {
+    auto i = 0_usize;
+    while (i < size) {
+        i += ascii_prefix_length(data + i, size - i);
+        if (i == size) {
+            break;
+        }
+
+        // Valid ranges come from the Unicode core specification, table 3-7. Only the second byte of a sequence has
+        // a restricted range.
+        auto lead = di::to_integer<u8>(data[i]);
+        auto length = 0_usize;
+        auto lower_bound = u8(0x80);
+        auto upper_bound = u8(0xBF);
+        if (di::between_inclusive(lead, 0xC2, 0xDF)) {
+            length = 2;
+        } else if (di::between_inclusive(lead, 0xE0, 0xEF)) {
+            length = 3;
+            if (lead == 0xE0) {
+                lower_bound = 0xA0;
+            } else if (lead == 0xED) {
+                upper_bound = 0x9F;
+            }
+        } else if (di::between_inclusive(lead, 0xF0, 0xF4)) {
+            length = 4;
+            if (lead == 0xF0) {
+                lower_bound = 0x90;
+            } else if (lead == 0xF4) {
+                upper_bound = 0x8F;
+            }
+        } else {
+            return { i, false };
+        }
+
+        for (auto j = 1_usize; j < length; j++) {
+            if (i + j == size) {
+                return { i, true };
+            }
+            if (!di::between_inclusive(di::to_integer<u8>(data[i + j]), lower_bound, upper_bound)) {
+                return { i, false };
+            }
+            lower_bound = 0x80;
+            upper_bound = 0xBF;
+        }
+        i += length;
+    }
+    return { i, false };
+}
 
 auto Utf8StreamDecoder::decode(di::Span<byte const> input) -> di::String {
     auto result = ""_s;
-    for (auto byte : input) {
-        decode_byte(result, byte);
-    }
+    decode_into(result, input.data(), input.size());
     return result;
 }
 
+void Utf8StreamDecoder::decode_view(di::Span<byte const> input, di::FunctionRef<void(di::StringView)> output) {
+    auto const* data = input.data();
+    auto size = input.size();
+
+    // Finish a sequence started by the previous call. Only the bytes it still needs are copied, so that the rest of
+    // the input can be passed in place. Clearing the side buffer keeps its capacity, so this doesn't allocate in the
+    // steady state.
+    if (m_pending_code_units > 0) {
+        m_side_buffer.clear();
+        while (size > 0 && m_pending_code_units > 0) {
+            decode_byte(m_side_buffer, *data);
+            data++;
+            size--;
+        }
+        if (!m_side_buffer.empty()) {
+            output(m_side_buffer.view());
+        }
+    }
+
+    // Fast path: when the input is valid, pass a view directly over the input. An incomplete sequence at the end of
+    // the input is fed through the state machine, which only buffers it and doesn't produce any output.
+    auto [valid_size, truncated] = validate_utf8(data, size);
+    if (valid_size == size || truncated) {
+        for (auto i = valid_size; i < size; i++) {
+            decode_byte(m_side_buffer, data[i]);
+        }
+        if (valid_size > 0) {
+            auto const* text = reinterpret_cast<c8 const*>(data);
+            output(di::StringView(di::encoding::assume_valid, text, text + valid_size));
+        }
+        return;
+    }
+
+    // Slow path: the input contains invalid bytes, so the output cannot be a view of the input.
+    m_side_buffer.clear();
+    decode_into(m_side_buffer, data, size);
+    output(m_side_buffer.view());
+}
+
+void Utf8StreamDecoder::decode_into(di::String& output, byte const* data, usize size) {
+    for (auto i = 0_usize; i < size;) {
+        // Fast path: when not in the middle of a multi-byte sequence, copy ASCII bytes in bulk. Typical
+        // terminal output is almost entirely ASCII, so the scalar state machine below is rarely needed.
+        if (m_pending_code_units == 0) {
+            auto ascii_size = ascii_prefix_length(data + i, size - i);
+            if (ascii_size > 0) {
+                auto const* ascii = reinterpret_cast<c8 const*>(data + i);
+                output.append(di::StringView(di::encoding::assume_valid, ascii, ascii + ascii_size));
+                i += ascii_size;
+                continue;
+            }
+        }
+
+        decode_byte(output, data[i]);
+        i++;
+    }
+}
+
 auto Utf8StreamDecoder::flush() -> di::String {
     auto result = ""_s;
     if (m_pending_code_units > 0) {
@@ -76,8 +203,13 @@ void Utf8StreamDecoder::decode_first_byte(di::String& output, byte input) {
 
 void Utf8StreamDecoder::output_code_point(di::String& output, c32 code_point) {
     output.push_back(code_point);
+    reset_state();
+}
 
-    // Reset state.
-    *this = {};
+void Utf8StreamDecoder::reset_state() {
+    m_pending_code_units = 0;
+    m_pending_code_point = 0;
+    m_lower_bound = default_lower_bound;
+    m_upper_bound = default_upper_bound;
 }
 }
@@ -0,0 +1,113 @@
+#include "di/test/prelude.h"
+#include "ttx/dispatch_table.h"
+
+namespace dispatch_table {
+using namespace ttx;
+
+struct Sequence {
+    di::StringView intermediate;
+    c32 terminator { 0 };
+};
+
+// The CSI sequences handled by the terminal (see Terminal::on_parser_result(CSI&&)).
+constexpr auto csi_sequences = di::Array {
+    Sequence { "?$"_sv, 'p' }, Sequence { "="_sv, 'c' }, Sequence { "="_sv, 'u' }, Sequence { ">"_sv, 'c' },
+    Sequence { ">"_sv, 's' },  Sequence { ">"_sv, 'u' }, Sequence { "<"_sv, 'u' }, Sequence { "?"_sv, 'h' },
+    Sequence { "?"_sv, 'l' },  Sequence { "?"_sv, 'u' }, Sequence { " "_sv, 'q' }, Sequence { "!"_sv, 'p' },
+    Sequence { ""_sv, '@' },   Sequence { ""_sv, 'A' },  Sequence { ""_sv, 'B' },  Sequence { ""_sv, 'C' },
+    Sequence { ""_sv, 'D' },   Sequence { ""_sv, 'E' },  Sequence { ""_sv, 'F' },  Sequence { ""_sv, 'G' },
+    Sequence { ""_sv, 'H' },   Sequence { ""_sv, 'J' },  Sequence { ""_sv, 'K' },  Sequence { ""_sv, 'L' },
+    Sequence { ""_sv, 'M' },   Sequence { ""_sv, 'P' },  Sequence { ""_sv, 'S' },  Sequence { ""_sv, 'T' },
+    Sequence { ""_sv, 'X' },   Sequence { ""_sv, 'b' },  Sequence { ""_sv, 'c' },  Sequence { ""_sv, 'd' },
+    Sequence { ""_sv, 'f' },   Sequence { ""_sv, 'g' },  Sequence { ""_sv, 'm' },  Sequence { ""_sv, 'n' },
+    Sequence { ""_sv, 'r' },   Sequence { ""_sv, 's' },  Sequence { ""_sv, 't' },  Sequence { ""_sv, 'u' },
+};
+
+// The OSC numbers handled by the terminal (see Terminal::on_parser_result(OSC&&)).
+constexpr auto osc_numbers = di::Array { u64(7), u64(8), u64(52), u64(66), u64(133), u64(8671) };
+
+// Map each sequence to its index, so that a lookup which resolves to the wrong entry is detected.
+consteval auto make_csi_table() {
+    auto entries = di::Array<DispatchEntry<usize>, csi_sequences.size()> {};
+    for (auto i = 0_usize; i < csi_sequences.size(); i++) {
+        entries[i] = { *dispatch_key(csi_sequences[i].intermediate, csi_sequences[i].terminator), i };
+    }
+    return DispatchTable(entries);
+}
+
+consteval auto make_osc_table() {
+    auto entries = di::Array<DispatchEntry<usize>, osc_numbers.size()> {};
+    for (auto i = 0_usize; i < osc_numbers.size(); i++) {
+        entries[i] = { osc_numbers[i], i };
+    }
+    return DispatchTable(entries);
+}
+
+static void csi() {
+    constexpr static auto table = make_csi_table();
+
+    // Every registered sequence resolves to its own entry.
+    for (auto i : di::range(csi_sequences.size())) {
+        auto key = dispatch_key(csi_sequences[i].intermediate, csi_sequences[i].terminator);
+        ASSERT(key);
+        auto const* value = table.find(*key);
+        ASSERT(value);
+        ASSERT_EQ(*value, i);
+    }
+
+    // Every other sequence misses, even when its key lands in a slot used by a registered sequence.
+    for (auto intermediate : { ""_sv, "?"_sv, ">"_sv, "="_sv, "<"_sv, " "_sv, "!"_sv, "$"_sv, "?$"_sv, "#"_sv,
+                               "*"_sv, "\""_sv, "'"_sv, "$?"_sv, "??"_sv }) {
+        for (auto terminator : di::range(u32('@'), u32('~') + 1)) {
+            auto registered = false;
+            for (auto const& sequence : csi_sequences) {
+                if (sequence.intermediate == intermediate && sequence.terminator == c32(terminator)) {
+                    registered = true;
+                }
+            }
+            auto const* value = table.find(*dispatch_key(intermediate, c32(terminator)));
+            ASSERT_EQ(value != nullptr, registered);
+        }
+    }
+}
+
+static void osc() {
+    constexpr static auto table = make_osc_table();
+
+    for (auto i : di::range(osc_numbers.size())) {
+        auto const* value = table.find(osc_numbers[i]);
+        ASSERT(value);
+        ASSERT_EQ(*value, i);
+    }
+
+    auto found = 0_usize;
+    for (auto number : di::range(u64(10000))) {
+        if (table.find(number)) {
+            found++;
+        }
+    }
+    ASSERT_EQ(found, osc_numbers.size());
+}
+
+static void keys() {
+    // Intermediate characters are part of the key, so sequences only differing by them don't collide.
+    ASSERT(dispatch_key(""_sv, 'h') != dispatch_key("?"_sv, 'h'));
+    ASSERT(dispatch_key("?$"_sv, 'p') != dispatch_key("$?"_sv, 'p'));
+
+    // Sequences with too many intermediate characters are never recognized.
+    ASSERT(dispatch_key("!!!!"_sv, 'p'));
+    ASSERT(!dispatch_key("!!!!!"_sv, 'p'));
+
+    // OSC numbers must be decimal without leading zeros.
+    ASSERT_EQ(dispatch_key("8671"_sv), u64(8671));
+    ASSERT_EQ(dispatch_key("0"_sv), u64(0));
+    ASSERT(!dispatch_key(""_sv));
+    ASSERT(!dispatch_key("08"_sv));
+    ASSERT(!dispatch_key("8a"_sv));
+    ASSERT(!dispatch_key("1234567890"_sv));
+}
+
+TEST(dispatch_table, csi)
+TEST(dispatch_table, osc)
+TEST(dispatch_table, keys)
+}
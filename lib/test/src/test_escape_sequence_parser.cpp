@@ -67,6 +67,29 @@ static void osc() {
     ASSERT_EQ(expected.size(), actual.size());
 }
 
+static void transitions() {
+    // This exercises less common transitions: a lone backslash inside a string, a DCS terminated by BEL,
+    // a CSI which gets ignored, CAN aborting a sequence, and C1 code points which are ignored.
+    constexpr auto input = u8"\033]0;a\\b\033\\\033P1$qm\a\033[1<mx\033[1\x18y\u0085z"_sv;
+
+    auto expected = di::Array {
+        ttx::ParserResult { ttx::OSC { "0;a\\b"_s, "\033\\"_sv } },
+        ttx::ParserResult { ttx::DCS("$q"_s, { { 1 } }, "m"_s) },
+        ttx::ParserResult { ttx::PrintableRun("x"_sv) },
+        ttx::ParserResult { ttx::ControlCharacter(0x18) },
+        ttx::ParserResult { ttx::PrintableRun("y"_sv) },
+        ttx::ParserResult { ttx::PrintableRun("z"_sv) },
+    };
+
+    auto parser = ttx::EscapeSequenceParser {};
+    auto actual = parser.parse_application_escape_sequences(input);
+
+    for (auto const& [ex, ac] : di::zip(expected, actual)) {
+        ASSERT_EQ(ex, ac);
+    }
+    ASSERT_EQ(expected.size(), actual.size());
+}
+
 static void apc() {
     constexpr auto input = "\033_Gx=1;asdf\033\\"_sv;
 
@@ -83,6 +106,27 @@ static void apc() {
     ASSERT_EQ(expected.size(), actual.size());
 }
 
+static void printable_run() {
+    constexpr auto input = u8"abc\033[mde\r\n€f\x7f"_sv;
+
+    auto expected = di::Array {
+        ttx::ParserResult { ttx::PrintableRun(u8"abc"_sv) },
+        ttx::ParserResult { ttx::CSI(""_s, {}, 'm') },
+        ttx::ParserResult { ttx::PrintableRun(u8"de"_sv) },
+        ttx::ParserResult { ttx::ControlCharacter('\r') },
+        ttx::ParserResult { ttx::ControlCharacter('\n') },
+        ttx::ParserResult { ttx::PrintableRun(u8"€f\x7f"_sv) },
+    };
+
+    auto parser = ttx::EscapeSequenceParser {};
+    auto actual = parser.parse_application_escape_sequences(input);
+
+    for (auto const& [ex, ac] : di::zip(expected, actual)) {
+        ASSERT_EQ(ex, ac);
+    }
+    ASSERT_EQ(expected.size(), actual.size());
+}
+
 static void input() {
     using namespace ttx;
 
@@ -111,9 +155,34 @@ static void input() {
     ASSERT_EQ(expected.size(), actual.size());
 }
 
+static void visitor() {
+    constexpr auto input = "ab\033[1;2H\033]8;;https://example.com\033\\cd\033P$qm\033\\\r\n"_sv;
+
+    auto expected_parser = ttx::EscapeSequenceParser {};
+    auto expected = expected_parser.parse_application_escape_sequences(input);
+
+    // Feed the input in two pieces, splitting the CSI, to make sure parser state carries over between calls.
+    auto parser = ttx::EscapeSequenceParser {};
+    auto actual = di::Vector<ttx::ParserResult> {};
+    auto split = *input.iterator_at_offset(6);
+    for (auto piece : { di::StringView(input.begin(), split), di::StringView(split, input.end()) }) {
+        parser.parse(piece, [&](auto&& result) {
+            actual.push_back(ttx::ParserResult(di::move(result)));
+        });
+    }
+
+    for (auto const& [ex, ac] : di::zip(expected, actual)) {
+        ASSERT_EQ(ex, ac);
+    }
+    ASSERT_EQ(expected.size(), actual.size());
+}
+
 TEST(escape_sequence_parser, nvim_startup)
 TEST(escape_sequence_parser, empty_params)
 TEST(escape_sequence_parser, osc)
 TEST(escape_sequence_parser, apc)
+TEST(escape_sequence_parser, transitions)
+TEST(escape_sequence_parser, printable_run)
+TEST(escape_sequence_parser, visitor)
 TEST(escape_sequence_parser, input)
 }
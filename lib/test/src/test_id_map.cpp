@@ -47,6 +47,40 @@ static void full() {
     ASSERT(!map.allocate(0));
 }
 
+static void churn() {
+    auto map = IdMap<u32> {};
+
+    // Allocate enough values to force the lookup table to grow several times.
+    auto ids = di::Vector<IdMap<u32>::Id> {};
+    for (auto value : di::range(1000u)) {
+        auto id = map.allocate(value);
+        ASSERT(id);
+        ids.push_back(*id);
+    }
+
+    // Drop every other value, which exercises removing keys from the middle of probe sequences.
+    for (auto value : di::range(500u)) {
+        map.drop_id(ids[value * 2]);
+    }
+    for (auto value : di::range(1000u)) {
+        if (value % 2 == 0) {
+            ASSERT(!map.lookup_key(value));
+        } else {
+            ASSERT_EQ(map.lookup_key(value), ids[value]);
+            ASSERT_EQ(map.lookup_id(ids[value]), value);
+        }
+    }
+
+    // New values should reuse the freed ids instead of allocating new ones.
+    for (auto value : di::range(1000u, 1500u)) {
+        auto id = map.allocate(value);
+        ASSERT(id);
+        ASSERT_LT_EQ(*id, 1000);
+        ASSERT_EQ(map.lookup_key(value), id);
+    }
+}
+
 TEST(id_map, basic)
 TEST(id_map, full)
+TEST(id_map, churn)
 }
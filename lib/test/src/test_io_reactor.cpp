@@ -0,0 +1,148 @@
+#include "di/test/prelude.h"
+#include "dius/steady_clock.h"
+#include "dius/thread.h"
+#include "ttx/io_reactor.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace io_reactor {
+#ifdef __linux__
+using namespace ttx;
+
+// Wait for another thread to make predicate true, giving up after a few seconds.
+static auto wait_until(auto&& predicate) -> bool {
+    auto deadline = dius::SteadyClock::now() + di::Seconds(5);
+    while (!predicate()) {
+        if (deadline < dius::SteadyClock::now()) {
+            return false;
+        }
+        dius::this_thread::sleep_until(dius::SteadyClock::now() + di::Milliseconds(1));
+    }
+    return true;
+}
+
+static auto create_reactor() -> di::Box<IoReactor> {
+    auto poll_fd = epoll_create1(EPOLL_CLOEXEC);
+    ASSERT_GT_EQ(poll_fd, 0);
+    auto wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    ASSERT_GT_EQ(wake_fd, 0);
+    auto reactor = IoReactor::create(poll_fd, wake_fd);
+    ASSERT(reactor);
+    return di::move(reactor).value();
+}
+
+static void add_errors() {
+    auto reactor = create_reactor();
+
+    // Invalid file descriptors and processes are reported to the caller.
+    ASSERT(!reactor->add(-1, [] {
+        return true;
+    }));
+    ASSERT(!reactor->add_process(-1, [] {
+        return false;
+    }));
+
+    // The reactor keeps working after a registration fails.
+    i32 fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    auto ran = di::Atomic<bool> { false };
+    auto id = reactor->add(fds[0], [&] {
+        ran.store(true, di::MemoryOrder::Release);
+        return false;
+    });
+    ASSERT(id);
+    auto byte = u8('x');
+    ASSERT_EQ(write(fds[1], &byte, 1), 1);
+    ASSERT(wait_until([&] {
+        return ran.load(di::MemoryOrder::Acquire);
+    }));
+    ASSERT(!reactor->failed());
+
+    reactor->remove(*id);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+static void busy_registration() {
+    auto reactor = create_reactor();
+    i32 busy[2];
+    i32 other[2];
+    ASSERT_EQ(pipe(busy), 0);
+    ASSERT_EQ(pipe(other), 0);
+
+    // Both registrations start out queued on the same worker, so the other one only runs while the busy handler
+    // is still running if another worker steals it.
+    auto release = di::Atomic<bool> { false };
+    auto busy_running = di::Atomic<bool> { false };
+    auto other_ran = di::Atomic<bool> { false };
+    auto busy_id = reactor->add(busy[0], [&] {
+        // Occupy the worker, like a pane receiving a flood of output.
+        busy_running.store(true, di::MemoryOrder::Release);
+        wait_until([&] {
+            return release.load(di::MemoryOrder::Acquire);
+        });
+        return false;
+    });
+    auto other_id = reactor->add(other[0], [&] {
+        other_ran.store(true, di::MemoryOrder::Release);
+        return false;
+    });
+    ASSERT(busy_id);
+    ASSERT(other_id);
+
+    auto byte = u8('x');
+    ASSERT_EQ(write(busy[1], &byte, 1), 1);
+    ASSERT(wait_until([&] {
+        return busy_running.load(di::MemoryOrder::Acquire);
+    }));
+    ASSERT_EQ(write(other[1], &byte, 1), 1);
+    ASSERT(wait_until([&] {
+        return other_ran.load(di::MemoryOrder::Acquire);
+    }));
+    release.store(true, di::MemoryOrder::Release);
+
+    reactor->remove(*busy_id);
+    reactor->remove(*other_id);
+    for (auto fd : { busy[0], busy[1], other[0], other[1] }) {
+        close(fd);
+    }
+}
+
+static void poll_failure() {
+    auto poll_fd = epoll_create1(EPOLL_CLOEXEC);
+    ASSERT_GT_EQ(poll_fd, 0);
+    auto wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    ASSERT_GT_EQ(wake_fd, 0);
+    auto reactor = IoReactor::create(poll_fd, wake_fd);
+    ASSERT(reactor);
+
+    // Replace the epoll file descriptor with one that epoll_wait() rejects, and wake the poll thread so that it
+    // waits again. Instead of spinning on the error, the reactor must stop.
+    auto other = eventfd(0, EFD_CLOEXEC);
+    ASSERT_EQ(dup2(other, poll_fd), poll_fd);
+    close(other);
+    auto value = u64(1);
+    ASSERT_EQ(write(wake_fd, &value, sizeof(value)), isize(sizeof(value)));
+    ASSERT(wait_until([&] {
+        return reactor.value()->failed();
+    }));
+
+    // New registrations are refused, so callers fall back to dedicated threads instead of never being serviced.
+    i32 fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    ASSERT(!reactor.value()->add(fds[0], [] {
+        return true;
+    }));
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(io_reactor, add_errors)
+TEST(io_reactor, busy_registration)
+TEST(io_reactor, poll_failure)
+#endif
+}
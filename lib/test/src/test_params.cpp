@@ -1,3 +1,5 @@
+#include "di/container/view/range.h"
+#include "di/format/prelude.h"
 #include "di/test/prelude.h"
 #include "ttx/params.h"
 
@@ -67,7 +69,32 @@ static void to_string() {
     ASSERT_EQ(params2.to_string(), "24;32:1;;2;1::2"_sv);
 }
 
+static void spill() {
+    // Exceed the inline capacity for both parameters and subparameters.
+    auto params = ttx::Params();
+    auto expected = ""_s;
+    for (auto i : di::range(40_u32)) {
+        params.add_param(i);
+        params.add_subparam(i + 100);
+        if (i > 0) {
+            expected.push_back(U';');
+        }
+        expected.append(*di::present("{}:{}"_sv, i, i + 100));
+    }
+
+    ASSERT_EQ(params.size(), 40);
+    for (auto i : di::range(40_u32)) {
+        ASSERT_EQ(params.get(i), i);
+        ASSERT_EQ(params.get_subparam(i), i + 100);
+        ASSERT_EQ(params.subparams(i).size(), 2);
+    }
+    ASSERT_EQ(params.to_string(), expected);
+    ASSERT_EQ(params, params.clone());
+    ASSERT_EQ(ttx::Params::from_string(expected), params);
+}
+
 TEST(params, basic)
 TEST(params, parse)
 TEST(params, to_string)
+TEST(params, spill)
 }
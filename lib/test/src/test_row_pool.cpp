@@ -0,0 +1,52 @@
+#include "di/test/prelude.h"
+#include "ttx/terminal/row_pool.h"
+
+namespace row_pool {
+using namespace ttx::terminal;
+
+static void reuse() {
+    auto pool = RowPool {};
+
+    // An empty pool just creates a new row.
+    auto row = pool.acquire(10, {});
+    ASSERT_EQ(row.cells.size(), 10);
+
+    // Dirty the row before releasing it.
+    row.set_cell_text(row.cells[0], u8"a\u0305\u0306"_sv);
+    row.cells.resize(3);
+    row.overflow = true;
+    auto const* storage = row.cells.data();
+    pool.release(di::move(row));
+    ASSERT_EQ(pool.size(), 1);
+
+    // The released storage is reused, and the row is reset.
+    auto blank = Cell {};
+    blank.background_only = true;
+    auto reused = pool.acquire(10, blank);
+    ASSERT_EQ(pool.size(), 0);
+    ASSERT_EQ(reused.cells.data(), storage);
+    ASSERT_EQ(reused.cells.size(), 10);
+    ASSERT(!reused.overflow);
+    ASSERT(reused.overflow_text.empty());
+    for (auto const& cell : reused.cells) {
+        ASSERT(cell.background_only);
+        ASSERT(cell.text_size == 0);
+    }
+}
+
+static void limit() {
+    auto pool = RowPool {};
+    for (auto _ : di::range(RowPool::max_rows + 10)) {
+        pool.release(pool.acquire(0, {}));
+    }
+    ASSERT_EQ(pool.size(), 1);
+
+    for (auto _ : di::range(RowPool::max_rows + 10)) {
+        pool.release(Row {});
+    }
+    ASSERT_EQ(pool.size(), RowPool::max_rows);
+}
+
+TEST(row_pool, reuse)
+TEST(row_pool, limit)
+}
@@ -95,16 +95,15 @@ static void validate_dirty(Screen& screen, di::StringView text) {
         auto [row_index, row_group] = screen.find_row(i);
         auto const& row = row_group.rows()[row_index];
         for (auto [ch, data] : di::zip(line, row_group.iterate_row(row_index))) {
-            auto [_, cell, _, _, _, _] = data;
+            auto [c, _, _, _, _, _] = data;
 
             if (ch != U' ') {
-                auto cell_dirty = screen.whole_screen_dirty() || !row.stale || !cell.stale;
+                auto cell_dirty = screen.whole_screen_dirty() || (c >= row.dirty_start && c < row.dirty_end);
                 auto expected = ch == U'y';
                 ASSERT_EQ(cell_dirty, expected);
             }
-            cell.stale = true;
         }
-        row.stale = true;
+        row.clear_dirty();
     }
     screen.clear_whole_screen_dirty_flag();
 }
@@ -148,7 +147,6 @@ static void put_text_basic() {
     ASSERT_EQ(cursor, (Cursor {
                           .row = 4,
                           .col = 4,
-                          .text_offset = 4,
                           .overflow_pending = true,
                       }));
 
@@ -166,7 +164,6 @@ static void put_text_basic() {
     ASSERT_EQ(cursor, (Cursor {
                           .row = 2,
                           .col = 4,
-                          .text_offset = 9,
                       }));
 
     validate_text(screen, u8"abcde\n"
@@ -188,7 +185,6 @@ static void put_text_unicode() {
     ASSERT_EQ(cursor, (Cursor {
                           .row = 1,
                           .col = 1,
-                          .text_offset = 3,
                       }));
 
     validate_text(screen, u8"$¢€𐍈 \n"
@@ -198,6 +194,38 @@ static void put_text_unicode() {
                           u8"     "_sv);
 }
 
+static void put_text_overflow() {
+    auto screen = Screen({ 3, 5 }, Screen::ScrollBackEnabled::No);
+
+    // Cells whose text doesn't fit inline are stored in the row's overflow pool, including
+    // cells which grow past the inline limit as combining characters are appended.
+    put_text(screen, u8"a\u0305\u0306b\u0307c"_sv);
+
+    validate_text(screen, u8"a\u0305\u0306|b\u0307|c| | \n"
+                          u8"     \n"
+                          u8"     "_sv);
+
+    // Overwriting overflowing text reuses the pool, and shrinking it back to a single
+    // code point makes the cell inline again.
+    screen.set_cursor(0, 0);
+    put_text(screen, u8"xy\u0305\u0306\u0307"_sv);
+
+    validate_text(screen, u8"x|y\u0305\u0306\u0307|c| | \n"
+                          u8"     \n"
+                          u8"     "_sv);
+
+    // Selecting text must see both the inline and overflow text.
+    screen.begin_selection({ 0, 0 }, Screen::BeginSelectionMode::Single);
+    screen.update_selection({ 0, 2 });
+    ASSERT_EQ(screen.selected_text(), u8"xy\u0305\u0306\u0307c"_sv);
+
+    // Clearing the row releases everything.
+    screen.clear_row();
+    validate_text(screen, u8"     \n"
+                          u8"     \n"
+                          u8"     "_sv);
+}
+
 static void put_text_wide() {
     auto screen = Screen({ 5, 5 }, Screen::ScrollBackEnabled::No);
 
@@ -208,7 +236,6 @@ static void put_text_wide() {
     ASSERT_EQ(cursor, (Cursor {
                           .row = 2,
                           .col = 2,
-                          .text_offset = 3,
                           .overflow_pending = false,
                       }));
 
@@ -226,7 +253,6 @@ static void put_text_wide() {
     ASSERT_EQ(cursor, (Cursor {
                           .row = 3,
                           .col = 4,
-                          .text_offset = 6,
                           .overflow_pending = true,
                       }));
 
@@ -244,7 +270,6 @@ static void put_text_wide() {
     ASSERT_EQ(cursor, (Cursor {
                           .row = 4,
                           .col = 3,
-                          .text_offset = 3,
                           .overflow_pending = false,
                       }));
 
@@ -256,7 +281,6 @@ static void put_text_wide() {
 
     screen.set_cursor(2, 0);
     put_text(screen, "1"_sv);
-    ASSERT_EQ(screen.cursor().text_offset, 1);
 
     validate_text(screen, u8"ab猫.e\n"
                           u8"abcd \n"
@@ -267,7 +291,6 @@ static void put_text_wide() {
 
     screen.set_cursor(3, 4);
     put_text(screen, "2"_sv);
-    ASSERT_EQ(screen.cursor().text_offset, 3);
 
     validate_text(screen, u8"ab猫.e\n"
                           u8"abcd \n"
@@ -304,7 +327,7 @@ static void put_text_wide() {
     screen.set_cursor(4, 4);
     screen.put_code_point(U'猫', AutoWrapMode::Disabled);
     cursor = screen.cursor();
-    ASSERT_EQ(cursor.text_offset, 6);
+    ASSERT_EQ(cursor, (Cursor { .row = 4, .col = 4, .overflow_pending = true }));
 
     validate_text(screen, u8"ab猫.e\n"
                           u8"#\uFE0F|.| | | \n"
@@ -349,6 +372,134 @@ static void put_text_damage_tracking() {
                            "nnnnn"_sv);
 }
 
+static void put_text_run() {
+    for (auto auto_wrap_mode : { AutoWrapMode::Enabled, AutoWrapMode::Disabled }) {
+        auto screen = Screen({ 3, 5 }, Screen::ScrollBackEnabled::No);
+        auto reference = Screen({ 3, 5 }, Screen::ScrollBackEnabled::No);
+
+        // Start with a wide cell which will be partially overwritten.
+        auto initial = u8"ab😀cd"_sv;
+        screen.put_text_run(initial, auto_wrap_mode);
+        for (auto code_point : initial) {
+            reference.put_code_point(code_point, auto_wrap_mode);
+        }
+        ASSERT_EQ(screen.cursor(), reference.cursor());
+
+        screen.set_cursor(0, 3);
+        reference.set_cursor(0, 3);
+
+        auto text = u8"xyz\u0301w€uvwxyzabcdefgh"_sv;
+        screen.put_text_run(text, auto_wrap_mode);
+        for (auto code_point : text) {
+            reference.put_code_point(code_point, auto_wrap_mode);
+        }
+        ASSERT_EQ(screen.cursor(), reference.cursor());
+
+        for (auto r : di::range(screen.max_height())) {
+            for (auto [a, b] : di::zip(screen.iterate_row(r), reference.iterate_row(r))) {
+                auto [_, cell_a, text_a, _, _, _] = a;
+                auto [_, cell_b, text_b, _, _, _] = b;
+                ASSERT_EQ(text_a, text_b);
+                ASSERT_EQ(cell_a.multi_cell_id, cell_b.multi_cell_id);
+            }
+        }
+    }
+}
+
+// Put text as a single run, and one code point at a time on a second screen. The run goes through the ASCII fast path
+// wherever possible, while the code points always take the generic path, so the screens must match.
+static void check_text_run(di::StringView text, AutoWrapMode auto_wrap_mode, u32 start_col) {
+    auto screen = Screen({ 3, 5 }, Screen::ScrollBackEnabled::No);
+    auto reference = Screen({ 3, 5 }, Screen::ScrollBackEnabled::No);
+
+    // Start with wide cells, so that the text partially overwrites them.
+    for (auto code_point : u8"猫x猫"_sv) {
+        screen.put_code_point(code_point, auto_wrap_mode);
+        reference.put_code_point(code_point, auto_wrap_mode);
+    }
+    screen.set_cursor(0, start_col);
+    reference.set_cursor(0, start_col);
+
+    screen.put_text_run(text, auto_wrap_mode);
+    for (auto code_point : text) {
+        reference.put_code_point(code_point, auto_wrap_mode);
+    }
+    ASSERT_EQ(screen.cursor(), reference.cursor());
+
+    for (auto r : di::range(screen.max_height())) {
+        for (auto [a, b] : di::zip(screen.iterate_row(r), reference.iterate_row(r))) {
+            auto [_, cell_a, text_a, _, _, _] = a;
+            auto [_, cell_b, text_b, _, _, _] = b;
+            ASSERT_EQ(text_a, text_b);
+            ASSERT_EQ(cell_a.multi_cell_id, cell_b.multi_cell_id);
+        }
+    }
+}
+
+static void put_text_run_ascii_fast_path() {
+    auto texts = {
+        // ASCII only, long enough to wrap more than once.
+        u8"abcdefghijklm"_sv,
+        // ASCII runs mixed with narrow and wide non-ASCII text.
+        u8"ab猫cd€efg"_sv,
+        u8"猫abcdefg"_sv,
+        u8"a😀b😀cdef"_sv,
+        // A combining character attaches to the last cell of an ASCII run.
+        u8"ab\u0301cdefgh"_sv,
+        // Wide characters which reach the right margin.
+        u8"abcd猫"_sv,
+        u8"abc猫d"_sv,
+        u8"abcde猫"_sv,
+    };
+    for (auto text : texts) {
+        for (auto auto_wrap_mode : { AutoWrapMode::Enabled, AutoWrapMode::Disabled }) {
+            for (auto start_col : di::range(5u)) {
+                check_text_run(text, auto_wrap_mode, start_col);
+            }
+        }
+    }
+
+    // Without auto wrap, text past the right margin keeps overwriting the last column. A wide character which
+    // doesn't fit is moved left so that it ends at the right margin.
+    auto screen = Screen({ 3, 5 }, Screen::ScrollBackEnabled::No);
+    screen.put_text_run(u8"abcdefgh"_sv, AutoWrapMode::Disabled);
+    ASSERT_EQ(screen.cursor(), (Cursor { .row = 0, .col = 4, .overflow_pending = true }));
+    screen.put_text_run(u8"猫"_sv, AutoWrapMode::Disabled);
+    auto row = di::String {};
+    for (auto [_, _, text, _, _, _] : screen.iterate_row(0)) {
+        row.append(text);
+    }
+    ASSERT_EQ(row, u8"abc猫"_sv);
+    ASSERT_EQ(screen.cursor(), (Cursor { .row = 0, .col = 4, .overflow_pending = true }));
+}
+
+static void put_repeated_code_point() {
+    for (auto code_point : { U'x', U'猫' }) {
+        for (auto auto_wrap_mode : { AutoWrapMode::Enabled, AutoWrapMode::Disabled }) {
+            auto screen = Screen({ 3, 5 }, Screen::ScrollBackEnabled::No);
+            auto reference = Screen({ 3, 5 }, Screen::ScrollBackEnabled::No);
+
+            screen.set_cursor(0, 2);
+            reference.set_cursor(0, 2);
+
+            screen.put_repeated_code_point(code_point, 11, auto_wrap_mode);
+            for (auto _ : di::range(11)) {
+                reference.put_code_point(code_point, auto_wrap_mode);
+            }
+            ASSERT_EQ(screen.cursor(), reference.cursor());
+
+            for (auto r : di::range(screen.max_height())) {
+                for (auto [a, b] : di::zip(screen.iterate_row(r), reference.iterate_row(r))) {
+                    auto [_, cell_a, text_a, _, _, _] = a;
+                    auto [_, cell_b, text_b, _, _, _] = b;
+                    ASSERT_EQ(text_a, text_b);
+                    ASSERT_EQ(cell_a.multi_cell_id, cell_b.multi_cell_id);
+                }
+            }
+        }
+    }
+}
+
 static void selection() {
     auto screen = Screen({ 3, 5 }, Screen::ScrollBackEnabled::Yes);
 
@@ -429,40 +580,40 @@ static void cursor_movement() {
     ASSERT_EQ(screen.cursor(), expected);
 
     screen.set_cursor_col(2);
-    expected = { .col = 2, .text_offset = 2 };
+    expected = { .col = 2 };
     ASSERT_EQ(screen.cursor(), expected);
 
     screen.set_cursor_col(1);
-    expected = { .col = 1, .text_offset = 1 };
+    expected = { .col = 1 };
     ASSERT_EQ(screen.cursor(), expected);
 
     screen.set_cursor_row(2);
-    expected = { .row = 2, .col = 1, .text_offset = 1 };
+    expected = { .row = 2, .col = 1 };
     ASSERT_EQ(screen.cursor(), expected);
 
     screen.set_cursor_col(100);
-    expected = { .row = 2, .col = 4, .text_offset = 10 };
+    expected = { .row = 2, .col = 4 };
     ASSERT_EQ(screen.cursor(), expected);
 
     screen.set_cursor_row(1000);
-    expected = { .row = 4, .col = 4, .text_offset = 4 };
+    expected = { .row = 4, .col = 4 };
     ASSERT_EQ(screen.cursor(), expected);
 
     screen.set_cursor(3, 2);
-    expected = { .row = 3, .col = 2, .text_offset = 2 };
+    expected = { .row = 3, .col = 2 };
     ASSERT_EQ(screen.cursor(), expected);
 
     screen.set_cursor(1000, 1000);
-    expected = { .row = 4, .col = 4, .text_offset = 4 };
+    expected = { .row = 4, .col = 4 };
     ASSERT_EQ(screen.cursor(), expected);
 
     screen.set_cursor(4, 4, true);
     ;
-    expected = { .row = 4, .col = 4, .text_offset = 4, .overflow_pending = true };
+    expected = { .row = 4, .col = 4, .overflow_pending = true };
     ASSERT_EQ(screen.cursor(), expected);
 
     screen.set_cursor(4, 4);
-    expected = { .row = 4, .col = 4, .text_offset = 4 };
+    expected = { .row = 4, .col = 4 };
     ASSERT_EQ(screen.cursor(), expected);
 }
 
@@ -484,31 +635,31 @@ static void origin_mode_cursor_movement() {
     ASSERT_EQ(screen.cursor(), expected);
 
     screen.set_cursor_col_relative(2);
-    expected = { .row = 1, .col = 2, .text_offset = 2 };
+    expected = { .row = 1, .col = 2 };
     ASSERT_EQ(screen.cursor(), expected);
 
     screen.set_cursor_col_relative(1);
-    expected = { .row = 1, .col = 1, .text_offset = 1 };
+    expected = { .row = 1, .col = 1 };
     ASSERT_EQ(screen.cursor(), expected);
 
     screen.set_cursor_row_relative(2);
-    expected = { .row = 3, .col = 1, .text_offset = 1 };
+    expected = { .row = 3, .col = 1 };
     ASSERT_EQ(screen.cursor(), expected);
 
     screen.set_cursor_col_relative(100);
-    expected = { .row = 3, .col = 4, .text_offset = 4 };
+    expected = { .row = 3, .col = 4 };
     ASSERT_EQ(screen.cursor(), expected);
 
     screen.set_cursor_row_relative(1000);
-    expected = { .row = 3, .col = 4, .text_offset = 4 };
+    expected = { .row = 3, .col = 4 };
     ASSERT_EQ(screen.cursor(), expected);
 
     screen.set_cursor_relative(3, 2);
-    expected = { .row = 3, .col = 2, .text_offset = 2 };
+    expected = { .row = 3, .col = 2 };
     ASSERT_EQ(screen.cursor(), expected);
 
     screen.set_cursor_relative(1000, 1000);
-    expected = { .row = 3, .col = 4, .text_offset = 4 };
+    expected = { .row = 3, .col = 4 };
     ASSERT_EQ(screen.cursor(), expected);
 }
 
@@ -526,35 +677,29 @@ static void clear_row() {
     screen.set_cursor(0, 2, true);
 
     screen.clear_row_after_cursor();
-    ASSERT_EQ(screen.cursor().text_offset, 2);
     ASSERT_EQ(screen.cursor().overflow_pending, false);
 
     screen.set_cursor(1, 2, true);
 
     screen.clear_row_before_cursor();
-    ASSERT_EQ(screen.cursor().text_offset, 0);
     ASSERT_EQ(screen.cursor().overflow_pending, false);
 
     screen.set_cursor(2, 4, true);
 
     screen.clear_row();
-    ASSERT_EQ(screen.cursor().text_offset, 0);
     ASSERT_EQ(screen.cursor().overflow_pending, false);
 
     screen.set_cursor(3, 2);
     screen.clear_row_after_cursor();
-    ASSERT_EQ(screen.cursor().text_offset, 2);
 
     screen.set_cursor(4, 3);
     screen.clear_row_after_cursor();
 
     screen.set_cursor(5, 2);
     screen.clear_row_before_cursor();
-    ASSERT_EQ(screen.cursor().text_offset, 0);
 
     screen.set_cursor(6, 3);
     screen.clear_row_before_cursor();
-    ASSERT_EQ(screen.cursor().text_offset, 0);
 
     validate_text(screen, u8"ab   \n"
                           u8"   ij\n"
@@ -579,13 +724,11 @@ static void clear_screen() {
 
     screen.set_current_graphics_rendition({ .bg = ttx::Color(ttx::Color::Palette::Blue) });
     screen.clear_before_cursor();
-    ASSERT_EQ(screen.cursor().text_offset, 0);
     ASSERT_EQ(screen.cursor().overflow_pending, false);
 
     screen.set_cursor(3, 1, true);
 
     screen.clear_after_cursor();
-    ASSERT_EQ(screen.cursor().text_offset, 1);
     ASSERT_EQ(screen.cursor().overflow_pending, false);
 
     validate_text(screen, u8"     \n"
@@ -612,7 +755,6 @@ static void clear_all() {
     screen.set_cursor(2, 2, true);
 
     screen.clear();
-    ASSERT_EQ(screen.cursor().text_offset, 0);
     ASSERT_EQ(screen.cursor().overflow_pending, false);
 
     validate_text(screen, "     \n"
@@ -627,7 +769,6 @@ static void clear_all() {
                            "yyyyy"_sv);
 
     screen.clear();
-    ASSERT_EQ(screen.cursor().text_offset, 0);
     ASSERT_EQ(screen.cursor().overflow_pending, false);
 
     validate_text(screen, "     \n"
@@ -642,6 +783,70 @@ static void clear_all() {
                            "nnnnn"_sv);
 }
 
+static void clear_blank_rows() {
+    auto screen = Screen({ 3, 3 }, Screen::ScrollBackEnabled::No);
+
+    auto is_blank = [&](u32 r, ttx::Color background) {
+        auto [row_index, row_group] = screen.find_row(r);
+        return row_group.rows()[row_index].is_blank(background);
+    };
+
+    // New rows start out blank.
+    ASSERT(is_blank(0, {}));
+    ASSERT(is_blank(2, {}));
+
+    put_text(screen, "a"_sv);
+    ASSERT(!is_blank(0, {}));
+    ASSERT(is_blank(1, {}));
+
+    screen.clear();
+    ASSERT(is_blank(0, {}));
+
+    // Clearing with a different background color must still rewrite every cell.
+    screen.set_current_graphics_rendition({ .bg = ttx::Color(ttx::Color::Palette::Red) });
+    screen.clear();
+    ASSERT(is_blank(0, ttx::Color(ttx::Color::Palette::Red)));
+    ASSERT(!is_blank(0, {}));
+    validate_bg(screen, "rrr\n"
+                        "rrr\n"
+                        "rrr"_sv);
+
+    // Partially clearing a row keeps it blank only if nothing changed.
+    screen.set_cursor(1, 1);
+    screen.clear_row_after_cursor();
+    ASSERT(is_blank(1, ttx::Color(ttx::Color::Palette::Red)));
+    screen.set_current_graphics_rendition({});
+    screen.clear_row_after_cursor();
+    ASSERT(!is_blank(1, {}));
+    validate_bg(screen, "rrr\n"
+                        "r  \n"
+                        "rrr"_sv);
+}
+
+static void reset() {
+    auto screen = Screen({ 3, 3 }, Screen::ScrollBackEnabled::No);
+
+    screen.set_current_graphics_rendition({ .bg = ttx::Color(ttx::Color::Palette::Red) });
+    put_text(screen, "abcdefgh"_sv);
+    screen.set_scroll_region({ 1, 2 });
+    screen.set_origin_mode(OriginMode::Enabled);
+    ASSERT(screen.set_search(*SearchPattern::literal("def"_sv)));
+
+    screen.reset({ 2, 4 });
+    ASSERT_EQ(screen.size(), (ttx::Size { 2, 4 }));
+    ASSERT_EQ(screen.cursor(), (Cursor {}));
+    ASSERT_EQ(screen.scroll_region(), (ScrollRegion { 0, 2 }));
+    ASSERT_EQ(screen.origin_mode(), OriginMode::Disabled);
+    ASSERT_EQ(screen.current_graphics_rendition(), ttx::GraphicsRendition {});
+    ASSERT(!screen.search_active());
+    ASSERT(!screen.search_match());
+    ASSERT(screen.whole_screen_dirty());
+    validate_text(screen, "    \n"
+                          "    "_sv);
+    validate_bg(screen, "    \n"
+                        "    "_sv);
+}
+
 static void erase_characters() {
     auto screen = Screen({ 5, 5 }, Screen::ScrollBackEnabled::No);
 
@@ -653,16 +858,13 @@ static void erase_characters() {
 
     screen.set_cursor(0, 2);
     screen.erase_characters(1);
-    ASSERT_EQ(screen.cursor().text_offset, 2);
 
     screen.set_cursor(1, 3);
     screen.erase_characters(2);
-    ASSERT_EQ(screen.cursor().text_offset, 2);
 
     screen.set_cursor(2, 2, true);
 
     screen.erase_characters(1);
-    ASSERT_EQ(screen.cursor().text_offset, 3);
     ASSERT_EQ(screen.cursor().overflow_pending, false);
 
     screen.set_cursor(3, 1);
@@ -694,21 +896,19 @@ static void insert_blank_characters() {
 
     screen.set_cursor(1, 1);
     screen.insert_blank_characters(2000000);
-    expected = { .row = 1, .col = 1, .text_offset = 1 };
+    expected = { .row = 1, .col = 1 };
     ASSERT_EQ(screen.cursor(), expected);
 
     screen.set_cursor(2, 2);
     screen.insert_blank_characters(2);
-    expected = { .row = 2, .col = 2, .text_offset = 3 };
+    expected = { .row = 2, .col = 2 };
     ASSERT_EQ(screen.cursor(), expected);
 
     screen.set_cursor(3, 1);
     screen.insert_blank_characters(3);
-    ASSERT_EQ(screen.cursor().text_offset, 1);
 
     screen.set_cursor(4, 2);
     screen.insert_blank_characters(1);
-    ASSERT_EQ(screen.cursor().text_offset, 1);
 
     validate_text(screen, u8" abcd\n"
                           u8"f    \n"
@@ -736,21 +936,19 @@ static void delete_characters() {
 
     screen.set_cursor(1, 1);
     screen.delete_characters(2000000);
-    expected = { .row = 1, .col = 1, .text_offset = 1 };
+    expected = { .row = 1, .col = 1 };
     ASSERT_EQ(screen.cursor(), expected);
 
     screen.set_cursor(2, 2);
     screen.delete_characters(2);
-    expected = { .row = 2, .col = 2, .text_offset = 3 };
+    expected = { .row = 2, .col = 2 };
     ASSERT_EQ(screen.cursor(), expected);
 
     screen.set_cursor(3, 1);
     screen.delete_characters(1);
-    ASSERT_EQ(screen.cursor().text_offset, 1);
 
     screen.set_cursor(4, 2);
     screen.delete_characters(2);
-    ASSERT_EQ(screen.cursor().text_offset, 1);
 
     validate_text(screen, u8"bcde \n"
                           u8"f    \n"
@@ -871,6 +1069,488 @@ static void vertical_scroll_region_delete_lines() {
                           "ij"_sv);
 }
 
+static void scroll_down_multiple() {
+    auto screen = Screen({ 3, 3 }, Screen::ScrollBackEnabled::Yes);
+    put_text(screen, "abc"
+                     "def"
+                     "ghi"_sv);
+
+    screen.set_cursor(2, 1);
+    screen.scroll_down(2);
+
+    ASSERT_EQ(screen.cursor(), (Cursor { .row = 2, .col = 1 }));
+    ASSERT_EQ(screen.absolute_row_screen_start(), 2);
+    validate_text(screen, "abc\n"
+                          "def\n"
+                          "ghi\n"
+                          "   \n"
+                          "   "_sv);
+
+    auto no_scroll_back = Screen({ 3, 3 }, Screen::ScrollBackEnabled::No);
+    put_text(no_scroll_back, "abc"
+                             "def"
+                             "ghi"_sv);
+
+    // Scrolling by more than the screen height just clears it.
+    no_scroll_back.set_cursor(2, 0);
+    no_scroll_back.scroll_down(2);
+    validate_text(no_scroll_back, "ghi\n"
+                                  "   \n"
+                                  "   "_sv);
+    no_scroll_back.scroll_down(5);
+    validate_text(no_scroll_back, "   \n"
+                                  "   \n"
+                                  "   "_sv);
+}
+
+static void scroll_back_attributes() {
+    auto screen = Screen({ 2, 3 }, Screen::ScrollBackEnabled::Yes);
+
+    screen.set_current_graphics_rendition({ .bg = ttx::Color(ttx::Color::Palette::Red) });
+    put_text(screen, "abc\n"_sv);
+    screen.set_current_graphics_rendition({ .bg = ttx::Color(ttx::Color::Palette::Blue) });
+    put_text(screen, "def\n"_sv);
+    screen.set_current_graphics_rendition({});
+    put_text(screen, "gh"_sv);
+
+    // The first row was moved into the scroll back, but keeps its attributes.
+    ASSERT_EQ(screen.absolute_row_screen_start(), 1);
+    validate_bg(screen, "rrr\n"
+                        "bbb\n"
+                        "   "_sv);
+
+    // Cells with the same attributes share ids, regardless of which row group they're in.
+    screen.set_current_graphics_rendition({ .bg = ttx::Color(ttx::Color::Palette::Red) });
+    put_text(screen, "i"_sv);
+    auto [scroll_back_row, scroll_back_group] = screen.find_row(0);
+    auto [active_row, active_group] = screen.find_row(2);
+    ASSERT_EQ(scroll_back_group.rows()[scroll_back_row].cells[0].graphics_rendition_id(),
+              active_group.rows()[active_row].cells[2].graphics_rendition_id());
+
+    // Clearing the scroll back releases its references, without affecting the remaining cells.
+    screen.clear_scroll_back();
+    screen.set_current_graphics_rendition({});
+    ASSERT_EQ(screen.absolute_row_screen_start(), 1);
+    auto [row, group] = screen.find_row(2);
+    ASSERT_EQ(group.graphics_rendition(group.rows()[row].cells[2].graphics_rendition_id()).bg,
+              ttx::Color(ttx::Color::Palette::Red));
+}
+
+static void scroll_back_attribute_exhaustion() {
+    auto screen = Screen({ 2, 1 }, Screen::ScrollBackEnabled::Yes);
+
+    auto rendition = [](u32 i) {
+        return ttx::GraphicsRendition { .fg = ttx::Color(u8(i), u8(i >> 8), u8(i >> 16)) };
+    };
+
+    // Write more distinct renditions than there are ids, each of which stays referenced by the scroll back.
+    constexpr auto count = 70000_u32;
+    for (auto i : di::range(1u, count)) {
+        screen.set_current_graphics_rendition(rendition(i));
+        put_text(screen, "x\n"_sv);
+    }
+
+    // The oldest history was evicted to free ids, so new output keeps its attributes.
+    ASSERT_GT(screen.absolute_row_start(), 0);
+    screen.set_current_graphics_rendition(rendition(count));
+    ASSERT_EQ(screen.current_graphics_rendition(), rendition(count));
+    put_text(screen, "x"_sv);
+    auto [row, group] = screen.find_row(screen.absolute_row_screen_start() + 1);
+    ASSERT_EQ(group.graphics_rendition(group.rows()[row].cells[0].graphics_rendition_id()), rendition(count));
+
+    // The most recent history is kept.
+    auto [last_row, last_group] = screen.find_row(screen.absolute_row_screen_start() - 1);
+    ASSERT_EQ(last_group.graphics_rendition(last_group.rows()[last_row].cells[0].graphics_rendition_id()),
+              rendition(count - 2));
+}
+
+static void scroll_back_find_row() {
+    auto screen = Screen({ 2, 100 }, Screen::ScrollBackEnabled::Yes);
+
+    // Fill enough full rows to span several scroll back groups.
+    for (auto i : di::range(2000u)) {
+        auto line = di::to_string(i);
+        while (line.size_bytes() < screen.max_width()) {
+            line.append("x"_sv);
+        }
+        put_text(screen, line);
+        put_text(screen, "\n"_sv);
+    }
+    ASSERT_EQ(screen.absolute_row_start(), 0);
+    ASSERT_GT_EQ(screen.absolute_row_screen_start(), 1999);
+
+    for (auto r : { 0u, 1u, 327u, 328u, 655u, 1000u, 1998u }) {
+        auto expected = di::to_string(r);
+        auto [row_index, row_group] = screen.find_row(r);
+        auto actual = di::String {};
+        for (auto [_, _, text, _, _, _] : row_group.iterate_row(row_index) | di::take(expected.size_bytes())) {
+            actual.append(text);
+        }
+        ASSERT_EQ(actual, expected);
+    }
+}
+
+static void scroll_back_limit() {
+    auto screen = Screen({ 2, 100 }, Screen::ScrollBackEnabled::Yes);
+
+    auto put_lines = [&](u32 count) {
+        for (auto _ : di::range(count)) {
+            auto line = di::String {};
+            while (line.size_bytes() < screen.max_width()) {
+                line.append("x"_sv);
+            }
+            put_text(screen, line);
+            put_text(screen, "\n"_sv);
+        }
+    };
+
+    // Fill several row groups, and then lower the limit so that only a single group is kept.
+    put_lines(2000);
+    ASSERT_EQ(screen.absolute_row_start(), 0);
+    auto cells = screen.scroll_back_cells();
+    ASSERT_GT(cells, 65536);
+
+    screen.set_scroll_back_limit(1);
+    ASSERT_GT(screen.absolute_row_start(), 0);
+    ASSERT_LT(screen.scroll_back_cells(), 65536);
+    ASSERT_EQ(screen.visual_scroll_offset(), screen.absolute_row_screen_start());
+
+    // The limit continues to apply as more rows are added.
+    put_lines(2000);
+    ASSERT_LT(screen.scroll_back_cells(), 65536);
+
+    // Discarding every group leaves the scroll back empty.
+    while (screen.discard_oldest_scroll_back() > 0) {}
+    ASSERT_EQ(screen.scroll_back_cells(), 0);
+    ASSERT_EQ(screen.absolute_row_start(), screen.absolute_row_screen_start());
+}
+
+// Fill rows with their row number followed by multi byte text. Every 3rd row has a red background.
+static void put_numbered_lines(Screen& screen, u32 count) {
+    for (auto i : di::range(count)) {
+        auto line = di::to_string(i);
+        auto cols = line.size_bytes() + 3;
+        line.append(u8"é猫"_sv);
+        while (cols++ < screen.max_width()) {
+            line.append("x"_sv);
+        }
+        if (i % 3 == 0) {
+            screen.set_current_graphics_rendition({ .bg = ttx::Color(ttx::Color::Palette::Red) });
+        }
+        put_text(screen, line);
+        screen.set_current_graphics_rendition({});
+        put_text(screen, "\n"_sv);
+    }
+}
+
+static void validate_numbered_line(Screen& screen, u32 r) {
+    auto expected = di::to_string(r);
+    auto [row_index, row_group] = screen.find_row(r);
+    auto const& row = row_group.rows()[row_index];
+    auto actual = di::String {};
+    for (auto [_, _, text, _, _, _] : row_group.iterate_row(row_index) | di::take(expected.size_bytes())) {
+        actual.append(text);
+    }
+    ASSERT_EQ(actual, expected);
+    ASSERT_EQ(row.cell_text(row.cells[expected.size_bytes()]), u8"é"_sv);
+    ASSERT_EQ(row.cell_text(row.cells[expected.size_bytes() + 1]), u8"猫"_sv);
+    ASSERT_EQ(row_group.graphics_rendition(row.cells[0].graphics_rendition_id()).bg,
+              r % 3 == 0 ? ttx::Color(ttx::Color::Palette::Red) : ttx::Color());
+}
+
+static void scroll_back_compression() {
+    auto screen = Screen({ 2, 100 }, Screen::ScrollBackEnabled::Yes);
+
+    // Fill enough rows for most scroll back groups to be compressed.
+    put_numbered_lines(screen, 5000);
+    ASSERT_EQ(screen.absolute_row_start(), 0);
+    ASSERT_LT(screen.scroll_back_cells(), 5000 * 100 / 2);
+
+    // Rows are unchanged after being decompressed, including their attributes and multi byte text.
+    for (auto r : { 0u, 1u, 1000u, 2500u, 0u, 4998u, 1u }) {
+        validate_numbered_line(screen, r);
+    }
+}
+
+static void scroll_back_compression_large_screen() {
+    // A screenful of rows spans many groups on a large screen.
+    auto screen = Screen({ 200, 1000 }, Screen::ScrollBackEnabled::Yes);
+    auto line = di::String {};
+    while (line.size_bytes() < screen.max_width()) {
+        line.append("x"_sv);
+    }
+    for (auto _ : di::range(1000)) {
+        put_text(screen, line);
+        put_text(screen, "\n"_sv);
+    }
+
+    // Accessing every row of the top screenful keeps all of its groups decompressed.
+    auto first_row = screen.find_row(0);
+    for (auto r : di::range(screen.max_height())) {
+        auto [row_index, row_group] = screen.find_row(r);
+        ASSERT_EQ(row_group.rows()[row_index].cells.size(), screen.max_width());
+    }
+    auto [row_index, row_group] = first_row;
+    ASSERT_LT(row_index, row_group.rows().size());
+}
+
+static void scroll_back_decompressed_groups() {
+    auto screen = Screen({ 2, 100 }, Screen::ScrollBackEnabled::Yes);
+    put_numbered_lines(screen, 5000);
+
+    // Groups hold a few hundred rows each, so these rows are all in different groups. Compressed groups don't
+    // keep any rows in their row group.
+    auto [_, a] = screen.find_row(0);
+    auto [_, b] = screen.find_row(1000);
+    auto [_, c] = screen.find_row(2000);
+    ASSERT(!a.rows().empty());
+
+    // The least recently used group is compressed once too many groups are decompressed.
+    screen.find_row(1);
+    screen.find_row(3000);
+    ASSERT(!a.rows().empty());
+    ASSERT(b.rows().empty());
+    ASSERT(!c.rows().empty());
+    validate_numbered_line(screen, 1000);
+}
+
+static void scroll_back_spill() {
+    auto screen = Screen({ 2, 100 }, Screen::ScrollBackEnabled::Yes);
+    auto spill = ScrollBackSpill::create("/tmp"_pv.to_owned());
+    ASSERT(spill);
+    screen.set_scroll_back_spill(di::move(spill).value());
+    screen.set_scroll_back_limit(100000);
+
+    // Nothing is discarded, even though the history doesn't fit within the limit. The memory used can only exceed
+    // the limit by the part of a row which didn't fit in the last group.
+    put_numbered_lines(screen, 5000);
+    ASSERT_EQ(screen.absolute_row_start(), 0);
+    ASSERT_LT_EQ(screen.scroll_back_cells(), 100000 + screen.max_width());
+
+    // Rows are read back from disk when accessed, and can be spilled again.
+    for (auto r : { 0u, 1u, 1000u, 2500u, 0u, 4998u, 1u }) {
+        validate_numbered_line(screen, r);
+    }
+    put_numbered_lines(screen, 1000);
+    ASSERT_EQ(screen.absolute_row_start(), 0);
+    validate_numbered_line(screen, 0);
+    validate_numbered_line(screen, 2500);
+
+    // Searching reads groups back from disk, but writes them out again afterwards.
+    ASSERT(screen.set_search(*SearchPattern::regex(u8"^1?2[3]4é|^0é"_sv)));
+    ASSERT_EQ(screen.search_match().value().start.row, 1234);
+    ASSERT(screen.search_prev());
+    ASSERT_EQ(screen.search_match().value().start.row, 234);
+    ASSERT(screen.search_prev());
+    ASSERT_EQ(screen.search_match().value().start.row, 0);
+    ASSERT_LT_EQ(screen.scroll_back_cells(), 100000 + screen.max_width());
+    screen.clear_search();
+
+    screen.clear_scroll_back();
+    ASSERT_EQ(screen.scroll_back_cells(), 0);
+}
+
+static void scroll_back_spill_failure() {
+    // Writing to a directory which doesn't exist always fails.
+    auto screen = Screen({ 2, 100 }, Screen::ScrollBackEnabled::Yes);
+    screen.set_scroll_back_spill(di::make_box<ScrollBackSpill>("/nonexistent/ttx-scroll-back"_pv.to_owned()));
+    screen.set_scroll_back_limit(100000);
+
+    // Groups which can't be spilled are discarded instead, so the memory limit still applies.
+    put_numbered_lines(screen, 5000);
+    ASSERT_GT(screen.absolute_row_start(), 0);
+    ASSERT_LT_EQ(screen.scroll_back_cells(), 100000 + screen.max_width());
+    ASSERT_GT(screen.scroll_back_spill_errors(), 0);
+    validate_numbered_line(screen, 4998);
+
+    put_numbered_lines(screen, 5000);
+    ASSERT_LT_EQ(screen.scroll_back_cells(), 100000 + screen.max_width());
+}
+
+static void scroll_back_spill_reflow() {
+    auto screen = Screen({ 2, 100 }, Screen::ScrollBackEnabled::Yes);
+    auto spill = ScrollBackSpill::create("/tmp"_pv.to_owned());
+    ASSERT(spill);
+    screen.set_scroll_back_spill(di::move(spill).value());
+    screen.set_scroll_back_limit(1);
+    put_numbered_lines(screen, 2000);
+
+    auto row_starts_with = [&](u64 r, di::StringView expected) {
+        auto [row_index, row_group] = screen.find_row(r);
+        auto actual = di::String {};
+        for (auto [_, _, text, _, _, _] : row_group.iterate_row(row_index) | di::take(3)) {
+            actual.append(text);
+        }
+        ASSERT_EQ(actual, expected);
+    };
+
+    // Read the first group back from disk and reflow it to half the width, which splits every line in two.
+    screen.resize({ 2, 50 });
+    screen.visual_scroll_to_top();
+    screen.visual_reflow_rows_if_needed(screen.max_height());
+    row_starts_with(0, u8"0é猫"_sv);
+    row_starts_with(1, "xxx"_sv);
+    row_starts_with(2, u8"1é猫"_sv);
+
+    // Spilling the group again must write the reflowed rows instead of reusing what was written before.
+    screen.set_scroll_back_limit(1);
+    ASSERT_EQ(screen.absolute_row_start(), 0);
+    row_starts_with(0, u8"0é猫"_sv);
+    row_starts_with(1, "xxx"_sv);
+    row_starts_with(2, u8"1é猫"_sv);
+
+    // Saving the state reads the whole history, but doesn't keep it in memory.
+    screen.set_scroll_back_limit(1);
+    auto cells = screen.scroll_back_cells();
+    auto state = screen.state_as_escape_sequences();
+    ASSERT(!state.empty());
+    ASSERT_LT_EQ(screen.scroll_back_cells(), cells);
+}
+
+static void scroll_back_spill_reclaim() {
+    auto spill = ScrollBackSpill::create("/tmp"_pv.to_owned());
+    ASSERT(spill);
+    auto& segments = *spill.value();
+
+    auto data = di::Vector<byte> {};
+    for (auto i : di::range(100)) {
+        data.push_back(byte(i));
+    }
+    auto first = segments.write(data.span());
+    auto second = segments.write(data.span());
+    ASSERT(first);
+    ASSERT(second);
+    ASSERT_EQ(segments.total_bytes(), 200u);
+
+    // Space is reclaimed once every record in the segment has been released, after which the segment is reused.
+    segments.release(first.value());
+    ASSERT_EQ(segments.total_bytes(), 200u);
+    segments.release(second.value());
+    ASSERT_EQ(segments.total_bytes(), 0u);
+
+    auto third = segments.write(data.span());
+    ASSERT(third);
+    ASSERT_EQ(third.value().offset, 0u);
+    auto mapping = segments.read(third.value());
+    ASSERT(mapping);
+    ASSERT_EQ(u8(mapping.value().span()[99]), 99);
+}
+
+static void search() {
+    auto screen = Screen({ 2, 100 }, Screen::ScrollBackEnabled::Yes);
+    put_numbered_lines(screen, 5000);
+
+    auto expect_match = [&](u64 row, u32 start_col, u32 end_col) {
+        auto expected = Selection { { row, start_col }, { row, end_col } };
+        ASSERT_EQ(screen.search_match(), expected);
+        ASSERT_GT_EQ(row, screen.visual_scroll_offset());
+        ASSERT_LT(row, screen.visual_scroll_offset() + screen.max_height());
+    };
+
+    // Searching scrolls to the match, which requires looking through groups which are compressed.
+    ASSERT(screen.set_search(*SearchPattern::literal(u8"1234é"_sv)));
+    expect_match(1234, 0, 4);
+    ASSERT(!screen.search_prev());
+    expect_match(1234, 0, 4);
+
+    // The search starts from the bottom of the visible rows.
+    ASSERT(screen.set_search(*SearchPattern::literal(u8"猫xx"_sv)));
+    expect_match(1234, 5, 8);
+    ASSERT(screen.search_prev());
+    expect_match(1233, 5, 8);
+    ASSERT(screen.search_next());
+    ASSERT(screen.search_next());
+    expect_match(1235, 5, 8);
+    ASSERT_EQ(screen.search_matches_in_row(1235).size(), 1);
+
+    screen.visual_scroll_to_bottom();
+    ASSERT(screen.set_search(*SearchPattern::regex(u8"^49*é"_sv)));
+    expect_match(4999, 0, 4);
+    ASSERT(screen.search_prev());
+    expect_match(499, 0, 3);
+    ASSERT(screen.search_prev());
+    expect_match(49, 0, 2);
+    ASSERT(screen.search_prev());
+    expect_match(4, 0, 1);
+    ASSERT(!screen.search_prev());
+    ASSERT(screen.search_next());
+    expect_match(49, 0, 2);
+
+    screen.visual_scroll_to_bottom();
+    ASSERT(screen.set_search(*SearchPattern::regex("^[0-2]\\d\\d[^\\d]|^4999"_sv)));
+    expect_match(4999, 0, 3);
+    ASSERT(screen.search_prev());
+    expect_match(299, 0, 3);
+
+    ASSERT(!screen.set_search(*SearchPattern::literal("zzz"_sv)));
+    ASSERT(!screen.search_match());
+    ASSERT(!SearchPattern::regex("(a)"_sv));
+    ASSERT(!SearchPattern::regex("*a"_sv));
+
+    screen.clear_search();
+    ASSERT(!screen.search_active());
+}
+
+static void search_index() {
+    auto screen = Screen({ 2, 100 }, Screen::ScrollBackEnabled::Yes);
+    put_text(screen, "hello world 12345"_sv);
+
+    auto filter = TrigramFilter {};
+    auto [row, group] = screen.find_row(0);
+    filter.add(group.rows()[row]);
+
+    auto might_contain = [&](di::StringView regex) {
+        return filter.might_contain(*SearchPattern::regex(regex));
+    };
+
+    ASSERT(filter.might_contain(*SearchPattern::literal("world"_sv)));
+    ASSERT(!filter.might_contain(*SearchPattern::literal("worlds"_sv)));
+
+    // Regular expressions are checked using the literal runs of each alternative.
+    ASSERT(might_contain("^hel+o w.rld"_sv));
+    ASSERT(!might_contain("^helo w.rld"_sv));
+    ASSERT(!might_contain("wxr[a-z]d|xyz"_sv));
+    ASSERT(might_contain("wor[a-z]d|hello"_sv));
+
+    // Alternatives without runs of at least 3 code points could match anything.
+    ASSERT(might_contain("xyz|\\d+"_sv));
+
+    // Shrinking folds the filter to fit the recorded text, without losing any trigrams.
+    filter.shrink_to_fit();
+    ASSERT_EQ(filter.bit_count(), TrigramFilter::min_bit_count);
+    ASSERT_LT(filter.size_bytes(), TrigramFilter::max_bit_count / 8);
+    ASSERT(filter.might_contain(*SearchPattern::literal("world"_sv)));
+    ASSERT(!filter.might_contain(*SearchPattern::literal("worlds"_sv)));
+    ASSERT(!might_contain("wxr[a-z]d|xyz"_sv));
+
+    // An empty filter doesn't allocate, and can't contain any trigrams.
+    auto empty = TrigramFilter {};
+    ASSERT_EQ(empty.size_bytes(), 0);
+    ASSERT(!empty.might_contain(*SearchPattern::literal("world"_sv)));
+}
+
+static void search_pathological() {
+    auto text = di::Vector<c32> {};
+    for (auto _ : di::range(200)) {
+        text.push_back(U'a');
+    }
+
+    // Backtracking would take around 200^7 steps to reject this, but it must finish quickly.
+    auto no_match = SearchPattern::regex("a*a*a*a*a*a*b"_sv);
+    ASSERT(no_match);
+    ASSERT(!no_match->find(text.span()));
+
+    auto longest = SearchPattern::regex("a*a*a*a*a*a*$|b"_sv);
+    ASSERT(longest);
+    ASSERT_EQ(longest->find(text.span()), di::make_tuple(0_usize, 200_usize));
+    ASSERT_EQ(longest->find(text.span(), 150), di::make_tuple(150_usize, 200_usize));
+
+    // The leftmost match wins, and the longest one among those.
+    auto alternatives = SearchPattern::regex("a|aa+|b"_sv);
+    ASSERT(alternatives);
+    ASSERT_EQ(alternatives->find(text.span(), 10), di::make_tuple(10_usize, 200_usize));
+}
+
 static void autowrap() {
     for (auto scroll_back_enabled : { Screen::ScrollBackEnabled::No, Screen::ScrollBackEnabled::Yes }) {
         auto screen = Screen({ 4, 2 }, scroll_back_enabled);
@@ -882,7 +1562,7 @@ static void autowrap() {
                          "ij"
                          "kl"_sv);
 
-        auto expected = Cursor { .row = 3, .col = 1, .text_offset = 1, .overflow_pending = true };
+        auto expected = Cursor { .row = 3, .col = 1, .overflow_pending = true };
         ASSERT_EQ(screen.cursor(), expected);
 
         if (scroll_back_enabled == Screen::ScrollBackEnabled::Yes) {
@@ -914,7 +1594,7 @@ static void vertical_scroll_region_autowrap() {
                          "ij"
                          "kl"_sv);
 
-        auto expected = Cursor { .row = 2, .col = 1, .text_offset = 1, .overflow_pending = true };
+        auto expected = Cursor { .row = 2, .col = 1, .overflow_pending = true };
         ASSERT_EQ(screen.cursor(), expected);
 
         if (scroll_back_enabled == Screen::ScrollBackEnabled::Yes) {
@@ -950,7 +1630,7 @@ static void save_restore_cursor() {
 
     screen.restore_cursor(save);
 
-    auto expected_cursor = Cursor { .row = 4, .col = 1, .text_offset = 2, .overflow_pending = true };
+    auto expected_cursor = Cursor { .row = 4, .col = 1, .overflow_pending = true };
     ASSERT_EQ(screen.cursor(), expected_cursor);
     ASSERT_EQ(screen.origin_mode(), OriginMode::Disabled);
     ASSERT_EQ(screen.current_graphics_rendition(), ttx::GraphicsRendition {});
@@ -1099,9 +1779,13 @@ static void reflow_truncate() {
 
 TEST(screen, put_text_basic)
 TEST(screen, put_text_unicode)
+TEST(screen, put_text_overflow)
 TEST(screen, put_text_wide)
 TEST(screen, put_text_damage_tracking)
 TEST(screen, put_text_random)
+TEST(screen, put_text_run)
+TEST(screen, put_text_run_ascii_fast_path)
+TEST(screen, put_repeated_code_point)
 TEST(screen, selection)
 TEST(screen, selection_empty)
 TEST(screen, cursor_movement)
@@ -1109,6 +1793,8 @@ TEST(screen, origin_mode_cursor_movement)
 TEST(screen, clear_row)
 TEST(screen, clear_screen)
 TEST(screen, clear_all)
+TEST(screen, clear_blank_rows)
+TEST(screen, reset)
 TEST(screen, erase_characters)
 TEST(screen, insert_blank_characters)
 TEST(screen, delete_characters)
@@ -1116,6 +1802,21 @@ TEST(screen, insert_blank_lines)
 TEST(screen, vertical_scroll_region_insert_blank_lines)
 TEST(screen, delete_lines)
 TEST(screen, vertical_scroll_region_delete_lines)
+TEST(screen, scroll_down_multiple)
+TEST(screen, scroll_back_attributes)
+TEST(screen, scroll_back_attribute_exhaustion)
+TEST(screen, scroll_back_find_row)
+TEST(screen, scroll_back_limit)
+TEST(screen, scroll_back_compression)
+TEST(screen, scroll_back_compression_large_screen)
+TEST(screen, scroll_back_decompressed_groups)
+TEST(screen, scroll_back_spill)
+TEST(screen, scroll_back_spill_failure)
+TEST(screen, scroll_back_spill_reflow)
+TEST(screen, scroll_back_spill_reclaim)
+TEST(screen, search)
+TEST(screen, search_index)
+TEST(screen, search_pathological)
 TEST(screen, autowrap)
 TEST(screen, vertical_scroll_region_autowrap)
 TEST(screen, save_restore_cursor)
@@ -0,0 +1,129 @@
+#include "di/test/prelude.h"
+#include "ttx/scroll_back_governor.h"
+
+namespace scroll_back_governor {
+using namespace ttx;
+
+// A scroll back made of equally sized groups, which reports its usage like a pane does.
+struct FakeScrollBack {
+    ScrollBackGovernor* governor { nullptr };
+    di::String* discards { nullptr };
+    c32 name { 0 };
+    i64 last_viewed { 0 };
+    usize cells { 0 };
+
+    auto discard_oldest() -> usize {
+        auto discarded = di::min(cells, 20_usize);
+        governor->update_usage(cells, cells - discarded);
+        cells -= discarded;
+        if (discarded > 0) {
+            discards->push_back(name);
+        }
+        return discarded;
+    }
+};
+
+static auto add(ScrollBackGovernor& governor, FakeScrollBack& scroll_back) -> u64 {
+    auto id = governor.add({
+        .last_viewed =
+            [&] {
+                return scroll_back.last_viewed;
+            },
+        .discard_oldest =
+            [&] {
+                return scroll_back.discard_oldest();
+            },
+    });
+    governor.update_usage(0, scroll_back.cells);
+    return id;
+}
+
+static void eviction_order() {
+    auto governor = ScrollBackGovernor {};
+    auto discards = di::String {};
+    auto a = FakeScrollBack { &governor, &discards, U'a', 3, 60 };
+    auto b = FakeScrollBack { &governor, &discards, U'b', 1, 60 };
+    auto c = FakeScrollBack { &governor, &discards, U'c', 2, 60 };
+    auto a_id = add(governor, a);
+    auto b_id = add(governor, b);
+    auto c_id = add(governor, c);
+    ASSERT_EQ(governor.total_cells(), 180);
+
+    // Nothing is discarded while within budget.
+    governor.enforce();
+    ASSERT(discards.empty());
+
+    // The least recently viewed scroll back is emptied first, then the next one is trimmed just enough.
+    governor.set_max_cells(100);
+    ASSERT(governor.over_budget());
+    governor.enforce();
+    ASSERT_EQ(discards, "bbbc"_sv);
+    ASSERT_EQ(a.cells, 60);
+    ASSERT_EQ(b.cells, 0);
+    ASSERT_EQ(c.cells, 40);
+    ASSERT_EQ(governor.total_cells(), 100);
+    ASSERT(!governor.over_budget());
+
+    // Viewing a scroll back protects it, as the order is sampled on every call.
+    discards.clear();
+    a.last_viewed = 0;
+    governor.set_max_cells(70);
+    governor.enforce();
+    ASSERT_EQ(discards, "aa"_sv);
+    ASSERT_EQ(a.cells, 20);
+    ASSERT_EQ(c.cells, 40);
+
+    governor.remove(a_id, a.cells);
+    governor.remove(b_id, b.cells);
+    governor.remove(c_id, c.cells);
+    ASSERT_EQ(governor.total_cells(), 0);
+}
+
+static void budget_enforcement() {
+    auto governor = ScrollBackGovernor {};
+    auto discards = di::String {};
+    auto a = FakeScrollBack { &governor, &discards, U'a', 1, 50 };
+    auto b = FakeScrollBack { &governor, &discards, U'b', 2, 50 };
+    auto a_id = add(governor, a);
+    auto b_id = add(governor, b);
+
+    // When every scroll back is emptied, usage can't get any lower, and enforce() stops.
+    governor.set_max_cells(0);
+    governor.enforce();
+    ASSERT_EQ(governor.total_cells(), 0);
+    ASSERT_EQ(a.cells, 0);
+    ASSERT_EQ(b.cells, 0);
+
+    // Removed members are no longer trimmed.
+    governor.remove(a_id, a.cells);
+    b.cells = 50;
+    governor.update_usage(0, 50);
+    a.cells = 50;
+    discards.clear();
+    governor.set_max_cells(30);
+    governor.enforce();
+    ASSERT_EQ(discards, "b"_sv);
+    ASSERT_EQ(a.cells, 50);
+    ASSERT_EQ(governor.total_cells(), 30);
+    governor.remove(b_id, b.cells);
+}
+
+static void shared() {
+    // Panes all report to the same governor, which has no budget until one is configured.
+    auto& governor = ScrollBackGovernor::shared();
+    ASSERT_EQ(&governor, &ScrollBackGovernor::shared());
+    ASSERT_EQ(governor.max_cells(), ScrollBackGovernor::unlimited);
+
+    auto discards = di::String {};
+    auto scroll_back = FakeScrollBack { &governor, &discards, U'a', 0, 40 };
+    auto total = governor.total_cells();
+    auto id = add(governor, scroll_back);
+    ASSERT_EQ(governor.total_cells(), total + 40);
+    governor.remove(id, scroll_back.cells);
+    ASSERT_EQ(governor.total_cells(), total);
+}
+
+TEST(scroll_back_governor, eviction_order)
+TEST(scroll_back_governor, budget_enforcement)
+TEST(scroll_back_governor, shared)
+}
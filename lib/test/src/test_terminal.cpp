@@ -0,0 +1,130 @@
+#include "di/test/prelude.h"
+#include "ttx/escape_sequence_parser.h"
+#include "ttx/terminal.h"
+#include "ttx/terminal/search.h"
+
+namespace terminal {
+using namespace ttx;
+
+static void feed(Terminal& terminal, EscapeSequenceParser& parser, di::StringView text) {
+    parser.parse(text, [&](auto&& result) {
+        terminal.on_parser_result(di::move(result));
+    });
+}
+
+static void line_feed_batching() {
+    auto terminal = Terminal(0, { .rows = 4, .cols = 4 });
+    auto parser = EscapeSequenceParser();
+    auto const& screen = terminal.active_screen().screen;
+
+    // Line feeds above the bottom of the screen just move the cursor.
+    feed(terminal, parser, "a\n\n\n"_sv);
+    ASSERT_EQ(terminal.cursor_row(), 3);
+    ASSERT_EQ(screen.absolute_row_screen_start(), 0);
+
+    // Line feeds at the bottom are queued, including across carriage returns.
+    feed(terminal, parser, "\r\n\r\n\r\n"_sv);
+    ASSERT_EQ(terminal.cursor_row(), 3);
+    ASSERT_EQ(terminal.cursor_col(), 0);
+    ASSERT_EQ(screen.absolute_row_screen_start(), 0);
+
+    // The next result scrolls once for all of them.
+    feed(terminal, parser, "b"_sv);
+    ASSERT_EQ(screen.absolute_row_screen_start(), 3);
+    ASSERT_EQ(terminal.cursor_row(), 3);
+    ASSERT_EQ(terminal.cursor_col(), 1);
+
+    // No more line feeds than rows in the scroll region are queued, so every blank row reaches the scroll back.
+    feed(terminal, parser, "\n\n\n\n\n\n"_sv);
+    ASSERT_EQ(screen.absolute_row_screen_start(), 7);
+    terminal.flush_line_feeds();
+    ASSERT_EQ(screen.absolute_row_screen_start(), 9);
+}
+
+static auto row_text(Terminal const& terminal, u64 row) -> di::String {
+    auto result = di::String {};
+    for (auto [_, _, text, _, _, _] : terminal.active_screen().screen.iterate_row(row)) {
+        result.append(text.empty() ? " "_sv : text);
+    }
+    return result;
+}
+
+static void line_feed_batching_with_text() {
+    auto terminal = Terminal(0, { .rows = 4, .cols = 4 });
+    auto parser = EscapeSequenceParser();
+    auto const& screen = terminal.active_screen().screen;
+
+    // Lines of text separated by line feeds are batched, including across parse calls.
+    auto text = di::String {};
+    for (auto i : di::range(1, 21)) {
+        text.append(di::to_string(i));
+        if (i != 20) {
+            text.append("\r\n"_sv);
+        }
+    }
+    auto view = text.view();
+    auto split = di::next(view.begin(), 10);
+    feed(terminal, parser, view.substr(view.begin(), split));
+    feed(terminal, parser, view.substr(split, view.end()));
+    terminal.flush_line_feeds();
+
+    ASSERT_EQ(screen.absolute_row_screen_start(), 16);
+    ASSERT_EQ(terminal.cursor_row(), 3);
+    ASSERT_EQ(terminal.cursor_col(), 2);
+    for (auto i : di::range(20_u32)) {
+        auto expected = di::to_string(i + 1);
+        while (expected.size_bytes() < 4) {
+            expected.append(" "_sv);
+        }
+        ASSERT_EQ(row_text(terminal, i), expected);
+    }
+
+    // Without a carriage return, the text continues from the cursor column. Text which fills the row is deferred too.
+    feed(terminal, parser, "\na\nb\r\nwxy"_sv);
+    ASSERT_EQ(screen.absolute_row_screen_start(), 16);
+    terminal.flush_line_feeds();
+    ASSERT_EQ(screen.absolute_row_screen_start(), 19);
+    ASSERT_EQ(row_text(terminal, 19), "20  "_sv);
+    ASSERT_EQ(row_text(terminal, 20), "  a "_sv);
+    ASSERT_EQ(row_text(terminal, 21), "   b"_sv);
+    ASSERT_EQ(row_text(terminal, 22), "wxy "_sv);
+
+    // A queued line feed cancels a pending wrap.
+    feed(terminal, parser, "z\nq"_sv);
+    terminal.flush_line_feeds();
+    ASSERT_EQ(screen.absolute_row_screen_start(), 20);
+    ASSERT_EQ(row_text(terminal, 22), "wxyz"_sv);
+    ASSERT_EQ(row_text(terminal, 23), "   q"_sv);
+    ASSERT_EQ(terminal.cursor_col(), 3);
+    ASSERT(screen.cursor().overflow_pending);
+
+    // Anything else applies the queued line feeds before it, so text after it lands on the expected row.
+    feed(terminal, parser, "\r\nab\033[31mc\r\n\xc3\xa9\r\n"_sv);
+    terminal.flush_line_feeds();
+    ASSERT_EQ(screen.absolute_row_screen_start(), 23);
+    ASSERT_EQ(row_text(terminal, 24), "abc "_sv);
+    ASSERT_EQ(row_text(terminal, 25), u8"é   "_sv);
+    ASSERT_EQ(row_text(terminal, 26), "    "_sv);
+}
+
+static void alternate_screen_reuse() {
+    auto terminal = Terminal(0, { .rows = 4, .cols = 10 });
+    auto parser = EscapeSequenceParser();
+
+    feed(terminal, parser, "\033[?1049habc"_sv);
+    ASSERT(terminal.in_alternate_screen_buffer());
+    ASSERT(terminal.active_screen().screen.set_search(*ttx::terminal::SearchPattern::literal("abc"_sv)));
+
+    // The alternate screen is reused after leaving it, but nothing from its previous use carries over.
+    feed(terminal, parser, "\033[?1049l\033[?1049h"_sv);
+    ASSERT(terminal.in_alternate_screen_buffer());
+    ASSERT(!terminal.active_screen().screen.search_active());
+    ASSERT(!terminal.active_screen().screen.search_match());
+    ASSERT_EQ(terminal.cursor_row(), 0);
+    ASSERT_EQ(terminal.cursor_col(), 0);
+}
+
+TEST(terminal, line_feed_batching)
+TEST(terminal, line_feed_batching_with_text)
+TEST(terminal, alternate_screen_reuse)
+}
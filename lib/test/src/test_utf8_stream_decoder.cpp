@@ -22,6 +22,28 @@ static void basic() {
     }
 }
 
+static void ascii_fast_path() {
+    // Long ASCII runs are decoded in blocks, so make sure multi-byte sequences
+    // straddling block and segment boundaries are still handled correctly.
+    auto s = u8"0123456789abcdefghijklmnopqrstuvwxyz€ABCDEFGHIJKLMNOPQRSTUVWXYZ𐍈0123456789abcdef"_sv;
+    auto as_bytes = di::as_bytes(s.span());
+
+    auto decoder = ttx::Utf8StreamDecoder {};
+    for (auto i : di::range(s.size_bytes() + 1)) {
+        auto s1 = decoder.decode(as_bytes.subspan(0, i).value_or({}));
+        auto s2 = decoder.decode(as_bytes.subspan(i).value_or({}));
+
+        s1.append(di::move(s2));
+        ASSERT_EQ(s1, s);
+    }
+
+    // Invalid bytes following an ASCII block must still be replaced.
+    auto invalid = di::Array { 'a'_b, 'b'_b, 'c'_b, 'd'_b, 'e'_b, 'f'_b, 'g'_b, 'h'_b, 'i'_b,
+                               'j'_b, 'k'_b, 'l'_b, 'm'_b, 'n'_b, 'o'_b, 'p'_b, 0xFF_b, 'q'_b };
+    auto actual = decoder.decode(invalid.span());
+    ASSERT_EQ(actual, u8"abcdefghijklmnop\uFFFDq"_sv);
+}
+
 static void errors() {
     // This tests that invalid UTF-8 sequences are replaced with
     // U+FFFD in a uniform manner, as specified in the Unicode core specification:
@@ -58,6 +80,64 @@ static void errors() {
     }
 }
 
+// Decode input with decode_view(), recording where each piece of the output is stored.
+static auto decode_pieces(ttx::Utf8StreamDecoder& decoder, di::Span<byte const> input)
+    -> di::Vector<di::Tuple<di::String, void const*>> {
+    auto result = di::Vector<di::Tuple<di::String, void const*>> {};
+    decoder.decode_view(input, [&](di::StringView piece) {
+        result.push_back({ piece | di::to<di::String>(), static_cast<void const*>(piece.span().data()) });
+    });
+    return result;
+}
+
+static auto decode_view_to_string(ttx::Utf8StreamDecoder& decoder, di::Span<byte const> input) -> di::String {
+    auto result = di::String {};
+    for (auto const& [piece, _] : decode_pieces(decoder, input)) {
+        result.append(piece);
+    }
+    return result;
+}
+
+static void decode_view() {
+    auto s = u8"abc$¢€𐍈def"_sv;
+    auto as_bytes = di::as_bytes(s.span());
+
+    // Valid input is passed as a view over the input itself.
+    auto decoder = ttx::Utf8StreamDecoder {};
+    auto pieces = decode_pieces(decoder, as_bytes);
+    ASSERT_EQ(pieces.size(), 1);
+    ASSERT_EQ(di::get<0>(pieces[0]), s);
+    ASSERT_EQ(di::get<1>(pieces[0]), static_cast<void const*>(as_bytes.data()));
+
+    // Sequences split across calls are stitched together.
+    for (auto i : di::range(s.size_bytes() + 1)) {
+        auto s1 = decode_view_to_string(decoder, as_bytes.subspan(0, i).value_or({}));
+        auto s2 = decode_view_to_string(decoder, as_bytes.subspan(i).value_or({}));
+
+        s1.append(s2);
+        ASSERT_EQ(s1, s);
+    }
+
+    // Only the rest of a split sequence is copied, and the remaining input is still passed in place.
+    auto split = u8"€abc"_sv;
+    auto split_bytes = di::as_bytes(split.span());
+    ASSERT(decode_pieces(decoder, *split_bytes.subspan(0, 1)).empty());
+    pieces = decode_pieces(decoder, *split_bytes.subspan(1));
+    ASSERT_EQ(pieces.size(), 2);
+    ASSERT_EQ(di::get<0>(pieces[0]), u8"€"_sv);
+    ASSERT_EQ(di::get<0>(pieces[1]), u8"abc"_sv);
+    ASSERT_EQ(di::get<1>(pieces[1]), static_cast<void const*>(split_bytes.data() + 3));
+
+    // Invalid bytes are replaced.
+    c8 const* invalid = u8"ab\xC0\xAFc\xE2\x82";
+    auto invalid_span = di::Span(invalid, invalid + di::distance(di::ZC8CString(invalid)));
+    auto actual = decode_view_to_string(decoder, di::as_bytes(invalid_span));
+    actual.append(decoder.flush());
+    ASSERT_EQ(actual, u8"ab\uFFFD\uFFFDc\uFFFD"_sv);
+}
+
 TEST(utf8_stream_decoder, basic)
+TEST(utf8_stream_decoder, ascii_fast_path)
+TEST(utf8_stream_decoder, decode_view)
 TEST(utf8_stream_decoder, errors)
 }
@@ -6,6 +6,8 @@ if(BUILD_TESTING)
     include(meta/cmake/terminal-test.cmake)
 endif()
 
+add_subdirectory(lib/bench)
+
 option(ENABLE_COVERAGE "Enable coverage support separate from CTest's" OFF)
 if(ENABLE_COVERAGE)
     include(meta/cmake/coverage.cmake)
@@ -7,6 +7,7 @@
 #include "input.h"
 #include "tab.h"
 #include "ttx/layout.h"
+#include "ttx/terminal/scroll_back.h"
 
 namespace ttx {
 auto enter_normal_mode() -> Action {
@@ -670,6 +671,145 @@ auto scroll_next_command() -> Action {
     };
 }
 
+auto search_scroll_back(bool regex) -> Action {
+    return {
+        .description = *di::present("Search the scroll back of the active pane (regex = {})"_sv, regex),
+        .apply =
+            [regex](ActionContext const& context) {
+                context.layout_state.with_lock([&](LayoutState& state) {
+                    for (auto& session : state.active_session()) {
+                        if (!session.active_tab() || !state.active_pane()) {
+                            return;
+                        }
+                        auto& tab = session.active_tab().value();
+                        auto& pane = state.active_pane().value();
+
+                        auto title = regex ? "Search Scroll Back (Regex)"_s : "Search Scroll Back"_s;
+                        auto [create_pane_args, popup_layout] = Fzf()
+                                                                    .as_text_box()
+                                                                    .with_title(di::move(title))
+                                                                    .with_prompt("Search"_s)
+                                                                    .popup_args(context.create_pane_args.clone());
+                        create_pane_args.hooks.did_finish_output = di::make_function<void(di::StringView)>(
+                            [&layout_state = context.layout_state, &render_thread = context.render_thread,
+                             session_id = session.id(), tab_id = tab.id(), pane_id = pane.id(),
+                             regex](di::StringView contents) {
+                                while (contents.ends_with(U'\n')) {
+                                    contents = contents.substr(contents.begin(), --contents.end());
+                                }
+                                auto found = layout_state.with_lock([&](LayoutState& current_state) {
+                                    // The pane may have exited while the popup was open, so look it up again.
+                                    if (auto target = current_state.pane_by_id(session_id, tab_id, pane_id)) {
+                                        return target.value().search(contents, regex) || contents.empty();
+                                    }
+                                    return true;
+                                });
+                                if (!found) {
+                                    render_thread.status_message("No matches"_s);
+                                }
+                                render_thread.request_render();
+                            });
+                        (void) state.popup_pane(session, tab, popup_layout, di::move(create_pane_args),
+                                                context.render_thread, context.input_thread);
+                    }
+                });
+                context.render_thread.request_render();
+            },
+    };
+}
+
+auto search_prev_match() -> Action {
+    return {
+        .description = "Scroll up to the previous match of the scroll back search"_s,
+        .apply =
+            [](ActionContext const& context) {
+                context.layout_state.with_lock([&](LayoutState& state) {
+                    if (auto pane = state.active_pane()) {
+                        pane->search_prev();
+                    }
+                });
+                context.render_thread.request_render();
+            },
+    };
+}
+
+auto search_next_match() -> Action {
+    return {
+        .description = "Scroll down to the next match of the scroll back search"_s,
+        .apply =
+            [](ActionContext const& context) {
+                context.layout_state.with_lock([&](LayoutState& state) {
+                    if (auto pane = state.active_pane()) {
+                        pane->search_next();
+                    }
+                });
+                context.render_thread.request_render();
+            },
+    };
+}
+
+auto clear_search() -> Action {
+    return {
+        .description = "Clear the scroll back search highlights"_s,
+        .apply =
+            [](ActionContext const& context) {
+                context.layout_state.with_lock([&](LayoutState& state) {
+                    if (auto pane = state.active_pane()) {
+                        pane->clear_search();
+                    }
+                });
+                context.render_thread.request_render();
+            },
+    };
+}
+
+auto set_scroll_back_limit() -> Action {
+    return {
+        .description = "Set the scroll back memory limit of the active pane in MiB"_s,
+        .apply =
+            [](ActionContext const& context) {
+                context.layout_state.with_lock([&](LayoutState& state) {
+                    for (auto& session : state.active_session()) {
+                        if (!session.active_tab() || !state.active_pane()) {
+                            return;
+                        }
+                        auto& tab = session.active_tab().value();
+                        auto& pane = state.active_pane().value();
+
+                        auto [create_pane_args, popup_layout] = Fzf()
+                                                                    .as_text_box()
+                                                                    .with_title("Scroll Back Limit"_s)
+                                                                    .with_prompt("MiB"_s)
+                                                                    .popup_args(context.create_pane_args.clone());
+                        create_pane_args.hooks.did_finish_output = di::make_function<void(di::StringView)>(
+                            [&layout_state = context.layout_state, &render_thread = context.render_thread,
+                             session_id = session.id(), tab_id = tab.id(),
+                             pane_id = pane.id()](di::StringView contents) {
+                                // This fails if the popup was dismissed without entering a number.
+                                auto mib = di::parse_partial<u32>(contents);
+                                if (!mib) {
+                                    return;
+                                }
+                                layout_state.with_lock([&](LayoutState& current_state) {
+                                    // The pane may have exited while the popup was open, so look it up again.
+                                    if (auto target = current_state.pane_by_id(session_id, tab_id, pane_id)) {
+                                        target.value().set_scroll_back_limit(
+                                            terminal::ScrollBack::cells_for_mib(mib.value()));
+                                    }
+                                });
+                                render_thread.status_message(
+                                    *di::present("Scroll back limit set to {} MiB"_sv, mib.value()));
+                                render_thread.request_render();
+                            });
+                        (void) state.popup_pane(session, tab, popup_layout, di::move(create_pane_args),
+                                                context.render_thread, context.input_thread);
+                    }
+                });
+                context.render_thread.request_render();
+            },
+    };
+}
+
 auto copy_last_command(bool include_command) -> Action {
     return {
         .description = *di::present("Copy text from latest command (include command text = {})"_sv, include_command),
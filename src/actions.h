@@ -36,6 +36,11 @@ auto scroll_to_top() -> Action;
 auto scroll_to_bottom() -> Action;
 auto scroll_prev_command() -> Action;
 auto scroll_next_command() -> Action;
+auto search_scroll_back(bool regex) -> Action;
+auto search_prev_match() -> Action;
+auto search_next_match() -> Action;
+auto clear_search() -> Action;
+auto set_scroll_back_limit() -> Action;
 auto copy_last_command(bool include_command) -> Action;
 auto send_to_pane() -> Action;
 }
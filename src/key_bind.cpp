@@ -295,6 +295,40 @@ auto make_key_binds(Key prefix, di::Path save_state_path, bool replay_mode) -> d
             .mode = InputMode::Normal,
             .action = scroll_next_command(),
         });
+        result.push_back({
+            .key = Key::Slash,
+            .mode = InputMode::Normal,
+            .action = search_scroll_back(false),
+        });
+        result.push_back({
+            .key = Key::Slash,
+            .modifiers = Modifiers::Shift,
+            .mode = InputMode::Normal,
+            .action = search_scroll_back(true),
+        });
+        result.push_back({
+            .key = Key::Comma,
+            .modifiers = Modifiers::Shift,
+            .mode = InputMode::Normal,
+            .action = search_prev_match(),
+        });
+        result.push_back({
+            .key = Key::Period,
+            .modifiers = Modifiers::Shift,
+            .mode = InputMode::Normal,
+            .action = search_next_match(),
+        });
+        result.push_back({
+            .key = Key::M,
+            .modifiers = Modifiers::Shift,
+            .mode = InputMode::Normal,
+            .action = set_scroll_back_limit(),
+        });
+        result.push_back({
+            .key = Key::Period,
+            .mode = InputMode::Normal,
+            .action = clear_search(),
+        });
         result.push_back({
             .key = Key::None,
             .mode = InputMode::Normal,
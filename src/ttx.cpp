@@ -11,7 +11,9 @@
 #include "render.h"
 #include "save_layout.h"
 #include "ttx/features.h"
+#include "ttx/scroll_back_governor.h"
 #include "ttx/terminal/capability.h"
+#include "ttx/terminal/scroll_back.h"
 
 namespace ttx {
 struct Args {
@@ -25,6 +27,9 @@ struct Args {
     di::Optional<di::TransparentStringView> layout_restore_name;
     di::Optional<di::TransparentStringView> print_terminfo_mode;
     di::Optional<di::TransparentStringView> term;
+    di::Optional<u32> scroll_back_limit_mib;
+    di::Optional<u32> scroll_back_budget_mib;
+    bool scroll_back_spill { false };
     ClipboardMode clipboard_mode { ClipboardMode::System };
     bool replay { false };
     bool headless { false };
@@ -47,6 +52,15 @@ struct Args {
                                    "Replay capture output (file paths are passed via positional args)"_sv)
             .option<&Args::term>('t', "term"_tsv, "Set TERM environment variable (default xterm-ttx)"_sv)
             .option<&Args::clipboard_mode>({}, "clipboard"_tsv, "Set the clipboard mode"_sv)
+            .option<&Args::scroll_back_limit_mib>({}, "scroll-back-limit"_tsv,
+                                                  "Maximum scroll back memory per pane in MiB"_sv)
+            .option<&Args::scroll_back_budget_mib>(
+                {}, "scroll-back-budget"_tsv,
+                "Maximum scroll back memory for all panes in MiB (least recently viewed panes are trimmed first)"_sv)
+            .option<&Args::scroll_back_spill>(
+                {}, "scroll-back-spill"_tsv,
+                "Write scroll back which exceeds the memory limits to $XDG_STATE_HOME/ttx/scroll-back instead of "
+                "discarding it"_sv)
             .option<&Args::print_terminfo_mode>({}, "terminfo"_tsv,
                                                 "Print terminfo (mode can be one of: [terminfo, verbose])"_sv)
             .option<&Args::force_local_terminfo>(
@@ -62,6 +76,10 @@ struct Args {
     }
 };
 
+static auto mib_to_cells(u32 mib) -> usize {
+    return terminal::ScrollBack::cells_for_mib(mib);
+}
+
 static auto get_session_save_dir() -> di::Result<di::Path> {
     auto const& env = dius::system::get_environment();
     auto data_home = env.at("XDG_DATA_HOME"_tsv)
@@ -83,7 +101,7 @@ static auto get_session_save_dir() -> di::Result<di::Path> {
     return di::move(result);
 }
 
-static auto get_local_terminfo_dir() -> di::Result<di::Path> {
+static auto get_state_dir() -> di::Result<di::Path> {
     auto const& env = dius::system::get_environment();
     auto data_home = env.at("XDG_STATE_HOME"_tsv)
                          .transform([&](di::TransparentStringView path) {
@@ -100,10 +118,21 @@ static auto get_local_terminfo_dir() -> di::Result<di::Path> {
 
     auto& result = data_home.value();
     result /= "ttx"_tsv;
+    return di::move(result);
+}
+
+static auto get_local_terminfo_dir() -> di::Result<di::Path> {
+    auto result = TRY(get_state_dir());
     result /= "terminfo"_tsv;
     return di::move(result);
 }
 
+static auto get_scroll_back_spill_dir() -> di::Result<di::Path> {
+    auto result = TRY(get_state_dir());
+    result /= "scroll-back"_tsv;
+    return di::move(result);
+}
+
 static auto maybe_get_terminfo_dir(di::Optional<di::TransparentStringView> term, bool force_local_terminfo)
     -> di::Result<di::Optional<di::Path>> {
     // If the user is overriding TERM, don't setup our terminfo.
@@ -231,14 +260,25 @@ static auto main(Args& args) -> di::Result<void> {
     // Setup - potentially compile terminfo database
     auto maybe_terminfo_dir = TRY(maybe_get_terminfo_dir(args.term, args.force_local_terminfo));
 
+    // Setup - scroll back spill directory. Without it, scroll back over the limits is discarded.
+    auto scroll_back_spill_dir = di::Optional<di::Path> {};
+    if (args.scroll_back_spill) {
+        scroll_back_spill_dir = TRY(get_scroll_back_spill_dir());
+    }
+
     // Setup - initialize pane arguments
     auto base_create_pane_args = CreatePaneArgs {
         .command = command.clone(),
         .capture_command_output_path = args.capture_command_output_path.transform(di::to_owned),
         .save_state_path = args.save_state_path.transform(di::to_owned),
         .terminfo_dir = di::move(maybe_terminfo_dir),
+        .scroll_back_limit = args.scroll_back_limit_mib.transform(mib_to_cells),
+        .scroll_back_spill_dir = di::move(scroll_back_spill_dir),
         .term = args.term.value_or("xterm-ttx"_tsv),
     };
+    if (args.scroll_back_budget_mib) {
+        ScrollBackGovernor::shared().set_max_cells(mib_to_cells(*args.scroll_back_budget_mib));
+    }
 
     // Setup - in headless mode there is no terminal. Ensure stdin is not valid.
     if (args.headless) {